@@ -41,6 +41,38 @@
 
 #include <neorv32.h>
 
+/**********************************************************************//**
+ * LED sequencer on the Wishbone bus
+ **************************************************************************/
+#define WB_LEDS_BASE_ADDRESS 0x90000200
+#define WB_LEDS_REG0_OFFSET  0x00
+#define WB_LEDS_REG1_OFFSET  0x04
+#define WB_LEDS_REG2_OFFSET  0x08
+#define WB_LEDS_STEP_OFFSET  0x100 // REG64: step 0 of the pattern RAM
+
+#define WB_LEDS_RUN          0x00000001 // REG0: play the sequence
+#define WB_LEDS_IRQ_EN       0x00000002 // REG0: end of sequence interrupt enable
+#define WB_LEDS_END_PEND     0x00000100 // REG0: end of sequence pending (write 1 to clear)
+
+/**********************************************************************//**
+ * Button block on the Wishbone bus
+ **************************************************************************/
+#define WB_BUTTONS_BASE_ADDRESS 0x90000300
+#define WB_BUTTONS_REG1_OFFSET  0x04 // press pending, write 1 to clear
+#define WB_BUTTONS_REG3_OFFSET  0x0C // interrupt enables
+#define WB_BUTTONS_REG5_OFFSET  0x14 // last pressed button, 1..3
+
+#define WB_BUTTONS_PRESS_IRQ 0x00000007 // REG3: press interrupt of the three buttons
+
+/** Step of the pattern RAM: LED value shown during ms milliseconds */
+#define PASO(valor, ms) (((uint32_t)(ms) << 16) | (valor))
+
+/** Sequences in the pattern RAM: first step, last step, passes */
+#define SEC_CONTADOR      0, 30, 1   // 0..30, 200 ms each
+#define SEC_INTERMITENTE1 32, 33, 15 // 0x10 / 0x0F
+#define SEC_INTERMITENTE2 34, 35, 15 // 0x13 / 0x1C
+#define SEC_AVISO         36, 37, 3  // 3 flashes before the reset
+
 
 /**********************************************************************//**
  * @name User configuration
@@ -55,13 +87,18 @@
 /************************************************************************//**
  * Global variables:
  * *************************************************************************/
-  uint64_t Button_value;
+  volatile uint32_t Button_value = 0; // Set by the button press interrupt
+  volatile uint8_t Fin_secuencia = 0; // Set by the end of sequence interrupt
 
 
 /**********************************************************************//**
  * C function to blink LEDs
  **************************************************************************/
 void Selection_led_mode_c(void);
+void Carga_secuencias(void);
+void Reproduce_secuencia(uint8_t Primero, uint8_t Ultimo, uint16_t Pasadas);
+void Configura_botones(void);
+void Externa_irq_handler(void);
 
 
 /**********************************************************************//**
@@ -86,6 +123,11 @@ int main() {
   // this is not required, but keeps us safe
   neorv32_rte_setup();
 
+  // end of LED sequence and button interrupts, both on the machine external interrupt
+  neorv32_rte_exception_install(RTE_TRAP_MEI, Externa_irq_handler);
+  neorv32_cpu_irq_enable(CSR_MIE_MEIE);
+  neorv32_cpu_eint();
+
   // Indicate to the user that the program is running
   neorv32_uart0_print("Running Practica1_mod program\n\n");
   neorv32_uart0_print("Pulse un boton para reproducir una secuencia:\n");
@@ -102,60 +144,115 @@ int main() {
  * Led mode fuction
  **************************************************************************/
 void Selection_led_mode_c(void) {
-  uint8_t time = 0;
-  int i=0;
 
   neorv32_gpio_port_set(0x20); // Asynchronous Reset
   neorv32_cpu_delay_ms(10); // wait 500ms using busy wait
   neorv32_gpio_port_set(0); // clear gpio output
+
+  Carga_secuencias();
+  Configura_botones();
   
   while (1) {
 
+   //Sleep until a button is pressed
+   neorv32_cpu_dint();
+   while (Button_value == 0){
+     neorv32_cpu_sleep();
+     neorv32_cpu_eint();
+     neorv32_cpu_dint();
+   }
+   neorv32_cpu_eint();
 
    switch(Button_value){
-    case 0:
-    	// Read the values of the buttons
-   	Button_value = neorv32_gpio_port_get();
-    	time = 0;
-    break;
 
     case 1://Mode 1: contador...
-      neorv32_gpio_port_set(time & 0x1F); // increment counter and mask for lowest 8 bit
-      time++;
+      Reproduce_secuencia(SEC_CONTADOR);
     break;    
     
     case 2://Mode 2: Itermitente 1
-      //Intermitente según si la variable time es par o impar
-      if((time & 0x01)) neorv32_gpio_port_set(0x0F);
-      else neorv32_gpio_port_set(0x10);
-      time++;
+      Reproduce_secuencia(SEC_INTERMITENTE1);
     break;
     
     case 3://Mode 3: Intermitnte 2
-      //Intermitente según si la variable time es par o impar
-      if((time & 0x01)) neorv32_gpio_port_set(0x1C);
-      else neorv32_gpio_port_set(0x13);
-      time++;
+      Reproduce_secuencia(SEC_INTERMITENTE2);
     break;
   
    }
-    neorv32_cpu_delay_ms(200); // wait 500ms using busy wait
 
-    if (time > 30){ //After 6 seconds in a mode...
-      for(i=0; i<3; i++)
-      {
-        neorv32_cpu_delay_ms(300);  //leds sequence to announce the automatic reset
-        neorv32_gpio_port_set(0x1F);
-        neorv32_cpu_delay_ms(300);
-        neorv32_gpio_port_set(0x00);
-      }
+    if (Button_value != 0){ //After 6 seconds in a mode...
+      Reproduce_secuencia(SEC_AVISO);  //leds sequence to announce the automatic reset
 
       neorv32_gpio_port_set(0x20); // Asynchronous Reset 
       neorv32_uart0_print("\nReset activado");
       neorv32_cpu_delay_ms(10); // wait 500ms using busy wait
-      neorv32_gpio_port_set(0); // clear gpio output
-      time = 0;
+      neorv32_gpio_port_set(0); // clear gpio output, the pattern RAM keeps its steps
+      Configura_botones(); // the reset clears the button enables too
       Button_value = 0;
     }
   }
 }
+
+/**********************************************************************//**
+ * Pattern RAM of the LED sequencer, written once
+ **************************************************************************/
+void Carga_secuencias(void) {
+  uint8_t i;
+
+  for (i=0 ; i<31 ; i++){ // Contador
+    neorv32_cpu_store_unsigned_word (WB_LEDS_BASE_ADDRESS + WB_LEDS_STEP_OFFSET + 4*i, PASO(i, 200));
+  }
+  neorv32_cpu_store_unsigned_word (WB_LEDS_BASE_ADDRESS + WB_LEDS_STEP_OFFSET + 4*32, PASO(0x10, 200)); // Intermitente 1
+  neorv32_cpu_store_unsigned_word (WB_LEDS_BASE_ADDRESS + WB_LEDS_STEP_OFFSET + 4*33, PASO(0x0F, 200));
+  neorv32_cpu_store_unsigned_word (WB_LEDS_BASE_ADDRESS + WB_LEDS_STEP_OFFSET + 4*34, PASO(0x13, 200)); // Intermitente 2
+  neorv32_cpu_store_unsigned_word (WB_LEDS_BASE_ADDRESS + WB_LEDS_STEP_OFFSET + 4*35, PASO(0x1C, 200));
+  neorv32_cpu_store_unsigned_word (WB_LEDS_BASE_ADDRESS + WB_LEDS_STEP_OFFSET + 4*36, PASO(0x00, 300)); // Aviso
+  neorv32_cpu_store_unsigned_word (WB_LEDS_BASE_ADDRESS + WB_LEDS_STEP_OFFSET + 4*37, PASO(0x1F, 300));
+
+  neorv32_cpu_store_unsigned_word (WB_LEDS_BASE_ADDRESS + WB_LEDS_REG2_OFFSET, 0x00); // LEDs off while stopped
+}
+
+/**********************************************************************//**
+ * Plays a sequence and sleeps until its end interrupt, no CPU time while the LEDs run
+ **************************************************************************/
+void Reproduce_secuencia(uint8_t Primero, uint8_t Ultimo, uint16_t Pasadas) {
+
+  Fin_secuencia = 0;
+  neorv32_cpu_store_unsigned_word (WB_LEDS_BASE_ADDRESS + WB_LEDS_REG1_OFFSET, ((uint32_t)Pasadas << 16) | ((uint32_t)Ultimo << 8) | Primero);
+  neorv32_cpu_store_unsigned_word (WB_LEDS_BASE_ADDRESS + WB_LEDS_REG0_OFFSET, WB_LEDS_RUN | WB_LEDS_IRQ_EN);
+
+  //Sleep until the end interrupt, unless it arrived already
+  neorv32_cpu_dint();
+  while (Fin_secuencia == 0){
+    neorv32_cpu_sleep();
+    neorv32_cpu_eint();
+    neorv32_cpu_dint();
+  }
+  neorv32_cpu_eint();
+}
+
+/**********************************************************************//**
+ * Press interrupt of the three buttons, presses are captured by the hardware
+ **************************************************************************/
+void Configura_botones(void) {
+
+  neorv32_cpu_store_unsigned_word (WB_BUTTONS_BASE_ADDRESS + WB_BUTTONS_REG1_OFFSET, WB_BUTTONS_PRESS_IRQ); // drop old presses
+  neorv32_cpu_store_unsigned_word (WB_BUTTONS_BASE_ADDRESS + WB_BUTTONS_REG3_OFFSET, WB_BUTTONS_PRESS_IRQ);
+}
+
+void Externa_irq_handler(void){
+  uint32_t Pendientes;
+
+  //Both interrupts are levels, clear the pending flags to release them
+  if (neorv32_cpu_load_unsigned_word (WB_LEDS_BASE_ADDRESS + WB_LEDS_REG0_OFFSET) & WB_LEDS_END_PEND){
+    neorv32_cpu_store_unsigned_word (WB_LEDS_BASE_ADDRESS + WB_LEDS_REG0_OFFSET, WB_LEDS_IRQ_EN | WB_LEDS_END_PEND);
+    Fin_secuencia = 1;
+  }
+
+  Pendientes = neorv32_cpu_load_unsigned_word (WB_BUTTONS_BASE_ADDRESS + WB_BUTTONS_REG1_OFFSET);
+  if (Pendientes != 0){
+    neorv32_cpu_store_unsigned_word (WB_BUTTONS_BASE_ADDRESS + WB_BUTTONS_REG1_OFFSET, Pendientes);
+    if (Button_value == 0){ //Presses while a sequence plays are ignored
+      Button_value = neorv32_cpu_load_unsigned_word (WB_BUTTONS_BASE_ADDRESS + WB_BUTTONS_REG5_OFFSET);
+    }
+  }
+}
@@ -121,14 +121,42 @@ architecture neorv32_iCEBreaker_BoardTop_MinimalBoot_rtl of neorv32_iCEBreaker_B
   constant IO_PWM_NUM_CH                : natural := 3;           -- number of PWM channels to implement (0..60); 0 = disabled
   constant IO_WDT_EN                    : boolean := true;        -- implement watch dog timer (WDT)?
 
+  -- Wishbone slaves --
+  constant WB_NUM_SLAVES                : natural := 2;           -- number of slaves on the Wishbone interconnect
+  constant WB_SLAVE_LEDS                : natural := 0;           -- LED sequencer, 0x90000200, 512 bytes
+  constant WB_SLAVE_BUTTONS             : natural := 1;           -- buttons, 0x90000300, 32 bytes
+
   -- -------------------------------------------------------------------------------------------
   -- Signals for internal IO connections
   -- -------------------------------------------------------------------------------------------
   signal gpio_o : std_ulogic_vector(63 downto 0);
   signal gpio_i : std_logic_vector(63 downto 0);
-  signal n_button_val : std_logic_vector(3 downto 0):="0000";
-  signal c_button_val : std_logic_vector(3 downto 0):="0000";
-  signal Reset_signal : std_logic;
+  signal button_val_s : std_ulogic_vector(3 downto 0);          -- Last pressed button, from the button block
+  signal c_por        : unsigned(3 downto 0) := (others => '0'); -- Power-on reset, the iCE40 flip-flops start at 0
+  signal Reset_signal : std_logic := '1';
+
+  -- Signals for Wishbone --
+  signal wb_tag_m2s   : std_ulogic_vector(2 downto 0);          -- Request tag
+  signal wb_adr_m2s   : std_ulogic_vector(31 downto 0);         -- Address
+  signal wb_dat_s2m   : std_ulogic_vector(31 downto 0);         -- Read Data from the interconnect
+  signal wb_dat_m2s   : std_ulogic_vector(31 downto 0);         -- Write Data
+  signal wb_we_m2s    : std_ulogic;                             -- Read/Write
+  signal wb_sel_m2s   : std_ulogic_vector(3 downto 0);          -- Byte enable
+  signal wb_stb_m2s   : std_ulogic;                             -- Strobe
+  signal wb_cyc_m2s   : std_ulogic;                             -- Valid Cycle
+  signal wb_lock_m2s  : std_ulogic;                             -- Exclusive Acces
+  signal wb_ack_s2m   : std_ulogic;                             -- Transfer Ack from the interconnect
+  signal wb_err_s2m   : std_ulogic;                             -- Transfer error from the interconnect
+
+  signal wb_stb_slv   : std_ulogic_vector(WB_NUM_SLAVES-1 downto 0);    -- Strobe of each slave
+  signal wb_cyc_slv   : std_ulogic_vector(WB_NUM_SLAVES-1 downto 0);    -- Valid Cycle of each slave
+  signal wb_dat_slv   : std_ulogic_vector(WB_NUM_SLAVES*32-1 downto 0); -- Read Data of each slave
+  signal wb_ack_slv   : std_ulogic_vector(WB_NUM_SLAVES-1 downto 0);    -- Transfer Ack of each slave
+  signal wb_err_slv   : std_ulogic_vector(WB_NUM_SLAVES-1 downto 0);    -- Transfer error of each slave
+
+  signal led_s        : std_ulogic_vector(7 downto 0);          -- LEDs from the sequencer
+  signal irq_leds_s   : std_ulogic;                             -- End of sequence interrupt
+  signal irq_buttons_s : std_ulogic;                            -- Button edge interrupt
 
 begin
 
@@ -185,7 +213,7 @@ begin
     ICACHE_ASSOCIATIVITY         => ICACHE_ASSOCIATIVITY,  -- i-cache: associativity / number of sets (1=direct_mapped), has to be a power of 2
 
     -- External memory interface --
-    MEM_EXT_EN                   => false,                 -- implement external memory bus interface?
+    MEM_EXT_EN                   => true,                  -- implement external memory bus interface?
     MEM_EXT_TIMEOUT              => 0,                     -- cycles after a pending bus access auto-terminates (0 = disabled)
 
     -- Processor peripherals --
@@ -217,17 +245,17 @@ begin
     jtag_tms_i  => '0',                          -- mode select
 
     -- Wishbone bus interface (available if MEM_EXT_EN = true) --
-    wb_tag_o    => open,                         -- request tag
-    wb_adr_o    => open,                         -- address
-    wb_dat_i    => (others => '0'),              -- read data
-    wb_dat_o    => open,                         -- write data
-    wb_we_o     => open,                         -- read/write
-    wb_sel_o    => open,                         -- byte enable
-    wb_stb_o    => open,                         -- strobe
-    wb_cyc_o    => open,                         -- valid cycle
-    wb_lock_o   => open,                         -- exclusive access request
-    wb_ack_i    => '0',                          -- transfer acknowledge
-    wb_err_i    => '0',                          -- transfer error
+    wb_tag_o    => wb_tag_m2s,     -- request tag
+    wb_adr_o    => wb_adr_m2s,     -- address
+    wb_dat_i    => wb_dat_s2m,     -- read data
+    wb_dat_o    => wb_dat_m2s,     -- write data
+    wb_we_o     => wb_we_m2s,      -- read/write
+    wb_sel_o    => wb_sel_m2s,     -- byte enable
+    wb_stb_o    => wb_stb_m2s,     -- strobe
+    wb_cyc_o    => wb_cyc_m2s,     -- valid cycle
+    wb_lock_o   => wb_lock_m2s,    -- exclusive access request
+    wb_ack_i    => wb_ack_s2m,     -- transfer acknowledge
+    wb_err_i    => wb_err_s2m,     -- transfer error
 
     -- Advanced memory control signals (available if MEM_EXT_EN = true) --
     fence_o     => open,                         -- indicates an executed FENCE operation
@@ -276,59 +304,115 @@ begin
     -- Interrupts --
     mtime_irq_i => '0',                          -- machine timer interrupt, available if IO_MTIME_EN = false
     msw_irq_i   => '0',                          -- machine software interrupt
-    mext_irq_i  => '0'                           -- machine external interrupt
+    mext_irq_i  => irq_leds_s or irq_buttons_s   -- machine external interrupt: end of LED sequence or button
   );
 
+  -- -------------------------------------------------------------------------------------------
+  -- Wishbone interconnect: address decode and read mux of the slaves
+  -- -------------------------------------------------------------------------------------------
+
+  wb_interconnect_0: entity neorv32.wb_interconnect
+  generic map(NUM_SLAVES      => WB_NUM_SLAVES,
+              SLAVE_BASE      => x"90000300" & x"90000200",   -- buttons & LED sequencer
+              SLAVE_SIZE      => x"00000020" & x"00000200",
+              REGISTERED_RESP => false )
+  port map(
+    clk_i     => std_ulogic(iCEBreakerv10_CLK),
+    reset_i   => Reset_signal,
+
+    wb_adr_i  => wb_adr_m2s,     -- address
+    wb_stb_i  => wb_stb_m2s,     -- strobe
+    wb_cyc_i  => wb_cyc_m2s,     -- valid cycle
+    wb_dat_o  => wb_dat_s2m,     -- read data
+    wb_ack_o  => wb_ack_s2m,     -- transfer acknowledge
+    wb_err_o  => wb_err_s2m,     -- transfer error
+
+    wb_stb_o  => wb_stb_slv,     -- strobe of each slave
+    wb_cyc_o  => wb_cyc_slv,     -- valid cycle of each slave
+    wb_dat_i  => wb_dat_slv,     -- read data of each slave
+    wb_ack_i  => wb_ack_slv,     -- transfer acknowledge of each slave
+    wb_err_i  => wb_err_slv      -- transfer error of each slave
+    );
+
+  led_sequencer_0: entity neorv32.wb_led_sequencer
+  generic map(WB_ADDR_BASE   => x"90000200",
+              WB_ADDR_SIZE   => 512,
+              STEPS          => 64,
+              LED_WIDTH      => 8 )
+  port map(
+    clk_i     => std_ulogic(iCEBreakerv10_CLK),
+    reset_i   => Reset_signal,
+
+    wb_tag_i  => wb_tag_m2s,     -- request tag
+    wb_adr_i  => wb_adr_m2s,     -- address
+    wb_dat_i  => wb_dat_m2s,     -- write data
+    wb_dat_o  => wb_dat_slv(WB_SLAVE_LEDS*32+31 downto WB_SLAVE_LEDS*32), -- read data
+    wb_we_i   => wb_we_m2s,      -- read/write
+    wb_sel_i  => wb_sel_m2s,     -- byte enable
+    wb_stb_i  => wb_stb_slv(WB_SLAVE_LEDS), -- strobe
+    wb_cyc_i  => wb_cyc_slv(WB_SLAVE_LEDS), -- valid cycle
+    wb_lock_i => wb_lock_m2s,    -- exclusive access request
+    wb_ack_o  => wb_ack_slv(WB_SLAVE_LEDS), -- transfer acknowledge
+    wb_err_o  => wb_err_slv(WB_SLAVE_LEDS), -- transfer error
+    wb_stall_o => open,                     -- never stalls
+
+    irq_o     => irq_leds_s,     -- end of sequence interrupt
+    led_o     => led_s
+    );
+
+  buttons_0: entity neorv32.wb_buttons
+  generic map(WB_ADDR_BASE   => x"90000300",
+              WB_ADDR_SIZE   => 32,
+              NUM_BUTTONS    => 3 )
+  port map(
+    clk_i     => std_ulogic(iCEBreakerv10_CLK),
+    reset_i   => Reset_signal,
+
+    wb_tag_i  => wb_tag_m2s,     -- request tag
+    wb_adr_i  => wb_adr_m2s,     -- address
+    wb_dat_i  => wb_dat_m2s,     -- write data
+    wb_dat_o  => wb_dat_slv(WB_SLAVE_BUTTONS*32+31 downto WB_SLAVE_BUTTONS*32), -- read data
+    wb_we_i   => wb_we_m2s,      -- read/write
+    wb_sel_i  => wb_sel_m2s,     -- byte enable
+    wb_stb_i  => wb_stb_slv(WB_SLAVE_BUTTONS), -- strobe
+    wb_cyc_i  => wb_cyc_slv(WB_SLAVE_BUTTONS), -- valid cycle
+    wb_lock_i => wb_lock_m2s,    -- exclusive access request
+    wb_ack_o  => wb_ack_slv(WB_SLAVE_BUTTONS), -- transfer acknowledge
+    wb_err_o  => wb_err_slv(WB_SLAVE_BUTTONS), -- transfer error
+    wb_stall_o => open,                        -- never stalls
+
+    irq_o     => irq_buttons_s,  -- button press interrupt
+
+    buttons_i(0) => std_ulogic(iCEBreakerv10_PMOD2_9_Button_1),
+    buttons_i(1) => std_ulogic(iCEBreakerv10_PMOD2_4_Button_2),
+    buttons_i(2) => std_ulogic(iCEBreakerv10_PMOD2_10_Button_3),
+    last_o    => button_val_s
+    );
+
   -- -------------------------------------------------------------------------------------------
   -- IO Connections
   -- -------------------------------------------------------------------------------------------
 
- -- Mapping Led signals from the micro
-  iCEBreakerv10_PMOD2_1_LED_left   <= gpio_o(0);
-  iCEBreakerv10_PMOD2_2_LED_right  <= gpio_o(1);
-  iCEBreakerv10_PMOD2_8_LED_up     <= gpio_o(2);
-  iCEBreakerv10_PMOD2_3_LED_down   <= gpio_o(3);
-  iCEBreakerv10_PMOD2_7_LED_center <= gpio_o(4);
+ -- Mapping Led signals from the sequencer
+  iCEBreakerv10_PMOD2_1_LED_left   <= led_s(0);
+  iCEBreakerv10_PMOD2_2_LED_right  <= led_s(1);
+  iCEBreakerv10_PMOD2_8_LED_up     <= led_s(2);
+  iCEBreakerv10_PMOD2_3_LED_down   <= led_s(3);
+  iCEBreakerv10_PMOD2_7_LED_center <= led_s(4);
  
- -- Reset signal from the micro
-  Reset_signal			   <= gpio_o(5);
-  
- -- Sending which buttom has been pushed
-  gpio_i <= x"000000000000000" & c_button_val;
-  
-  
-  Buttom_val_Register: process(iCEBreakerv10_CLK,Reset_signal)
+ -- Reset signal: first 15 cycles after power-on, reset button or the micro
+  por_sinc: process(iCEBreakerv10_CLK)
   begin
-  	-- Asynchronous reset
-  	if(Reset_signal = '1') then
-  		c_button_val <= (others => '0');
-  	elsif(rising_edge(iCEBreakerv10_CLK)) then
-  		c_button_val <= n_button_val;
-  	end if;
-  	
+    if rising_edge(iCEBreakerv10_CLK) then
+      if (c_por /= 15) then
+        c_por <= c_por + 1;
+      end if;
+    end if;
   end process;
+
+  Reset_signal			   <= '1' when (c_por /= 15) or (iCEBreakerv10_BTN_N = '0') or (gpio_o(5) = '1') else '0';
   
-  State_Buttom: process(
-    iCEBreakerv10_PMOD2_9_Button_1,
-    iCEBreakerv10_PMOD2_4_Button_2,
-    iCEBreakerv10_PMOD2_10_Button_3,
-    c_button_val
-    )
-  begin
- 	-- Keep the state
-  	n_button_val <= c_button_val; 
-  	-- We are sending which buttom has been pushed
-  	if (iCEBreakerv10_PMOD2_9_Button_1 = '1') then
-		n_button_val <= x"1";
-	elsif (iCEBreakerv10_PMOD2_4_Button_2 = '1') then
-		n_button_val <= x"2";
-	elsif (iCEBreakerv10_PMOD2_10_Button_3 = '1') then 
-		n_button_val <= x"3";
-	end if; 
-  end process;
-  
-  
-  
-  
+ -- Sending which buttom has been pushed, kept for polling
+  gpio_i <= x"000000000000000" & std_logic_vector(button_val_s);
 
 end architecture;
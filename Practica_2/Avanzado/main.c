@@ -52,10 +52,17 @@
 //#define USE_ASM_VERSION
 /**@}*/
 
+/** GPIO input: the keypad reports a pressed key */
+#define GPIO_KEY_VALID 0x01000000
+
 /************************************************************************//**
  * Global variables:
  * *************************************************************************/
   uint64_t Button_value;
+  uint8_t KeyValue[16] = {  0 ,  7 ,  4 ,  1,
+                           68 , 67 , 66 , 65,
+                           69 ,  9 ,  6 ,  3,
+                           70 ,  8 ,  5 ,  2 };
   uint64_t puls_value;
 
 
@@ -252,26 +259,12 @@ uint8_t Lee_teclado(void){
   uint32_t Key_value = 0;
   uint8_t Caracter = 0xFF;
   
+  //Bit 24: a key is pressed, bits 23-20: index of the key, decoded by the hardware
   Key_value = neorv32_gpio_port_get();
-  Key_value = (Key_value >> 4);
-
-  if (Key_value & 0x0008) Caracter = 1;
-  else if (Key_value & 0x8000) Caracter = 2;
-  else if (Key_value & 0x0800) Caracter = 3;
-  else if (Key_value & 0x0080) Caracter = 65;
-  else if (Key_value & 0x0004) Caracter = 4;
-  else if (Key_value & 0x4000) Caracter = 5;
-  else if (Key_value & 0x0400) Caracter = 6;
-  else if (Key_value & 0x0040) Caracter = 66;
-  else if (Key_value & 0x0002) Caracter = 7;
-  else if (Key_value & 0x2000) Caracter = 8;
-  else if (Key_value & 0x0200) Caracter = 9;
-  else if (Key_value & 0x0020) Caracter = 67;
-  else if (Key_value & 0x0001) Caracter = 0;
-  else if (Key_value & 0x1000) Caracter = 70;
-  else if (Key_value & 0x0100) Caracter = 69;
-  else if (Key_value & 0x0010) Caracter = 68;
-  else Caracter = 0xFF;
+
+  if ((Key_value & GPIO_KEY_VALID) != 0){
+    Caracter = KeyValue[(Key_value >> 20) & 0xF];
+  }
   return Caracter;
 };
 
@@ -139,12 +139,17 @@ architecture neorv32_iCEBreaker_BoardTop_MinimalBoot_rtl of neorv32_iCEBreaker_B
 
   signal n_button_val : std_logic_vector(3 downto 0):="0000";
   signal c_button_val : std_logic_vector(3 downto 0):="0000";
-  signal Reset_signal : std_logic;
+  -- Power-on reset of the keypad: the iCE40 flip-flops start at 0, so the
+  -- keypad is held in reset for the first 15 cycles, then follows Button_3 --
+  signal c_por        : unsigned(3 downto 0) := (others => '0');
+  signal Reset_signal : std_logic := '1';
   
   signal c_counter : unsigned (1 downto 0):="00";
   signal n_counter : unsigned (1 downto 0):="00";
 
   signal s_Key_value : std_logic_vector(15 downto 0);
+  signal s_key_valid : std_logic;
+  signal s_key_index : std_logic_vector(3 downto 0);
 
 begin
 
@@ -299,17 +304,19 @@ begin
   peripheral_teclado_0: entity neorv32.peripheral_teclado
   port map(
     clk_i     => iCEBreakerv10_CLK,
-    reset_i   => iCEBreakerv10_PMOD2_10_Button_3,
+    reset_i   => Reset_signal,
     en_i      => '1',
-    Row_1_i   => iCEBreakerv10_PMOD1B_7,
-    Row_2_i   => iCEBreakerv10_PMOD1B_8, 
-    Row_3_i   => iCEBreakerv10_PMOD1B_9,     
-    Row_4_i   => iCEBreakerv10_PMOD1B_10, 
-    Col_1_o   => iCEBreakerv10_PMOD1B_1,
-    Col_2_o   => iCEBreakerv10_PMOD1B_2,
-    Col_3_o   => iCEBreakerv10_PMOD1B_3,
-    Col_4_o   => iCEBreakerv10_PMOD1B_4,     
-    Key_o     => s_key_value 
+    Row_i(0)  => iCEBreakerv10_PMOD1B_7,
+    Row_i(1)  => iCEBreakerv10_PMOD1B_8, 
+    Row_i(2)  => iCEBreakerv10_PMOD1B_9,     
+    Row_i(3)  => iCEBreakerv10_PMOD1B_10, 
+    Col_o(0)  => iCEBreakerv10_PMOD1B_1,
+    Col_o(1)  => iCEBreakerv10_PMOD1B_2,
+    Col_o(2)  => iCEBreakerv10_PMOD1B_3,
+    Col_o(3)  => iCEBreakerv10_PMOD1B_4,     
+    Key_o     => s_key_value,
+    Key_valid_o => s_key_valid,
+    Key_index_o => s_key_index
     );
 
   -- -------------------------------------------------------------------------------------------
@@ -321,10 +328,24 @@ begin
   iCEBreakerv10_PMOD2_3_LED_down   <= gpio_o(3);
   iCEBreakerv10_PMOD2_7_LED_center <= gpio_o(4);  
 
-  gpio_i <= x"00000000000" &
+  gpio_i <= "000" & x"000000000" &
+            s_key_valid &
+            s_key_index &
             s_key_value &
             c_button_val;
 
+  -- Keypad reset: power-on or Button_3
+  por_sinc: process(iCEBreakerv10_CLK)
+  begin
+    if rising_edge(iCEBreakerv10_CLK) then
+      if (c_por /= 15) then
+        c_por <= c_por + 1;
+      end if;
+    end if;
+  end process;
+
+  Reset_signal <= '1' when (c_por /= 15) or (iCEBreakerv10_PMOD2_10_Button_3 = '1') else '0';
+
   -- -------------------------------------------------------------------------------------------
   -- Buttom process
   -- -------------------------------------------------------------------------------------------
@@ -40,6 +40,7 @@
  **************************************************************************/
 
 #include <neorv32.h>
+#include <stdarg.h>
 
 
 /************************************************************************//**
@@ -50,13 +51,19 @@
 #define WB_REG1_OFFSET 0x04
 #define WB_REG2_OFFSET 0x08
 #define WB_REG3_OFFSET 0x0C
+#define WB_REG13_OFFSET 0x34
+
+#define WB_KEY_VALID 0x80000000 // REG13: a key is pressed
+#define WB_KEY_CODE  0x000000FF // REG13: code of the key from the keymap
 
 /**********************************************************************//**
  * @name User configuration
  **************************************************************************/
 /**@{*/
-/** UART BAUD rate */
-#define BAUD_RATE 19200
+/** UART BAUD rate (12 MHz / 115200 = 104.2, 0.2% error) */
+#define BAUD_RATE 115200
+/** UART0 log: size of the transmit ring buffer in bytes, has to be a power of two */
+#define LOG_BUFFER_SIZE 256
 /** Use the custom ASM version for blinking the LEDs defined (= uncommented) */
 //#define USE_ASM_VERSION
 /**@}*/
@@ -65,10 +72,11 @@
  * Global variables:
  * *************************************************************************/
   uint64_t Button_value;
-  uint8_t KeyValue[16] = {  0 ,  7 ,  4 ,  1,
-                           68 , 67 , 66 , 65,
-                           69 ,  9 ,  6 ,  3,
-                           70 ,  8 ,  5 ,  2 };
+  char Log_buffer[LOG_BUFFER_SIZE];       // UART0 transmit ring buffer
+  volatile uint16_t Log_head = 0;         // Next free position, written by the main code
+  volatile uint16_t Log_tail = 0;         // Next character to send, written by the TX interrupt
+  volatile uint8_t Log_tx_active = 0;     // A character is being sent
+  volatile uint32_t Log_dropped = 0;      // Characters lost because the buffer was full
 
 
 
@@ -83,6 +91,16 @@ extern void blink_led_asm(uint32_t gpio_out_addr);
 uint8_t Lee_teclado(void);
 uint8_t compara_valores(void);
 
+/**********************************************************************//**
+ * C functions of the non-blocking UART0 log
+ **************************************************************************/
+void Log_setup(void);
+void Log_print(const char *Texto);
+void Log_printf(const char *Formato, ...);
+void Log_putc(char Caracter);
+void Log_kick(void);
+void Uart_tx_irq_handler(void);
+
 
 int main() {
 
@@ -98,7 +116,11 @@ int main() {
 
   neorv32_rte_setup();
 
-  neorv32_uart0_print("Program iniciated\n");
+  // non-blocking log: characters are sent from the UART0 TX interrupt
+  Log_setup();
+  neorv32_cpu_eint();
+
+  Log_print("Program iniciated\n");
 
   uint8_t Key_value = 0xFF; 
   uint8_t q_key_value = 0xFF;
@@ -124,7 +146,7 @@ int main() {
            int decimal = 0;
            decimal = Key_value;
            total_value = total_value*10 + decimal;
-           neorv32_uart0_printf("Clave introducida: %u\n",total_value);
+           Log_printf("Clave introducida: %u\n",total_value);
            neorv32_cpu_store_unsigned_word (WB_BASE_ADDRESS + WB_REG1_OFFSET, total_value);
         }
 
@@ -132,24 +154,24 @@ int main() {
         else if(Key_value > 64 && Key_value < 71){
            if(Key_value == 70)
            {
-            neorv32_uart0_print("Cambio de clave realizado\n");
+            Log_print("Cambio de clave realizado\n");
             neorv32_cpu_store_unsigned_word (WB_BASE_ADDRESS + WB_REG3_OFFSET, total_value);
             total_value = 0;
             
            }
            else if(Key_value == 69)
            {
-            neorv32_uart0_print("Comprobacion de la clave\n");
+            Log_print("Comprobacion de la clave\n");
             neorv32_cpu_store_unsigned_word (WB_BASE_ADDRESS + WB_REG2_OFFSET, 0x00000001);
             total_value = 0;
             compara_valores();
            }
         }
         q_key_value = Key_value;
-        neorv32_uart0_printf("Reg0: %u\n",registro0);
-        neorv32_uart0_printf("Reg1: %u\n",registro1);
-        neorv32_uart0_printf("Reg2: %u\n",registro2);
-        neorv32_uart0_printf("Reg3: %u\n",registro3);
+        Log_printf("Reg0: %u\n",registro0);
+        Log_printf("Reg1: %u\n",registro1);
+        Log_printf("Reg2: %u\n",registro2);
+        Log_printf("Reg3: %u\n",registro3);
       }
     }
     else{
@@ -162,19 +184,13 @@ int main() {
 uint8_t Lee_teclado(void){
   uint32_t Key_value = 0;
   uint8_t Caracter = 0xFF;
-  uint16_t Mask_Char;
-  uint8_t i = 0;
 
-  //Read register 0
-  Key_value = neorv32_cpu_load_unsigned_word (WB_BASE_ADDRESS + WB_REG0_OFFSET) & 0x0000FFFF; 
+  //Read register 13, the hardware decodes the key with its keymap
+  Key_value = neorv32_cpu_load_unsigned_word (WB_BASE_ADDRESS + WB_REG13_OFFSET); 
 
   // If the user push a key:
-  if (Key_value != 0x00000000){
-    // Read the key value:
-    for (i=0, Mask_Char = 0x0001 ; i<16 ; i++){
-      Caracter = (Key_value & Mask_Char) != 0 ? KeyValue[i] : Caracter;
-      Mask_Char = (Mask_Char << 1);
-    }
+  if ((Key_value & WB_KEY_VALID) != 0){
+    Caracter = (uint8_t)(Key_value & WB_KEY_CODE);
     // Reset the register 0
       neorv32_cpu_store_unsigned_word (WB_BASE_ADDRESS + WB_REG0_OFFSET, 0x00000000); 
   }
@@ -182,6 +198,113 @@ uint8_t Lee_teclado(void){
   return Caracter;
 };
 
+void Log_setup(void){
+
+  neorv32_rte_exception_install(UART0_TX_RTE_ID, Uart_tx_irq_handler);
+  neorv32_cpu_irq_enable(UART0_TX_FIRQ_ENABLE);
+};
+
+void Log_putc(char Caracter){
+
+  uint16_t Next = (Log_head + 1) & (LOG_BUFFER_SIZE - 1);
+
+  //Never wait for the UART: drop the character if the buffer is full
+  if (Next == Log_tail){
+    Log_dropped++;
+  }
+  else{
+    Log_buffer[Log_head] = Caracter;
+    Log_head = Next;
+  }
+};
+
+void Log_kick(void){
+
+  //Start the transmission if the UART is idle, the interrupt sends the rest
+  neorv32_cpu_dint();
+  if (Log_tx_active == 0 && Log_tail != Log_head){
+    Log_tx_active = 1;
+    neorv32_uart0_putc(Log_buffer[Log_tail]);
+    Log_tail = (Log_tail + 1) & (LOG_BUFFER_SIZE - 1);
+  }
+  neorv32_cpu_eint();
+};
+
+void Log_print(const char *Texto){
+
+  while (*Texto != 0){
+    Log_putc(*Texto++);
+  }
+  Log_kick();
+};
+
+void Log_printf(const char *Formato, ...){
+
+  va_list Args;
+  char Digitos[10];
+  const char *Texto;
+  uint32_t Numero;
+  uint8_t Base;
+  uint8_t i;
+
+  va_start(Args, Formato);
+  while (*Formato != 0){
+    if (*Formato != '%'){
+      Log_putc(*Formato++);
+      continue;
+    }
+    Formato++;
+    switch (*Formato){
+      case 's':
+        Texto = va_arg(Args, const char *);
+        while (*Texto != 0){Log_putc(*Texto++);}
+        break;
+      case 'c':
+        Log_putc((char)va_arg(Args, int));
+        break;
+      case 'd':
+      case 'i':
+      case 'u':
+      case 'x':
+        Numero = va_arg(Args, uint32_t);
+        Base = (*Formato == 'x') ? 16 : 10;
+        if (*Formato != 'u' && *Formato != 'x' && (int32_t)Numero < 0){
+          Log_putc('-');
+          Numero = -Numero;
+        }
+        i = 0;
+        do{
+          Digitos[i++] = "0123456789abcdef"[Numero % Base];
+          Numero = Numero / Base;
+        } while (Numero != 0);
+        while (i != 0){Log_putc(Digitos[--i]);}
+        break;
+      case 0:
+        Formato--;
+        break;
+      default:
+        Log_putc(*Formato);
+        break;
+    }
+    Formato++;
+  }
+  va_end(Args);
+  Log_kick();
+};
+
+void Uart_tx_irq_handler(void){
+
+  //Acknowledge the interrupt and send the next character, if any
+  neorv32_cpu_csr_write(CSR_MIP, ~(1 << UART0_TX_FIRQ_PENDING));
+  if (Log_tail != Log_head){
+    neorv32_uart0_putc(Log_buffer[Log_tail]);
+    Log_tail = (Log_tail + 1) & (LOG_BUFFER_SIZE - 1);
+  }
+  else{
+    Log_tx_active = 0;
+  }
+};
+
 uint8_t compara_valores(void){
   uint32_t password = 0;
   uint32_t introducido = 0;
@@ -197,7 +320,7 @@ uint8_t compara_valores(void){
     // Read the key value:
     if(introducido == password)
     {
-      neorv32_uart0_print("\nCLave correcta\n");
+      Log_print("\nCLave correcta\n");
       // Reset the register 1
       neorv32_cpu_store_unsigned_word (WB_BASE_ADDRESS + WB_REG2_OFFSET, 0x00000000); 
       neorv32_cpu_store_unsigned_word (WB_BASE_ADDRESS + WB_REG1_OFFSET, 0x00000000);
@@ -208,7 +331,7 @@ uint8_t compara_valores(void){
     }
     else
     {
-      neorv32_uart0_print("\nClave incorrecta\n");
+      Log_print("\nClave incorrecta\n");
       // Reset the register 1
       neorv32_cpu_store_unsigned_word (WB_BASE_ADDRESS + WB_REG2_OFFSET, 0x00000000);
       neorv32_cpu_store_unsigned_word (WB_BASE_ADDRESS + WB_REG1_OFFSET, 0x00000000);
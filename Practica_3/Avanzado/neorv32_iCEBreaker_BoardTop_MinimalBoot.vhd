@@ -156,6 +156,11 @@ architecture neorv32_iCEBreaker_BoardTop_MinimalBoot_rtl of neorv32_iCEBreaker_B
   signal wb_ack_s2m   : std_ulogic;                     -- Transfer Ack
   signal wb_err_s2m   : std_ulogic;                     -- Transfer error
 
+  -- Power-on reset of the keypad: the iCE40 flip-flops start at 0, so the
+  -- keypad is held in reset for the first 15 cycles, then follows Button_3 --
+  signal c_por        : unsigned(3 downto 0) := (others => '0');
+  signal Reset_signal : std_logic := '1';
+
 begin
 
   -- -------------------------------------------------------------------------------------------
@@ -308,10 +313,10 @@ begin
 
   peripheral_teclado_0: entity neorv32.wb_peripheral_teclado
   generic map(WB_ADDR_BASE   => x"90000000",
-              WB_ADDR_SIZE   => 32 )    
+              WB_ADDR_SIZE   => 128 )    
   port map(
     clk_i     => std_ulogic(iCEBreakerv10_CLK),
-    reset_i   => iCEBreakerv10_PMOD2_10_Button_3,
+    reset_i   => Reset_signal,
     en_i      => '1',
 
     wb_tag_i  => wb_tag_m2s,     -- request tag
@@ -326,14 +331,14 @@ begin
     wb_ack_o  => wb_ack_s2m,     -- transfer acknowledge
     wb_err_o  => wb_err_s2m,     -- transfer error
 
-    Row_1_i   => std_ulogic(iCEBreakerv10_PMOD1B_7),
-    Row_2_i   => std_ulogic(iCEBreakerv10_PMOD1B_8), 
-    Row_3_i   => std_ulogic(iCEBreakerv10_PMOD1B_9),     
-    Row_4_i   => std_ulogic(iCEBreakerv10_PMOD1B_10), 
-    Col_1_o   => iCEBreakerv10_PMOD1B_1,
-    Col_2_o   => iCEBreakerv10_PMOD1B_2,
-    Col_3_o   => iCEBreakerv10_PMOD1B_3,
-    Col_4_o   => iCEBreakerv10_PMOD1B_4     
+    Row_i(0)  => std_ulogic(iCEBreakerv10_PMOD1B_7),
+    Row_i(1)  => std_ulogic(iCEBreakerv10_PMOD1B_8), 
+    Row_i(2)  => std_ulogic(iCEBreakerv10_PMOD1B_9),     
+    Row_i(3)  => std_ulogic(iCEBreakerv10_PMOD1B_10), 
+    Col_o(0)  => iCEBreakerv10_PMOD1B_1,
+    Col_o(1)  => iCEBreakerv10_PMOD1B_2,
+    Col_o(2)  => iCEBreakerv10_PMOD1B_3,
+    Col_o(3)  => iCEBreakerv10_PMOD1B_4     
     );
 
   -- -------------------------------------------------------------------------------------------
@@ -348,6 +353,18 @@ begin
   gpio_i <= x"000000000000000"  &
             c_button_val;
 
+  -- Keypad reset: power-on or Button_3
+  por_sinc: process(iCEBreakerv10_CLK)
+  begin
+    if rising_edge(iCEBreakerv10_CLK) then
+      if (c_por /= 15) then
+        c_por <= c_por + 1;
+      end if;
+    end if;
+  end process;
+
+  Reset_signal <= '1' when (c_por /= 15) or (iCEBreakerv10_PMOD2_10_Button_3 = '1') else '0';
+
   -- -------------------------------------------------------------------------------------------
   -- Buttom process
   -- -------------------------------------------------------------------------------------------
@@ -50,6 +50,10 @@
 #define WB_REG1_OFFSET 0x04
 #define WB_REG2_OFFSET 0x08
 #define WB_REG3_OFFSET 0x0C
+#define WB_REG13_OFFSET 0x34
+
+#define WB_KEY_VALID 0x80000000 // REG13: a key is pressed
+#define WB_KEY_CODE  0x000000FF // REG13: code of the key from the keymap
 
 /**********************************************************************//**
  * @name User configuration
@@ -65,10 +69,6 @@
  * Global variables:
  * *************************************************************************/
   uint64_t Button_value;
-  uint8_t KeyValue[16] = {  0 ,  7 ,  4 ,  1,
-                           68 , 67 , 66 , 65,
-                           69 ,  9 ,  6 ,  3,
-                           70 ,  8 ,  5 ,  2 };
 
 
 
@@ -126,19 +126,13 @@ int main() {
 uint8_t Lee_teclado(void){
   uint32_t Key_value = 0;
   uint8_t Caracter = 0xFF;
-  uint16_t Mask_Char;
-  uint8_t i = 0;
 
-  //Read register 0
-  Key_value = neorv32_cpu_load_unsigned_word (WB_BASE_ADDRESS + WB_REG0_OFFSET) & 0x0000FFFF; 
+  //Read register 13, the hardware decodes the key with its keymap
+  Key_value = neorv32_cpu_load_unsigned_word (WB_BASE_ADDRESS + WB_REG13_OFFSET); 
 
   // If the user push a key:
-  if (Key_value != 0x00000000){
-    // Read the key value:
-    for (i=0, Mask_Char = 0x0001 ; i<16 ; i++){
-      Caracter = (Key_value & Mask_Char) != 0 ? KeyValue[i] : Caracter;
-      Mask_Char = (Mask_Char << 1);
-    }
+  if ((Key_value & WB_KEY_VALID) != 0){
+    Caracter = (uint8_t)(Key_value & WB_KEY_CODE);
     // Reset the register 0
       neorv32_cpu_store_unsigned_word (WB_BASE_ADDRESS + WB_REG0_OFFSET, 0x00000000); 
   }
@@ -0,0 +1,21 @@
+// Generated by genera_claves.py, do not edit
+#ifndef CLAVES_H
+#define CLAVES_H
+
+#define CLAVES_NUM 4
+#define CLAVES_BLOOM_BITS 256
+
+// Sorted by code: {codigo, usuario, flags, puertas}
+const Clave_t Claves[CLAVES_NUM] = {
+  {0x12345678,     1, 0x01, 0x01},
+  {0x20240917,     2, 0x00, 0x01},
+  {0x31415926,     3, 0x01, 0x02},
+  {0x75123456,     0, 0x03, 0xFF},
+};
+
+// Bloom prefilter, two bits per code
+const uint32_t Claves_bloom[CLAVES_BLOOM_BITS/32] = {
+  0x00040000, 0x00000000, 0x00400000, 0x000C0000, 0x00400000, 0x00040000, 0x40000000, 0x00000800,
+};
+
+#endif // CLAVES_H
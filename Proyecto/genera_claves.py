@@ -0,0 +1,126 @@
+#!/usr/bin/env python3
+"""
+Builds the user code table of the lock firmware (claves.h).
+
+Input: CSV file, one user per line:  codigo,usuario[,flags[,puertas]]
+  codigo  : 8 digit code as typed on the keypad (hex, e.g. 75123456)
+  usuario : user number (0..65535)
+  flags   : bit 0 = enabled, bit 1 = master (default 1)
+  puertas : bit mask of the doors the user may open (default 0xFF)
+Lines starting with '#' are ignored.
+
+Output: C header with the table sorted by code (binary search in the
+firmware) and the Bloom prefilter bitmap. Both are 'const', so they are
+placed in IMEM together with the program and use no DMEM.
+
+  python3 genera_claves.py claves.csv -o claves.h
+  python3 genera_claves.py --random 2048 -o claves.h   # benchmark image
+"""
+
+import argparse
+import csv
+import random
+import sys
+
+BITS_POR_CLAVE = 16 # Bloom bits per code, ~1.4% false positives with two hashes
+
+
+def hash_clave(codigo):
+    """Same mixing as Hash_clave() in main.c"""
+    codigo ^= codigo >> 16
+    codigo = (codigo * 0x45D9F3B) & 0xFFFFFFFF
+    codigo ^= codigo >> 16
+    return codigo
+
+
+def lee_csv(fichero):
+    claves = []
+    with open(fichero, newline='') as f:
+        for fila in csv.reader(f):
+            if not fila or fila[0].strip().startswith('#'):
+                continue
+            codigo = int(fila[0], 16)
+            usuario = int(fila[1], 0)
+            flags = int(fila[2], 0) if len(fila) > 2 else 1
+            puertas = int(fila[3], 0) if len(fila) > 3 else 0xFF
+            claves.append((codigo, usuario, flags, puertas))
+    return claves
+
+
+def claves_aleatorias(numero, semilla):
+    # Codes only use the digits 0-9, as they are typed on the keypad
+    rnd = random.Random(semilla)
+    codigos = set()
+    while len(codigos) < numero:
+        codigos.add(int(''.join(rnd.choice('0123456789') for _ in range(8)), 16))
+    return [(c, u, 1, 0xFF) for u, c in enumerate(sorted(codigos))]
+
+
+def genera(claves, bloom_log2):
+    claves.sort(key=lambda c: c[0])
+    for a, b in zip(claves, claves[1:]):
+        if a[0] == b[0]:
+            sys.exit("genera_claves: code %08X is repeated" % a[0])
+
+    bits = 1 << bloom_log2
+    if bloom_log2 < 5 or bloom_log2 > 16:
+        sys.exit("genera_claves: the Bloom filter needs 2^5 to 2^16 bits, its indexes come from 16-bit halves")
+    bloom = [0] * (bits // 32)
+    for codigo, _, _, _ in claves:
+        h = hash_clave(codigo)
+        for i in (h & (bits - 1), (h >> 16) & (bits - 1)):
+            bloom[i >> 5] |= 1 << (i & 31)
+
+    lineas = []
+    lineas.append("// Generated by genera_claves.py, do not edit")
+    lineas.append("#ifndef CLAVES_H")
+    lineas.append("#define CLAVES_H")
+    lineas.append("")
+    lineas.append("#define CLAVES_NUM %d" % len(claves))
+    lineas.append("#define CLAVES_BLOOM_BITS %d" % bits)
+    lineas.append("")
+    lineas.append("// Sorted by code: {codigo, usuario, flags, puertas}")
+    lineas.append("const Clave_t Claves[CLAVES_NUM] = {")
+    for codigo, usuario, flags, puertas in claves:
+        lineas.append("  {0x%08X, %5d, 0x%02X, 0x%02X}," % (codigo, usuario, flags, puertas))
+    lineas.append("};")
+    lineas.append("")
+    lineas.append("// Bloom prefilter, two bits per code")
+    lineas.append("const uint32_t Claves_bloom[CLAVES_BLOOM_BITS/32] = {")
+    for i in range(0, len(bloom), 8):
+        lineas.append("  " + " ".join("0x%08X," % w for w in bloom[i:i+8]))
+    lineas.append("};")
+    lineas.append("")
+    lineas.append("#endif // CLAVES_H")
+    return "\n".join(lineas) + "\n"
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Builds the user code table of the lock firmware")
+    parser.add_argument("csv", nargs="?", help="CSV file: codigo,usuario[,flags[,puertas]]")
+    parser.add_argument("-o", "--salida", default="claves.h", help="output header (default claves.h)")
+    parser.add_argument("--random", type=int, metavar="N", help="N random codes instead of the CSV file")
+    parser.add_argument("--seed", type=int, default=1, help="seed of --random")
+    parser.add_argument("--bloom-log2", type=int, help="log2 of the Bloom filter bits (default: 16 bits per code)")
+    args = parser.parse_args()
+
+    if args.random is not None:
+        claves = claves_aleatorias(args.random, args.seed)
+    elif args.csv is not None:
+        claves = lee_csv(args.csv)
+    else:
+        parser.error("a CSV file or --random is needed")
+
+    if len(claves) == 0:
+        sys.exit("genera_claves: no codes")
+
+    bloom_log2 = args.bloom_log2
+    if bloom_log2 is None:
+        bloom_log2 = min(max((len(claves) * BITS_POR_CLAVE - 1).bit_length(), 8), 16)
+
+    with open(args.salida, "w") as f:
+        f.write(genera(claves, bloom_log2))
+
+
+if __name__ == "__main__":
+    main()
@@ -40,6 +40,8 @@
  **************************************************************************/
 
 #include <neorv32.h>
+#include <stdarg.h>
+#include <stddef.h>
 
 
 /************************************************************************//**
@@ -51,22 +53,140 @@
 #define WB_TECLADO_REG2_OFFSET 0x08
 #define WB_TECLADO_REG3_OFFSET 0x0C
 #define WB_TECLADO_REG4_OFFSET 0x10
+#define WB_TECLADO_REG5_OFFSET 0x14
+#define WB_TECLADO_REG6_OFFSET 0x18
+#define WB_TECLADO_REG7_OFFSET 0x1C
+#define WB_TECLADO_REG8_OFFSET 0x20
+#define WB_TECLADO_REG9_OFFSET 0x24
+#define WB_TECLADO_REG10_OFFSET 0x28
+#define WB_TECLADO_REG11_OFFSET 0x2C
+#define WB_TECLADO_REG12_OFFSET 0x30
+#define WB_TECLADO_REG13_OFFSET 0x34
+#define WB_TECLADO_REG14_OFFSET 0x38
+#define WB_TECLADO_REG18_OFFSET 0x48
+#define WB_TECLADO_REG27_OFFSET 0x6C // REG2 write 1 to set
+#define WB_TECLADO_REG28_OFFSET 0x70 // REG2 write 1 to clear
+#define WB_TECLADO_REG29_OFFSET 0x74 // byte i: byte i of REG1 and command i of REG2
+#define WB_TECLADO_REG30_OFFSET 0x78 // status snapshot
+#define WB_TECLADO_REG31_OFFSET 0x7C // status read-to-clear mask
+#define WB_TECLADO_REG48_OFFSET 0xC0 // lock engine control
+#define WB_TECLADO_REG50_OFFSET 0xC8 // lock engine windows
+#define WB_TECLADO_REG51_OFFSET 0xCC // lock engine reset and alarm codes
+#define WB_TECLADO_REG52_OFFSET 0xD0 // lock engine counters
 
-#define WB_DISPLAY_BASE_ADDRESS 0x90000020 
+#define WB_TECLADO_IRQ_KEY_EN   0x00000001 // REG5: key pressed interrupt enable
+#define WB_TECLADO_IRQ_CMP_EN   0x00000002 // REG5: compare done interrupt enable
+#define WB_TECLADO_IRQ_KEY_PEND 0x00000100 // REG5: key pressed pending (write 1 to clear)
+#define WB_TECLADO_IRQ_CMP_PEND 0x00000200 // REG5: compare done pending (write 1 to clear)
+#define WB_TECLADO_CMP_RESULT   0x0000000F // REG4: bytes A/B/C/D matched
+#define WB_TECLADO_CMP_DONE     0x00000100 // REG4: last compare command finished
+#define WB_TECLADO_CMP_MATCH    0x00000200 // REG4: every commanded byte matched
+#define WB_TECLADO_FIFO_VALID   0x80000000 // REG6: popped entry holds a key
+#define WB_TECLADO_FIFO_CODE    0x00FF0000 // REG6: code of the popped key from the keymap
+#define WB_TECLADO_KEY_VALID    0x80000000 // REG13: a key is pressed
+#define WB_TECLADO_KEY_CODE     0x000000FF // REG13: code of the pressed key from the keymap
+#define WB_TECLADO_CHORD_EN     0x80000000 // REG18+i: chord i enabled
+#define WB_TECLADO_FIFO_FLUSH   0x00000001 // REG7: discard all stored keys
+#define WB_TECLADO_FIFO_OVF     0x00010000 // REG7: a key was lost (write 1 to clear)
+#define WB_TECLADO_CAM_HIT      0x80000000 // REG12: REG1 matches an enabled code slot
+#define WB_TECLADO_CAM_INDEX    0x0000003F // REG12: lowest matching slot
+#define WB_TECLADO_ST_FIFO      0x80000000 // REG30: the fifo holds keys
+#define WB_TECLADO_ST_OVF       0x40000000 // REG30: a key was lost
+#define WB_TECLADO_ST_COMANDOS  0x0F000000 // REG30: commands A/B/C/D given
+#define WB_TECLADO_ST_RESULT    0x00F00000 // REG30: bytes A/B/C/D matched
+#define WB_TECLADO_ST_CMP_DONE  0x00080000 // REG30: last compare command finished
+#define WB_TECLADO_ST_RESULT_A  0x00100000 // REG30: byte A matched, B/C/D on the next bits
+#define WB_TECLADO_LOCK_RUN     0x00000001 // REG48: lock engine running
+#define WB_TECLADO_LOCK_IRQ_EN  0x00000002 // REG48: door open / lockout interrupt enable
+#define WB_TECLADO_LOCK_OPEN    0x00000100 // REG48: door opened (write 1 to clear)
+#define WB_TECLADO_LOCK_FAIL    0x00000200 // REG48: lockout (write 1 to clear)
+
+#define WB_DISPLAY_BASE_ADDRESS 0x90000100
 #define WB_DISPLAY_REG0_OFFSET 0x00
 #define WB_DISPLAY_REG1_OFFSET 0x04
 #define WB_DISPLAY_REG2_OFFSET 0x08
+#define WB_DISPLAY_REG3_OFFSET 0x0C
+#define WB_DISPLAY_REG4_OFFSET 0x10
+#define WB_DISPLAY_REG5_OFFSET 0x14
+#define WB_DISPLAY_REG12_OFFSET 0x30
+#define WB_DISPLAY_REG13_OFFSET 0x34
+#define WB_DISPLAY_REG16_OFFSET 0x40
+#define WB_DISPLAY_MENSAJE      0x00000002 // REG2: show the message buffer
+#define WB_DISPLAY_PARPADEO     0x00000010 // REG2: blink
+#define WB_DISPLAY_DESPLAZA     0x00000020 // REG2: scroll the message
+#define WB_DISPLAY_AUTOBORRADO  0x00000040 // REG2: back to dashes after REG12 ms
 
 /**********************************************************************//**
  * @name User configuration
  **************************************************************************/
 /**@{*/
-/** UART BAUD rate */
-#define BAUD_RATE 19200
+/** UART BAUD rate (12 MHz / 115200 = 104.2, 0.2% error) */
+#define BAUD_RATE 115200
+/** UART0 log: size of the transmit ring buffer in bytes, has to be a power of two */
+#define LOG_BUFFER_SIZE 256
+/** XIRQ channel of the keypad key pressed interrupt */
+#define KEYPAD_XIRQ_CH 0
+/** Keypad debounce: scan frames (1 ms each) a key has to be stable */
+#define KEYPAD_SETTLE_FRAMES 5
+/** Emergency chord: E and F pressed together (One Hot keys 8 and 12), reported as code 71.
+ *  E or F alone waits 50 ms (CHORD_WINDOW) in the keypad for the other one, so E does not reset first */
+#define ACORDE_EMERGENCIA (WB_TECLADO_CHORD_EN | (71 << 16) | 0x1100)
+/** Door of this lock, bit of the puertas mask of the user code table */
+#define PUERTA 0x01
+/** Slots of the keypad code bank, CAM_SLOTS of wb_peripheral_teclado */
+#define CLAVES_BANCO 16
+/** MTIME ticks per millisecond (MTIME counts the 12 MHz processor clock) */
+#define TIMER_TICKS_PER_MS (12000000/1000)
 /** Use the custom ASM version for blinking the LEDs defined (= uncommented) */
 //#define USE_ASM_VERSION
+/** Measure the user code lookup at start-up defined (= uncommented), build claves.h with genera_claves.py --random 2048 */
+//#define BENCHMARK_CLAVES
+/** Measure the software and the hardware key decode at start-up defined (= uncommented) */
+//#define BENCHMARK_TECLADO
+/** Lock sequence run by the keypad lock engine instead of the firmware defined (= uncommented), needs KEYPAD_LOCK_EN = true in the top */
+//#define CERRADURA_HW
+/** Keypad inside the CFS defined (= uncommented), needs the KEYPAD_CFS=1 build of the hardware (KEYPAD_CFS generic of the top) */
+//#define TECLADO_CFS
 /**@}*/
 
+#ifdef TECLADO_CFS
+#if defined(CERRADURA_HW)
+#error "The lock engine is not implemented in the CFS keypad"
+#endif
+// Same registers REG0-REG31 in the CFS window of the processor-internal IO bus
+#undef  WB_TECLADO_BASE_ADDRESS
+#define WB_TECLADO_BASE_ADDRESS 0xFFFFFE00
+#endif
+
+/************************************************************************//**
+ * Software timers:
+ * *************************************************************************/
+#define NUM_TIMERS    4
+#define TIMER_ESPERA  0 // Timeouts of the lock state machine
+
+typedef struct {
+  uint64_t deadline;          // MTIME value of the next expiration
+  uint64_t period;            // Ticks between expirations of a periodic timer
+  uint8_t  periodic;          // 0 = one-shot, 1 = periodic
+  volatile uint8_t active;
+  volatile uint8_t expired;
+} Timer_t;
+
+/************************************************************************//**
+ * User code table: built by genera_claves.py, lives in IMEM (const)
+ * *************************************************************************/
+#define CLAVE_ACTIVA  0x01 // flags: the code can be used
+#define CLAVE_MAESTRA 0x02 // flags: master user
+
+typedef struct {
+  uint32_t codigo;            // Code as typed on the keypad, table sorted by it
+  uint16_t usuario;           // User number
+  uint8_t  flags;             // CLAVE_ACTIVA, CLAVE_MAESTRA
+  uint8_t  puertas;           // Doors the user may open, one bit each
+} Clave_t;
+
+#include "claves.h"
+
 /************************************************************************//**
  * Global variables:
  * *************************************************************************/
@@ -75,6 +195,17 @@
                            68 , 67 , 66 , 65,
                            69 ,  9 ,  6 ,  3,
                            70 ,  8 ,  5 ,  2 };
+  volatile uint8_t Wake_event = 0; // Set by every interrupt, the main loop sleeps while it is clear
+  Timer_t Timers[NUM_TIMERS];
+  uint16_t Banco_claves[CLAVES_BANCO];    // Index in Claves[] of the code in every slot of the keypad code bank
+  char Log_buffer[LOG_BUFFER_SIZE];       // UART0 transmit ring buffer
+  volatile uint16_t Log_head = 0;         // Next free position, written by the main code
+  volatile uint16_t Log_tail = 0;         // Next character to send, written by the TX interrupt
+  volatile uint8_t Log_tx_active = 0;     // A character is being sent
+  volatile uint32_t Log_dropped = 0;      // Characters lost because the buffer was full
+  // Segments of the display characters (bit 0 = a ... bit 6 = g): 0-9, 10 = C, 11 = L, 12 = P
+  const uint8_t Segmentos[13] = { 0x3F, 0x06, 0x5B, 0x4F, 0x66, 0x6D, 0x7D, 0x07, 0x7F, 0x6F,
+                                  0x39, 0x38, 0x73 };
 
 
 
@@ -86,8 +217,53 @@ extern void blink_led_asm(uint32_t gpio_out_addr);
 /**********************************************************************//**
  * C function to read the Keypad
  **************************************************************************/
-uint8_t Lee_teclado(void);
+uint8_t Lee_teclado(uint32_t Estado);
+void Comando_teclado(uint8_t Byte, uint8_t Valor);
+void Reset_teclado(void);
 void Represent_Display(uint8_t Decenas, uint8_t Centenas, uint8_t Enable);
+void Mensaje_display(const char *Texto, uint16_t Tiempo_ms, uint32_t Efectos);
+void Guarda_clave(uint8_t Slot, uint32_t Clave);
+uint8_t Busca_clave(void);
+void Carga_claves(void);
+
+/**********************************************************************//**
+ * C functions of the user code table
+ **************************************************************************/
+uint32_t Hash_clave(uint32_t Codigo);
+const Clave_t *Busca_usuario(uint32_t Codigo);
+void Benchmark_claves(void);
+void Benchmark_teclado(void);
+
+/**********************************************************************//**
+ * C functions of the software timers (cooperative scheduler on MTIME)
+ **************************************************************************/
+void Timer_start(uint8_t Id, uint32_t Time_ms, uint8_t Periodic);
+uint8_t Timer_expired(uint8_t Id);
+void Timer_program(void);
+void Espera_evento(void);
+
+/**********************************************************************//**
+ * C functions of the non-blocking UART0 log
+ **************************************************************************/
+void Log_setup(void);
+void Log_print(const char *Texto);
+void Log_printf(const char *Formato, ...);
+void Log_putc(char Caracter);
+void Log_kick(void);
+void Uart_tx_irq_handler(void);
+
+/**********************************************************************//**
+ * Interrupt handlers of the keypad and the machine timer
+ **************************************************************************/
+void Teclado_irq_handler(void);
+void Teclado_cfs_irq_handler(void);
+void Cerradura_irq_handler(void);
+void Timer_irq_handler(void);
+
+/**********************************************************************//**
+ * C function of the lock engine mode
+ **************************************************************************/
+void Cerradura_hw(void);
 
 
 int main() {
@@ -102,12 +278,53 @@ int main() {
     return 1; // nope, no GPIO unit synthesized
   }
 
+#ifdef TECLADO_CFS
+  // check if the keypad CFS is implemented at all (KEYPAD_CFS=1 build)
+  if (neorv32_cfs_available() == 0) {
+    neorv32_uart0_print("Error! No CFS synthesized, the keypad is on Wishbone!\n");
+    return 1;
+  }
+#endif
+
   neorv32_rte_setup();
 
-  neorv32_uart0_print("Program iniciated\n");
+  // non-blocking log: characters are sent from the UART0 TX interrupt
+  Log_setup();
+
+#ifdef TECLADO_CFS
+  // key pressed interrupt of the keypad on the CFS fast interrupt
+  neorv32_rte_exception_install(CFS_RTE_ID, Teclado_cfs_irq_handler);
+  neorv32_cpu_irq_enable(CFS_FIRQ_ENABLE);
+#else
+  // key pressed interrupt of the keypad through the external interrupt controller
+  neorv32_xirq_setup();
+#ifdef CERRADURA_HW
+  neorv32_xirq_install(KEYPAD_XIRQ_CH, Cerradura_irq_handler);
+#else
+  neorv32_xirq_install(KEYPAD_XIRQ_CH, Teclado_irq_handler);
+#endif
+  neorv32_xirq_global_enable();
+#endif
+
+  // machine timer interrupt drives the software timers, none armed yet
+  neorv32_mtime_set_timecmp(0xFFFFFFFFFFFFFFFFULL);
+  neorv32_rte_exception_install(RTE_TRAP_MTI, Timer_irq_handler);
+  neorv32_cpu_irq_enable(CSR_MIE_MTIE);
+  neorv32_cpu_eint();
+
+  Log_print("Program iniciated\n");
+
+#ifdef BENCHMARK_CLAVES
+  Benchmark_claves();
+#endif
+#ifdef BENCHMARK_TECLADO
+  Benchmark_teclado();
+#endif
+#ifdef CERRADURA_HW
+  Cerradura_hw();
+#endif
 
   uint8_t Key_value = 0xFF;
-  uint8_t q_key_value = 0xFF;
   uint32_t total_value = 0;
   int estado = 10;
   int decena = 0;
@@ -116,229 +333,231 @@ int main() {
   uint8_t led3 = 0x04;
   uint8_t led4 = 0x08;
   uint8_t v_gpio = 0x00;
+  const Clave_t *Usuario;
+  uint8_t Slot;
 
   neorv32_cpu_store_unsigned_word (WB_TECLADO_BASE_ADDRESS + WB_TECLADO_REG0_OFFSET, 0x00000000);
   neorv32_cpu_store_unsigned_word (WB_TECLADO_BASE_ADDRESS + WB_TECLADO_REG1_OFFSET, 0x00000000);
   neorv32_cpu_store_unsigned_word (WB_TECLADO_BASE_ADDRESS + WB_TECLADO_REG2_OFFSET, 0x00000000);
   neorv32_cpu_store_unsigned_word (WB_TECLADO_BASE_ADDRESS + WB_TECLADO_REG4_OFFSET, 0x00000000);
   neorv32_cpu_store_unsigned_word (WB_TECLADO_BASE_ADDRESS + WB_TECLADO_REG3_OFFSET, 0x75123456);
+  neorv32_cpu_store_unsigned_word (WB_TECLADO_BASE_ADDRESS + WB_TECLADO_REG5_OFFSET, WB_TECLADO_IRQ_KEY_EN | WB_TECLADO_IRQ_CMP_EN);
+  neorv32_cpu_store_unsigned_word (WB_TECLADO_BASE_ADDRESS + WB_TECLADO_REG8_OFFSET, KEYPAD_SETTLE_FRAMES);
+  neorv32_cpu_store_unsigned_word (WB_TECLADO_BASE_ADDRESS + WB_TECLADO_REG18_OFFSET, ACORDE_EMERGENCIA);
+  Carga_claves();
   
   
 
   while(1){
-    //to know always whats happening on the registers
-    //uint32_t registro0 = neorv32_cpu_load_unsigned_word (WB_TECLADO_BASE_ADDRESS + WB_TECLADO_REG0_OFFSET);   
-    uint32_t registro1 = neorv32_cpu_load_unsigned_word (WB_TECLADO_BASE_ADDRESS + WB_TECLADO_REG1_OFFSET);   
-    uint32_t registro2 = neorv32_cpu_load_unsigned_word (WB_TECLADO_BASE_ADDRESS + WB_TECLADO_REG2_OFFSET);   
-    //uint32_t registro3 = neorv32_cpu_load_unsigned_word (WB_TECLADO_BASE_ADDRESS + WB_TECLADO_REG3_OFFSET);
-    uint32_t registro4 = neorv32_cpu_load_unsigned_word (WB_TECLADO_BASE_ADDRESS + WB_TECLADO_REG4_OFFSET);
-   
-    
+    //Interrupts after this point wake the sleep of this pass
+    Wake_event = 0;
+    //Everything the states need from the keypad in one bus read
+    uint32_t Estado_teclado = neorv32_cpu_load_unsigned_word (WB_TECLADO_BASE_ADDRESS + WB_TECLADO_REG30_OFFSET);
+
 
       switch(estado)
       {
         case 10: //Initial case-->waiting for caracters
-          if(registro4 == 0xF)
+          if((Estado_teclado & WB_TECLADO_ST_RESULT) == WB_TECLADO_ST_RESULT)
           {
             neorv32_cpu_store_unsigned_word (WB_TECLADO_BASE_ADDRESS + WB_TECLADO_REG4_OFFSET,0x00000000);
-            neorv32_uart0_printf("\nPuerta abierta, tiene 5s...\n");
-            Represent_Display(0,12,1);
-            neorv32_cpu_delay_ms(5000);
-            v_gpio = 0x00;
-            neorv32_gpio_port_set(0x20);
-            neorv32_gpio_port_set(0x00);
-            Represent_Display(0,12,0);
+            Log_print("\nPuerta abierta (clave maestra), tiene 5s...\n");
+            Mensaje_display("OP", 5000, 0); //The display clears itself after 5s
+            Timer_start(TIMER_ESPERA, 5000, 0);
+            estado = 11;
           }
           else{
-            //New pulse on the keypad
-            Key_value = Lee_teclado();
+            //Next pulse stored on the keypad fifo
+            Key_value = Lee_teclado(Estado_teclado);
             if(Key_value != 0xFF){
-              if(Key_value != q_key_value){
-                if(Key_value < 10){estado=0;}
-                else{estado = Key_value;} 
-                q_key_value = Key_value;
-              }            
+              if(Key_value < 10){estado=0;}
+              else{estado = Key_value;} 
             }
-            else{q_key_value = 0xFF;}
+            else{Espera_evento();}
+          }
+        break;
+
+        case 11: //Door open during 5s, the keys are discarded
+          if(Timer_expired(TIMER_ESPERA))
+          {
+            v_gpio = 0x00;
+            Reset_teclado();
+            estado = 10;
           }
+          else if(Lee_teclado(Estado_teclado) == 0xFF){Espera_evento();}
         break;
 
         case 0:  //Number
           Represent_Display(decena,Key_value,1);  //Displays the numbers
           total_value=(total_value<<4)+Key_value;   //Move units to tens
           total_value = total_value & 0xFF; //Take only last numbers and discard the rest
-          neorv32_uart0_printf("Total_value: %x\n",total_value);
+          Log_printf("Total_value: %x\n",total_value);
           decena = Key_value;
           estado = 10;
 
-          //Show registers to see how it works easier
-          //  neorv32_uart0_printf("Registro 1: %x\n",registro1);
-          //  neorv32_uart0_printf("Registro 2: %x\n",registro2);
-          //  neorv32_uart0_printf("Registro 3: %x\n",registro3);
-          //  neorv32_uart0_printf("Registro 4: %x\n",registro4);
+          //Show the keypad status to see how it works easier
+          //  Log_printf("Estado teclado: %x\n",Estado_teclado);
 
 
         break;
 
         //Case 65-69 only for letters
         case 65:  //A
-          registro1 = neorv32_cpu_load_unsigned_word (WB_TECLADO_BASE_ADDRESS + WB_TECLADO_REG1_OFFSET);
-          registro1 = registro1+total_value;  
-          neorv32_cpu_store_unsigned_word (WB_TECLADO_BASE_ADDRESS + WB_TECLADO_REG1_OFFSET, registro1);
-
-          registro2 = neorv32_cpu_load_unsigned_word (WB_TECLADO_BASE_ADDRESS + WB_TECLADO_REG2_OFFSET);
-          registro2 = registro2 + 1;
-          neorv32_cpu_store_unsigned_word (WB_TECLADO_BASE_ADDRESS + WB_TECLADO_REG2_OFFSET, registro2);
-
+          //Byte 0 of the user password and command A
+          Comando_teclado(0, total_value);
           estado = 1;
         break;
 
         case 66:  //B
-          registro1 = neorv32_cpu_load_unsigned_word (WB_TECLADO_BASE_ADDRESS + WB_TECLADO_REG1_OFFSET);
-          registro1 = registro1+(total_value<<8); //Writing on the correct position of the protocol specified
-          neorv32_cpu_store_unsigned_word (WB_TECLADO_BASE_ADDRESS + WB_TECLADO_REG1_OFFSET, registro1);
-
-          registro2 = neorv32_cpu_load_unsigned_word (WB_TECLADO_BASE_ADDRESS + WB_TECLADO_REG2_OFFSET);
-          registro2 = registro2 + 2;  //Signal to hardware to know we want to compare passwords
-          neorv32_cpu_store_unsigned_word (WB_TECLADO_BASE_ADDRESS + WB_TECLADO_REG2_OFFSET, registro2);
-
+          //Writing on the correct position of the protocol specified, the command tells the hardware to compare
+          Comando_teclado(1, total_value);
           estado = 2;
         break;
 
         case 67:  //C
-          registro1 = neorv32_cpu_load_unsigned_word (WB_TECLADO_BASE_ADDRESS + WB_TECLADO_REG1_OFFSET);
-          registro1 = registro1+(total_value<<16);
-          neorv32_cpu_store_unsigned_word (WB_TECLADO_BASE_ADDRESS + WB_TECLADO_REG1_OFFSET, registro1);
-
-          registro2 = neorv32_cpu_load_unsigned_word (WB_TECLADO_BASE_ADDRESS + WB_TECLADO_REG2_OFFSET);
-          registro2 = registro2 + 4;
-          neorv32_cpu_store_unsigned_word (WB_TECLADO_BASE_ADDRESS + WB_TECLADO_REG2_OFFSET, registro2);
-
+          Comando_teclado(2, total_value);
           estado = 3;
         break;
 
         case 68:  //D
-          registro1 = neorv32_cpu_load_unsigned_word (WB_TECLADO_BASE_ADDRESS + WB_TECLADO_REG1_OFFSET);
-          registro1 = registro1+(total_value<<24);
-          neorv32_cpu_store_unsigned_word (WB_TECLADO_BASE_ADDRESS + WB_TECLADO_REG1_OFFSET, registro1);
-
-          registro2 = neorv32_cpu_load_unsigned_word (WB_TECLADO_BASE_ADDRESS + WB_TECLADO_REG2_OFFSET);
-          registro2 = registro2 + 8;
-          neorv32_cpu_store_unsigned_word (WB_TECLADO_BASE_ADDRESS + WB_TECLADO_REG2_OFFSET, registro2);
-
+          Comando_teclado(3, total_value);
           estado = 4;
         break;
 
+        case 71:  //E+F chord-->Emergency, locked as after a wrong code
+          Log_print("\nAcorde de emergencia->Bloqueado\n");
+          Mensaje_display("CL", 3000, 0);  //-->CL, cleared by the display after 3s
+          neorv32_gpio_port_set(0x10);  //Red led
+          Timer_start(TIMER_ESPERA, 3000, 0);
+          estado = 12;
+        break;
+
         case 69:  //E-->Reset
-          neorv32_gpio_port_set(0x20);  //General reset except to reg3
-          neorv32_gpio_port_set(0x00);
-          neorv32_cpu_store_unsigned_word (WB_TECLADO_BASE_ADDRESS + WB_TECLADO_REG3_OFFSET, 0x75123456);
+          Reset_teclado();
           v_gpio = 0x00;
           estado = 10;
-          neorv32_uart0_print("\nVariables y claves reseteadas\n");
+          Log_print("\nVariables y claves reseteadas\n");
         break;
 
         case 1:  //Check A protocol
-          neorv32_cpu_delay_ms(500);
-          registro4 = neorv32_cpu_load_unsigned_word (WB_TECLADO_BASE_ADDRESS + WB_TECLADO_REG4_OFFSET);
-          if((registro4 & 1) != 0) //Condition specified on hardware
+          if((Estado_teclado & WB_TECLADO_ST_CMP_DONE) == 0){Espera_evento();}  //Woken up by the compare done interrupt
+          else if((Estado_teclado & (WB_TECLADO_ST_RESULT_A << 0)) != 0) //Condition specified on hardware
           {
-            neorv32_uart0_print("\nClave A correcta\n");
+            Log_print("\nClave A correcta\n");
             v_gpio = v_gpio+ led1;  //To not disturb other leds
             neorv32_gpio_port_set(v_gpio);
-            neorv32_cpu_delay_ms(1000);
-            Represent_Display(10,11,0);
-            decena = 0;
-            Key_value = 0xFF;
-            total_value=0;
-            estado = 10;
+            Timer_start(TIMER_ESPERA, 1000, 0);
+            estado = 6;
           }
           else
           {
             total_value=0;
-            estado = 5;
+            estado = 7;
           }
         break;
 
         case 2:  //Check B protocol
-          neorv32_cpu_delay_ms(500);
-          registro4 = neorv32_cpu_load_unsigned_word (WB_TECLADO_BASE_ADDRESS + WB_TECLADO_REG4_OFFSET);
-          if((registro4 & 2) != 0)
+          if((Estado_teclado & WB_TECLADO_ST_CMP_DONE) == 0){Espera_evento();}  //Woken up by the compare done interrupt
+          else if((Estado_teclado & (WB_TECLADO_ST_RESULT_A << 1)) != 0) //Condition specified on hardware
           {
-            neorv32_uart0_print("\nClave B correcta\n");
+            Log_print("\nClave B correcta\n");
             v_gpio = v_gpio+ led2;
             neorv32_gpio_port_set(v_gpio);
-            neorv32_cpu_delay_ms(1000);
-            Represent_Display(10,11,0); 
-            decena = 0;
-            Key_value = 0xFF;
-            total_value=0;
-            estado = 10;
+            Timer_start(TIMER_ESPERA, 1000, 0);
+            estado = 6;
           }
           else
           {
             total_value=0;
-            estado = 5;
+            estado = 7;
           }
         break;
 
         case 3:  //Check C protocol
-          registro4 = neorv32_cpu_load_unsigned_word (WB_TECLADO_BASE_ADDRESS + WB_TECLADO_REG4_OFFSET);
-          if((registro4 & 4) != 0)
+          if((Estado_teclado & WB_TECLADO_ST_CMP_DONE) == 0){Espera_evento();}  //Woken up by the compare done interrupt
+          else if((Estado_teclado & (WB_TECLADO_ST_RESULT_A << 2)) != 0)
           {
-            neorv32_uart0_print("\nClave C correcta\n");
+            Log_print("\nClave C correcta\n");
             v_gpio = v_gpio+ led3;
             neorv32_gpio_port_set(v_gpio);
-            neorv32_cpu_delay_ms(1000);
-            Represent_Display(10,11,0); 
-            decena = 0;
-            Key_value = 0xFF;
-            total_value=0;
-            estado = 10;
+            Timer_start(TIMER_ESPERA, 1000, 0);
+            estado = 6;
           }
           else
           {
             total_value=0;
-            estado = 5;
+            estado = 7;
           }
         break;
 
         case 4:  //Check D protocol
-          registro4 = neorv32_cpu_load_unsigned_word (WB_TECLADO_BASE_ADDRESS + WB_TECLADO_REG4_OFFSET);
-          if((registro4 & 8) != 0)
+          if((Estado_teclado & WB_TECLADO_ST_CMP_DONE) == 0){Espera_evento();}  //Woken up by the compare done interrupt
+          else if((Estado_teclado & (WB_TECLADO_ST_RESULT_A << 3)) != 0)
           {
-            neorv32_uart0_print("\nClave D correcta\n");
+            Log_print("\nClave D correcta\n");
             v_gpio = v_gpio+ led4;
             neorv32_gpio_port_set(v_gpio);
-            neorv32_cpu_delay_ms(1000);
-            Represent_Display(10,11,0); 
+            Timer_start(TIMER_ESPERA, 1000, 0);
+            estado = 6;
+          }
+          else
+          {
+            total_value=0;
+            estado = 7;
+          }
+        break;
+
+        case 6: //Correct code, shown during 1s
+          if(Timer_expired(TIMER_ESPERA))
+          {
+            Represent_Display(10,11,0);
             decena = 0;
             Key_value = 0xFF;
             total_value=0;
-            estado = 10;
+            estado = 7;
           }
+          else{Espera_evento();}
+        break;
+
+        case 7: //Byte stored: once the four are given and they are not the master code, the user code table decides
+          if((Estado_teclado & WB_TECLADO_ST_COMANDOS) != WB_TECLADO_ST_COMANDOS ||
+             (Estado_teclado & WB_TECLADO_ST_RESULT) == WB_TECLADO_ST_RESULT){estado = 10;}
           else
           {
-            total_value=0;
-            estado = 5;
+            //The code bank compares REG1 with its slots at once, the users left out of it go through the table
+            Slot = Busca_clave();
+            if(Slot < CLAVES_BANCO){Usuario = &Claves[Banco_claves[Slot]];}
+            else{Usuario = Busca_usuario(neorv32_cpu_load_unsigned_word (WB_TECLADO_BASE_ADDRESS + WB_TECLADO_REG1_OFFSET));}
+            if(Usuario != NULL && (Usuario->puertas & PUERTA) != 0)
+            {
+              Log_printf("\nPuerta abierta (usuario %u), tiene 5s...\n", Usuario->usuario);
+              Mensaje_display("OP", 5000, 0); //The display clears itself after 5s
+              Timer_start(TIMER_ESPERA, 5000, 0);
+              estado = 11;
+            }
+            else{estado = 5;}
           }
         break;
 
         case 5: //Fail
-          neorv32_uart0_print("\nClave incorrecta->Claves reseteadas\n");  
-          Represent_Display(10,11,1);  //-->CL   
+          Log_print("\nClave incorrecta->Claves reseteadas\n");  
+          Mensaje_display("CL", 3000, 0);  //-->CL, cleared by the display after 3s
           neorv32_gpio_port_set(0x10);  //Red led
-          neorv32_cpu_delay_ms(3000);
-          neorv32_gpio_port_set(0x20); //General reset except to reg3
-          neorv32_gpio_port_set(0x00);
-          neorv32_cpu_store_unsigned_word (WB_TECLADO_BASE_ADDRESS + WB_TECLADO_REG3_OFFSET, 0x75123456);
-          Represent_Display(10,11,0); //-->--
-          v_gpio = 0x00;
-          decena = 0;
-          Key_value = 0xFF;
-          total_value=0;
-          estado = 10;
+          Timer_start(TIMER_ESPERA, 3000, 0);
+          estado = 12;
+        break;
 
+        case 12: //Locked during 3s, the keys are discarded
+          if(Timer_expired(TIMER_ESPERA))
+          {
+            Reset_teclado();
+            v_gpio = 0x00;
+            decena = 0;
+            Key_value = 0xFF;
+            total_value=0;
+            estado = 10;
+          }
+          else if(Lee_teclado(Estado_teclado) == 0xFF){Espera_evento();}
         break;
       } 
  
@@ -347,48 +566,486 @@ int main() {
   return 0;
 }  
 
-uint8_t Lee_teclado(void){
+uint8_t Lee_teclado(uint32_t Estado){
   uint32_t Key_value = 0;
   uint8_t Caracter = 0xFF;
+
+  // If the user push a key (the status snapshot says the fifo is not empty):
+  if ((Estado & WB_TECLADO_ST_FIFO) != 0){
+    //Pop the oldest key of the fifo (register 6), already decoded by the keymap
+    Key_value = neorv32_cpu_load_unsigned_word (WB_TECLADO_BASE_ADDRESS + WB_TECLADO_REG6_OFFSET);
+    if ((Key_value & WB_TECLADO_FIFO_VALID) != 0){
+      Caracter = (uint8_t)((Key_value & WB_TECLADO_FIFO_CODE) >> 16);
+    }
+  }
+  else if ((Estado & WB_TECLADO_ST_OVF) != 0){
+    // Keys were lost while the fifo was full
+    Log_print("\nTeclado: pulsaciones perdidas\n");
+    neorv32_cpu_store_unsigned_word (WB_TECLADO_BASE_ADDRESS + WB_TECLADO_REG7_OFFSET, WB_TECLADO_FIFO_OVF);
+  }
+
+  return Caracter;
+};
+
+void Comando_teclado(uint8_t Byte, uint8_t Valor){
+
+#ifdef TECLADO_CFS
+  //The IO bus only writes full words: replace the byte of REG1, then set the command bit in REG2
+  uint32_t Registro = neorv32_cpu_load_unsigned_word (WB_TECLADO_BASE_ADDRESS + WB_TECLADO_REG1_OFFSET);
+  Registro = (Registro & ~(0xFFUL << (8*Byte))) | ((uint32_t)Valor << (8*Byte));
+  neorv32_cpu_store_unsigned_word (WB_TECLADO_BASE_ADDRESS + WB_TECLADO_REG1_OFFSET, Registro);
+  neorv32_cpu_store_unsigned_word (WB_TECLADO_BASE_ADDRESS + WB_TECLADO_REG27_OFFSET, 1UL << Byte);
+#else
+  //One byte store: byte i of the user password and command i
+  neorv32_cpu_store_unsigned_byte (WB_TECLADO_BASE_ADDRESS + WB_TECLADO_REG29_OFFSET + Byte, Valor);
+#endif
+};
+
+void Reset_teclado(void){
+
+  //General reset of the peripherals
+  neorv32_gpio_port_set(0x20);
+  neorv32_gpio_port_set(0x00);
+
+  //Restore the real password, the key pressed interrupt, the debounce and the chord
+  neorv32_cpu_store_unsigned_word (WB_TECLADO_BASE_ADDRESS + WB_TECLADO_REG3_OFFSET, 0x75123456);
+  neorv32_cpu_store_unsigned_word (WB_TECLADO_BASE_ADDRESS + WB_TECLADO_REG5_OFFSET, WB_TECLADO_IRQ_KEY_EN | WB_TECLADO_IRQ_CMP_EN);
+  neorv32_cpu_store_unsigned_word (WB_TECLADO_BASE_ADDRESS + WB_TECLADO_REG8_OFFSET, KEYPAD_SETTLE_FRAMES);
+  neorv32_cpu_store_unsigned_word (WB_TECLADO_BASE_ADDRESS + WB_TECLADO_REG18_OFFSET, ACORDE_EMERGENCIA);
+};
+
+void Guarda_clave(uint8_t Slot, uint32_t Clave){
+
+  //Select the slot of the code bank and store the code, the slot is enabled by the hardware
+  neorv32_cpu_store_unsigned_word (WB_TECLADO_BASE_ADDRESS + WB_TECLADO_REG9_OFFSET, Slot);
+  neorv32_cpu_store_unsigned_word (WB_TECLADO_BASE_ADDRESS + WB_TECLADO_REG10_OFFSET, Clave);
+};
+
+void Carga_claves(void){
+
+  uint32_t i;
+  uint8_t Slot = 0;
+
+  //The first enabled users of this door go to the code bank, the rest only to the table
+  for (i=0 ; i<CLAVES_NUM && Slot<CLAVES_BANCO ; i++){
+    if ((Claves[i].flags & CLAVE_ACTIVA) != 0 && (Claves[i].puertas & PUERTA) != 0){
+      Banco_claves[Slot] = (uint16_t)i;
+      Guarda_clave(Slot++, Claves[i].codigo);
+    }
+  }
+
+  //The code bank has no reset: disable the slots a previous program could have left
+  for ( ; Slot<CLAVES_BANCO ; Slot++){
+    neorv32_cpu_store_unsigned_word (WB_TECLADO_BASE_ADDRESS + WB_TECLADO_REG9_OFFSET, Slot);
+    neorv32_cpu_store_unsigned_word (WB_TECLADO_BASE_ADDRESS + WB_TECLADO_REG11_OFFSET, 0);
+  }
+};
+
+uint8_t Busca_clave(void){
+
+  //The code bank compares REG1 with every slot at once
+  uint32_t Resultado = neorv32_cpu_load_unsigned_word (WB_TECLADO_BASE_ADDRESS + WB_TECLADO_REG12_OFFSET);
+
+  if ((Resultado & WB_TECLADO_CAM_HIT) != 0){
+    return (uint8_t)(Resultado & WB_TECLADO_CAM_INDEX);
+  }
+  return 0xFF;
+};
+
+uint32_t Hash_clave(uint32_t Codigo){
+
+  //Same mixing as hash_clave() in genera_claves.py
+  Codigo ^= Codigo >> 16;
+  Codigo *= 0x45D9F3B;
+  Codigo ^= Codigo >> 16;
+  return Codigo;
+};
+
+const Clave_t *Busca_usuario(uint32_t Codigo){
+
+  uint32_t Hash = Hash_clave(Codigo);
+  uint32_t Bit1 = Hash & (CLAVES_BLOOM_BITS-1);
+  uint32_t Bit2 = (Hash >> 16) & (CLAVES_BLOOM_BITS-1);
+  uint32_t Inicio = 0;
+  uint32_t Fin = CLAVES_NUM;
+  uint32_t Medio;
+
+  //Bloom prefilter: most unknown codes are rejected without touching the table
+  if ((Claves_bloom[Bit1 >> 5] & (1UL << (Bit1 & 31))) == 0 ||
+      (Claves_bloom[Bit2 >> 5] & (1UL << (Bit2 & 31))) == 0){
+    return NULL;
+  }
+
+  //Binary search, the table is sorted by code
+  while (Inicio < Fin){
+    Medio = (Inicio + Fin) >> 1;
+    if (Claves[Medio].codigo == Codigo){
+      return (Claves[Medio].flags & CLAVE_ACTIVA) != 0 ? &Claves[Medio] : NULL;
+    }
+    else if (Claves[Medio].codigo < Codigo){Inicio = Medio + 1;}
+    else{Fin = Medio;}
+  }
+  return NULL;
+};
+
+void Benchmark_claves(void){
+
+  uint64_t Inicio, Ciclos;
+  uint32_t Base, Max_hit = 0, Max_miss = 0;
+  uint64_t Total_hit = 0, Total_miss = 0;
+  uint32_t i, Fallos = 0, Aceptados = 0;
+
+  //Cost of reading the cycle counter, subtracted from every measure
+  Inicio = neorv32_cpu_get_cycle();
+  Base = (uint32_t)(neorv32_cpu_get_cycle() - Inicio);
+
+  //Every stored code
+  for (i=0 ; i<CLAVES_NUM ; i++){
+    Inicio = neorv32_cpu_get_cycle();
+    if (Busca_usuario(Claves[i].codigo) == NULL){Fallos++;}
+    Ciclos = neorv32_cpu_get_cycle() - Inicio - Base;
+    Total_hit += Ciclos;
+    Max_hit = (Ciclos > Max_hit) ? (uint32_t)Ciclos : Max_hit;
+  }
+
+  //Codes next to the stored ones, almost never in the table
+  for (i=0 ; i<CLAVES_NUM ; i++){
+    Inicio = neorv32_cpu_get_cycle();
+    if (Busca_usuario(Claves[i].codigo + 1) != NULL){Aceptados++;}
+    Ciclos = neorv32_cpu_get_cycle() - Inicio - Base;
+    Total_miss += Ciclos;
+    Max_miss = (Ciclos > Max_miss) ? (uint32_t)Ciclos : Max_miss;
+  }
+
+  Log_printf("Claves: %u codigos, %u fallos\n", CLAVES_NUM, Fallos);
+  Log_printf("  validas:    media %u ciclos, max %u ciclos (%u us)\n",
+             (uint32_t)(Total_hit / CLAVES_NUM), Max_hit, Max_hit / (TIMER_TICKS_PER_MS/1000));
+  Log_printf("  no validas: media %u ciclos, max %u ciclos (%u us), %u aceptadas\n",
+             (uint32_t)(Total_miss / CLAVES_NUM), Max_miss, Max_miss / (TIMER_TICKS_PER_MS/1000), Aceptados);
+};
+
+void Benchmark_teclado(void){
+
+  uint64_t Inicio;
+  uint32_t Base, Ciclos_sw = 0, Ciclos_hw = 0, Ciclos_rmw = 0, Ciclos_byte = 0, Ciclos_estado = 0;
+  uint32_t Key_value, Registro;
   uint16_t Mask_Char;
-  uint8_t i = 0;
+  uint8_t Caracter, i, Tecla;
+  uint8_t Errores = 0;
 
-  //Read register 0
-  Key_value = neorv32_cpu_load_unsigned_word (WB_TECLADO_BASE_ADDRESS + WB_TECLADO_REG0_OFFSET) & 0x0000FFFF; 
+  //Cost of reading the cycle counter, subtracted from every measure
+  Inicio = neorv32_cpu_get_cycle();
+  Base = (uint32_t)(neorv32_cpu_get_cycle() - Inicio);
 
-  // If the user push a key:
-  if (Key_value != 0x00000000){
-    // Read the key value:
+  for (Tecla=0 ; Tecla<16 ; Tecla++){
+    //Old path: load the One Hot register and walk the 16 bits with KeyValue[]
+    //(the key is forced into the loaded value, no key has to be pressed)
+    Inicio = neorv32_cpu_get_cycle();
+    Key_value = (neorv32_cpu_load_unsigned_word (WB_TECLADO_BASE_ADDRESS + WB_TECLADO_REG0_OFFSET) & 0x0000FFFF) | (1UL << Tecla);
+    Caracter = 0xFF;
     for (i=0, Mask_Char = 0x0001 ; i<16 ; i++){
       Caracter = (Key_value & Mask_Char) != 0 ? KeyValue[i] : Caracter;
       Mask_Char = (Mask_Char << 1);
     }
-    // Reset the register 0
-      neorv32_cpu_store_unsigned_word (WB_TECLADO_BASE_ADDRESS + WB_TECLADO_REG0_OFFSET, 0x00000000); 
+    Ciclos_sw += (uint32_t)(neorv32_cpu_get_cycle() - Inicio) - Base;
+    Errores += (Caracter != KeyValue[Tecla]) ? 1 : 0;
+
+    //New path: one load of the decoded key register
+    Inicio = neorv32_cpu_get_cycle();
+    Key_value = neorv32_cpu_load_unsigned_word (WB_TECLADO_BASE_ADDRESS + WB_TECLADO_REG13_OFFSET);
+    Caracter = ((Key_value & WB_TECLADO_KEY_VALID) != 0) ? (uint8_t)(Key_value & WB_TECLADO_KEY_CODE) : 0xFF;
+    Ciclos_hw += (uint32_t)(neorv32_cpu_get_cycle() - Inicio) - Base;
+
+    //Status snapshot read of the main loop, the bus latency of the keypad
+    Inicio = neorv32_cpu_get_cycle();
+    Key_value = neorv32_cpu_load_unsigned_word (WB_TECLADO_BASE_ADDRESS + WB_TECLADO_REG30_OFFSET);
+    Ciclos_estado += (uint32_t)(neorv32_cpu_get_cycle() - Inicio) - Base;
   }
 
-  return Caracter;
+  //The keymap has to hold the same codes as KeyValue[]
+  for (i=0 ; i<16 ; i++){
+    Key_value = neorv32_cpu_load_unsigned_word (WB_TECLADO_BASE_ADDRESS + WB_TECLADO_REG14_OFFSET + (i & 0xC));
+    Errores += (((Key_value >> (8*(i & 3))) & 0xFF) != KeyValue[i]) ? 1 : 0;
+  }
+
+  //A/B/C/D commands: old read-modify-write of REG1 and REG2 against Comando_teclado()
+  //(one byte store on Wishbone, word read-modify-write and REG27 set in the CFS)
+  for (i=0 ; i<4 ; i++){
+    neorv32_cpu_store_unsigned_word (WB_TECLADO_BASE_ADDRESS + WB_TECLADO_REG1_OFFSET, 0);
+    neorv32_cpu_store_unsigned_word (WB_TECLADO_BASE_ADDRESS + WB_TECLADO_REG2_OFFSET, 0);
+    Inicio = neorv32_cpu_get_cycle();
+    Registro = neorv32_cpu_load_unsigned_word (WB_TECLADO_BASE_ADDRESS + WB_TECLADO_REG1_OFFSET);
+    neorv32_cpu_store_unsigned_word (WB_TECLADO_BASE_ADDRESS + WB_TECLADO_REG1_OFFSET, Registro + (0x12UL << (8*i)));
+    Registro = neorv32_cpu_load_unsigned_word (WB_TECLADO_BASE_ADDRESS + WB_TECLADO_REG2_OFFSET);
+    neorv32_cpu_store_unsigned_word (WB_TECLADO_BASE_ADDRESS + WB_TECLADO_REG2_OFFSET, Registro + (1UL << i));
+    Ciclos_rmw += (uint32_t)(neorv32_cpu_get_cycle() - Inicio) - Base;
+
+    neorv32_cpu_store_unsigned_word (WB_TECLADO_BASE_ADDRESS + WB_TECLADO_REG1_OFFSET, 0);
+    neorv32_cpu_store_unsigned_word (WB_TECLADO_BASE_ADDRESS + WB_TECLADO_REG2_OFFSET, 0);
+    Inicio = neorv32_cpu_get_cycle();
+    Comando_teclado(i, 0x12);
+    Ciclos_byte += (uint32_t)(neorv32_cpu_get_cycle() - Inicio) - Base;
+
+    //Both paths have to leave the same password byte and command
+    Registro = neorv32_cpu_load_unsigned_word (WB_TECLADO_BASE_ADDRESS + WB_TECLADO_REG1_OFFSET);
+    Errores += (Registro != (0x12UL << (8*i))) ? 1 : 0;
+    Registro = neorv32_cpu_load_unsigned_word (WB_TECLADO_BASE_ADDRESS + WB_TECLADO_REG2_OFFSET);
+    Errores += (Registro != (1UL << i)) ? 1 : 0;
+  }
+  neorv32_cpu_store_unsigned_word (WB_TECLADO_BASE_ADDRESS + WB_TECLADO_REG2_OFFSET, 0);
+  neorv32_cpu_store_unsigned_word (WB_TECLADO_BASE_ADDRESS + WB_TECLADO_REG5_OFFSET, WB_TECLADO_IRQ_KEY_PEND | WB_TECLADO_IRQ_CMP_PEND);
+
+  Log_printf("Teclado: decodificacion software %u ciclos, hardware %u ciclos (media de 16 teclas), %u errores\n",
+             Ciclos_sw / 16, Ciclos_hw / 16, Errores);
+  Log_printf("Teclado: comando A/B/C/D lectura-modificacion-escritura %u ciclos, Comando_teclado %u ciclos\n",
+             Ciclos_rmw / 4, Ciclos_byte / 4);
+#ifdef TECLADO_CFS
+  Log_printf("Teclado (CFS): lectura de estado %u ciclos\n", Ciclos_estado / 16);
+#else
+  Log_printf("Teclado (Wishbone): lectura de estado %u ciclos\n", Ciclos_estado / 16);
+#endif
 };
 
-void Represent_Display(uint8_t Decenas, uint8_t Centenas, uint8_t Enable){
+void Timer_start(uint8_t Id, uint32_t Time_ms, uint8_t Periodic){
+
+  uint64_t Ticks = (uint64_t)Time_ms * TIMER_TICKS_PER_MS;
+
+  neorv32_cpu_dint();
+  Timers[Id].deadline = neorv32_mtime_get_time() + Ticks;
+  Timers[Id].period   = Ticks;
+  Timers[Id].periodic = Periodic;
+  Timers[Id].expired  = 0;
+  Timers[Id].active   = 1;
+  Timer_program();
+  neorv32_cpu_eint();
+};
 
-  uint16_t FPGA_display;
-  uint16_t Mask;
+uint8_t Timer_expired(uint8_t Id){
+
+  uint8_t Expired;
+
+  neorv32_cpu_dint();
+  Expired = Timers[Id].expired;
+  Timers[Id].expired = 0;
+  neorv32_cpu_eint();
+
+  return Expired;
+};
+
+void Timer_program(void){
+
+  uint64_t Next = 0xFFFFFFFFFFFFFFFFULL;
   uint8_t i;
 
-  for (i=3, Mask = 0x0004, FPGA_display = Decenas ; i<13 ; i++){
-    FPGA_display = Decenas == i ? Mask : FPGA_display;
-    Mask = (Mask << 1);
+  //Interrupt on the earliest active deadline
+  for (i=0 ; i<NUM_TIMERS ; i++){
+    if (Timers[i].active != 0 && Timers[i].deadline < Next){
+      Next = Timers[i].deadline;
+    }
   }
+  neorv32_mtime_set_timecmp(Next);
+};
 
-  neorv32_cpu_store_unsigned_word (WB_DISPLAY_BASE_ADDRESS + WB_DISPLAY_REG0_OFFSET,  FPGA_display); // Write tens
-  
-    for (i=3, Mask = 0x0004, FPGA_display = Centenas ; i<13 ; i++){
-    FPGA_display = Centenas == i ? Mask : FPGA_display;
-    Mask = (Mask << 1);
+void Espera_evento(void){
+
+  //Sleep until the next interrupt, unless one arrived since Wake_event was cleared
+  neorv32_cpu_dint();
+  if(Wake_event == 0){neorv32_cpu_sleep();}
+  neorv32_cpu_eint();
+};
+
+void Timer_irq_handler(void){
+
+  uint64_t Now = neorv32_mtime_get_time();
+  uint8_t i;
+
+  for (i=0 ; i<NUM_TIMERS ; i++){
+    if (Timers[i].active != 0 && Timers[i].deadline <= Now){
+      Timers[i].expired = 1;
+      if (Timers[i].periodic != 0){
+        Timers[i].deadline += Timers[i].period;
+        if (Timers[i].deadline <= Now){
+          Timers[i].deadline = Now + Timers[i].period; //Missed periods are not queued
+        }
+      }
+      else{
+        Timers[i].active = 0;
+      }
+    }
   }
-  
-  neorv32_cpu_store_unsigned_word (WB_DISPLAY_BASE_ADDRESS + WB_DISPLAY_REG1_OFFSET,  FPGA_display); // Write units
+  Timer_program();
+  Wake_event = 1;
+};
+
+void Log_setup(void){
+
+  neorv32_rte_exception_install(UART0_TX_RTE_ID, Uart_tx_irq_handler);
+  neorv32_cpu_irq_enable(UART0_TX_FIRQ_ENABLE);
+};
+
+void Log_putc(char Caracter){
+
+  uint16_t Next = (Log_head + 1) & (LOG_BUFFER_SIZE - 1);
+
+  //Never wait for the UART: drop the character if the buffer is full
+  if (Next == Log_tail){
+    Log_dropped++;
+  }
+  else{
+    Log_buffer[Log_head] = Caracter;
+    Log_head = Next;
+  }
+};
+
+void Log_kick(void){
+
+  //Start the transmission if the UART is idle, the interrupt sends the rest
+  neorv32_cpu_dint();
+  if (Log_tx_active == 0 && Log_tail != Log_head){
+    Log_tx_active = 1;
+    neorv32_uart0_putc(Log_buffer[Log_tail]);
+    Log_tail = (Log_tail + 1) & (LOG_BUFFER_SIZE - 1);
+  }
+  neorv32_cpu_eint();
+};
+
+void Log_print(const char *Texto){
+
+  while (*Texto != 0){
+    Log_putc(*Texto++);
+  }
+  Log_kick();
+};
+
+void Log_printf(const char *Formato, ...){
+
+  va_list Args;
+  char Digitos[10];
+  const char *Texto;
+  uint32_t Numero;
+  uint8_t Base;
+  uint8_t i;
+
+  va_start(Args, Formato);
+  while (*Formato != 0){
+    if (*Formato != '%'){
+      Log_putc(*Formato++);
+      continue;
+    }
+    Formato++;
+    switch (*Formato){
+      case 's':
+        Texto = va_arg(Args, const char *);
+        while (*Texto != 0){Log_putc(*Texto++);}
+        break;
+      case 'c':
+        Log_putc((char)va_arg(Args, int));
+        break;
+      case 'd':
+      case 'i':
+      case 'u':
+      case 'x':
+        Numero = va_arg(Args, uint32_t);
+        Base = (*Formato == 'x') ? 16 : 10;
+        if (*Formato != 'u' && *Formato != 'x' && (int32_t)Numero < 0){
+          Log_putc('-');
+          Numero = -Numero;
+        }
+        i = 0;
+        do{
+          Digitos[i++] = "0123456789abcdef"[Numero % Base];
+          Numero = Numero / Base;
+        } while (Numero != 0);
+        while (i != 0){Log_putc(Digitos[--i]);}
+        break;
+      case 0:
+        Formato--;
+        break;
+      default:
+        Log_putc(*Formato);
+        break;
+    }
+    Formato++;
+  }
+  va_end(Args);
+  Log_kick();
+};
+
+void Uart_tx_irq_handler(void){
+
+  //Acknowledge the interrupt and send the next character, if any
+  neorv32_cpu_csr_write(CSR_MIP, ~(1 << UART0_TX_FIRQ_PENDING));
+  if (Log_tail != Log_head){
+    neorv32_uart0_putc(Log_buffer[Log_tail]);
+    Log_tail = (Log_tail + 1) & (LOG_BUFFER_SIZE - 1);
+  }
+  else{
+    Log_tx_active = 0;
+  }
+};
+
+void Teclado_irq_handler(void){
+
+  //Wake up the main loop, the key is read from the fifo and the compare result from REG4
+  Wake_event = 1;
+  neorv32_cpu_store_unsigned_word (WB_TECLADO_BASE_ADDRESS + WB_TECLADO_REG5_OFFSET, WB_TECLADO_IRQ_KEY_EN | WB_TECLADO_IRQ_CMP_EN |
+                                                                                     WB_TECLADO_IRQ_KEY_PEND | WB_TECLADO_IRQ_CMP_PEND);
+};
+
+void Teclado_cfs_irq_handler(void){
+
+  //The CFS interrupt is a one clock pulse latched in MIP: clear the latch before serving
+  //the keypad, a pulse in the meantime sets it again and is not lost
+  neorv32_cpu_csr_write(CSR_MIP, ~(1 << CFS_FIRQ_PENDING));
+  Teclado_irq_handler();
+};
+
+void Cerradura_irq_handler(void){
+
+  //The interrupt is a pulse, the main loop reads and clears the pending flags
+  Wake_event = 1;
+};
+
+void Cerradura_hw(void){
+
+  uint32_t Pendientes, Contadores;
+
+  //Same password, debounce and emergency chord as the firmware lock, no key interrupts
+  neorv32_cpu_store_unsigned_word (WB_TECLADO_BASE_ADDRESS + WB_TECLADO_REG3_OFFSET, 0x75123456);
+  neorv32_cpu_store_unsigned_word (WB_TECLADO_BASE_ADDRESS + WB_TECLADO_REG5_OFFSET, 0x00000000);
+  neorv32_cpu_store_unsigned_word (WB_TECLADO_BASE_ADDRESS + WB_TECLADO_REG8_OFFSET, KEYPAD_SETTLE_FRAMES);
+  neorv32_cpu_store_unsigned_word (WB_TECLADO_BASE_ADDRESS + WB_TECLADO_REG18_OFFSET, ACORDE_EMERGENCIA);
+
+  //Door open 5s, lockout 3s, E clears the typed code, the chord locks out
+  neorv32_cpu_store_unsigned_word (WB_TECLADO_BASE_ADDRESS + WB_TECLADO_REG50_OFFSET, (3000UL << 16) | 5000);
+  neorv32_cpu_store_unsigned_word (WB_TECLADO_BASE_ADDRESS + WB_TECLADO_REG51_OFFSET, (71 << 8) | 69);
+  neorv32_cpu_store_unsigned_word (WB_TECLADO_BASE_ADDRESS + WB_TECLADO_REG48_OFFSET, WB_TECLADO_LOCK_RUN | WB_TECLADO_LOCK_IRQ_EN);
+  Log_print("Cerradura hardware en marcha\n");
+
+  while(1){
+    Wake_event = 0;
+    Pendientes = neorv32_cpu_load_unsigned_word (WB_TECLADO_BASE_ADDRESS + WB_TECLADO_REG48_OFFSET) & (WB_TECLADO_LOCK_OPEN | WB_TECLADO_LOCK_FAIL);
+    if(Pendientes == 0){Espera_evento();}
+    else{
+      neorv32_cpu_store_unsigned_word (WB_TECLADO_BASE_ADDRESS + WB_TECLADO_REG48_OFFSET, WB_TECLADO_LOCK_RUN | WB_TECLADO_LOCK_IRQ_EN | Pendientes);
+      Contadores = neorv32_cpu_load_unsigned_word (WB_TECLADO_BASE_ADDRESS + WB_TECLADO_REG52_OFFSET);
+      if((Pendientes & WB_TECLADO_LOCK_OPEN) != 0){Log_printf("\nPuerta abierta (%u aperturas)\n", Contadores & 0xFFFF);}
+      if((Pendientes & WB_TECLADO_LOCK_FAIL) != 0){Log_printf("\nClave incorrecta->Bloqueado (%u bloqueos)\n", Contadores >> 16);}
+    }
+  }
+};
+
+void Represent_Display(uint8_t Decenas, uint8_t Centenas, uint8_t Enable){
+
+  uint32_t FPGA_display;
+
+  // Unknown characters are shown as P
+  Decenas  = Decenas  < 13 ? Decenas  : 12;
+  Centenas = Centenas < 13 ? Centenas : 12;
+
+  // Both digits of the frame buffer in one write, tens on digit 0
+  FPGA_display = (uint32_t)Segmentos[Decenas] | ((uint32_t)Segmentos[Centenas] << 8);
+  neorv32_cpu_store_unsigned_word (WB_DISPLAY_BASE_ADDRESS + WB_DISPLAY_REG5_OFFSET,  FPGA_display); // Write tens and units
 
   if(Enable != 0){
       neorv32_cpu_store_unsigned_word (WB_DISPLAY_BASE_ADDRESS + WB_DISPLAY_REG2_OFFSET, 0x00000001); // Order to write on display
@@ -397,3 +1054,34 @@ void Represent_Display(uint8_t Decenas, uint8_t Centenas, uint8_t Enable){
     neorv32_cpu_store_unsigned_word (WB_DISPLAY_BASE_ADDRESS + WB_DISPLAY_REG2_OFFSET, 0x00000000); // Order to write on display    
   }
 };
+
+
+void Mensaje_display(const char *Texto, uint16_t Tiempo_ms, uint32_t Efectos){
+
+  uint32_t Palabra = 0;
+  uint8_t Longitud = 0;
+  uint8_t i;
+
+  // Up to 16 characters, 4 per register, blanks after the end of the text
+  for (i=0 ; i<16 ; i++){
+    if (*Texto != 0){
+      Palabra |= (uint32_t)(uint8_t)*Texto++ << (8*(i%4));
+      Longitud++;
+    }
+    else{
+      Palabra |= (uint32_t)' ' << (8*(i%4));
+    }
+    if ((i%4) == 3){
+      neorv32_cpu_store_unsigned_word (WB_DISPLAY_BASE_ADDRESS + WB_DISPLAY_REG16_OFFSET + i - 3, Palabra);
+      Palabra = 0;
+    }
+  }
+  neorv32_cpu_store_unsigned_word (WB_DISPLAY_BASE_ADDRESS + WB_DISPLAY_REG13_OFFSET, Longitud); // The scroll wraps at the end of the text
+
+  // The display blinks, scrolls and clears itself, no CPU time while it plays
+  if (Tiempo_ms != 0){
+    neorv32_cpu_store_unsigned_word (WB_DISPLAY_BASE_ADDRESS + WB_DISPLAY_REG12_OFFSET, Tiempo_ms);
+    Efectos |= WB_DISPLAY_AUTOBORRADO;
+  }
+  neorv32_cpu_store_unsigned_word (WB_DISPLAY_BASE_ADDRESS + WB_DISPLAY_REG2_OFFSET, WB_DISPLAY_MENSAJE | Efectos);
+};
@@ -43,6 +43,18 @@ use ieee.numeric_std.all;
 library neorv32;
 
 entity neorv32_iCEBreaker_BoardTop_MinimalBoot is
+  generic (
+    -- true = boot explicit bootloader; false = boot the application image from IMEM (sim/soc)
+    INT_BOOTLOADER_EN : boolean := true;
+    -- B4 pipelined Wishbone slaves, has to match wb_pipe_mode_c of rtl/core/neorv32_package.vhd
+    WB_PIPELINED      : boolean := false;
+    -- Lock engine of the keypad, drives the LEDs and the display while the firmware runs it.
+    -- Needed by CERRADURA_HW of the firmware; its cost is the lock row of osflow/synth
+    KEYPAD_LOCK_EN    : boolean := false;
+    -- Keypad inside the CFS (0xFFFFFE00) instead of on Wishbone, no lock engine there.
+    -- Set by the KEYPAD_CFS=1 build of osflow/filesets.mk, needed by TECLADO_CFS of the firmware
+    KEYPAD_CFS        : boolean := false
+  );
   -- Top-level ports. Board pins are defined in setups/osflow/constraints/iCEBreaker.pcf
   port (
     -- 12MHz Clock input
@@ -92,7 +104,6 @@ architecture neorv32_iCEBreaker_BoardTop_MinimalBoot_rtl of neorv32_iCEBreaker_B
 
   -- General config --
   constant CLOCK_FREQUENCY              : natural := 12_000_000;  -- Microprocessor clock frequency (Hz)
-  constant INT_BOOTLOADER_EN            : boolean := true;        -- boot configuration: true = boot explicit bootloader; false = boot from int/ext (I)MEM
   constant HW_THREAD_ID                 : natural := 0;           -- hardware thread id (32-bit)
 
   -- RISC-V CPU Extensions --
@@ -139,6 +150,16 @@ architecture neorv32_iCEBreaker_BoardTop_MinimalBoot_rtl of neorv32_iCEBreaker_B
   constant IO_PWM_NUM_CH                : natural := 3;           -- number of PWM channels to implement (0..60); 0 = disabled
   constant IO_WDT_EN                    : boolean := true;        -- implement watch dog timer (WDT)?
 
+  -- External Interrupts Controller (XIRQ) --
+  constant XIRQ_NUM_CH                  : natural := 4;           -- number of external IRQ channels (0..32)
+
+  -- Wishbone slaves --
+  constant WB_NUM_SLAVES                : natural := 3;           -- number of slaves on the Wishbone interconnect
+  constant WB_REGISTERED_RESP           : boolean := false;       -- register the slave responses (+1 cycle, shorter path to the CPU)
+  constant WB_SLAVE_KEYPAD              : natural := 0;           -- teclado, 0x90000000, 256 bytes
+  constant WB_SLAVE_DISPLAY             : natural := 1;           -- 7 segment display, 0x90000100, 128 bytes
+  constant WB_SLAVE_BUTTONS             : natural := 2;           -- buttons, 0x90000300, 32 bytes
+
 
   -- -------------------------------------------------------------------------------------------
   -- Signals for internal IO connections
@@ -146,8 +167,7 @@ architecture neorv32_iCEBreaker_BoardTop_MinimalBoot_rtl of neorv32_iCEBreaker_B
   signal gpio_o : std_ulogic_vector(63 downto 0);
   signal gpio_i : std_logic_vector(63 downto 0);
 
-  signal n_button_val : std_logic_vector(3 downto 0):="0000";
-  signal c_button_val : std_logic_vector(3 downto 0):="0000";
+  signal button_val_s : std_ulogic_vector(3 downto 0);          -- Last pressed button, from the button block
   
   signal c_counter : unsigned (1 downto 0):="00";
   signal n_counter : unsigned (1 downto 0):="00";
@@ -155,6 +175,7 @@ architecture neorv32_iCEBreaker_BoardTop_MinimalBoot_rtl of neorv32_iCEBreaker_B
   -- Signals for Wishbone --
   signal wb_tag_m2s   : std_ulogic_vector(2 downto 0);          -- Request tag
   signal wb_adr_m2s   : std_ulogic_vector(31 downto 0);         -- Address
+  signal wb_dat_s2m   : std_ulogic_vector(31 downto 0);         -- Read Data from the interconnect
   signal wb_dat_keypad_s2m   : std_ulogic_vector(31 downto 0); -- Read Data from teclado
   signal wb_dat_display_s2m   : std_ulogic_vector(31 downto 0); -- Read Data from display
   signal wb_dat_m2s   : std_ulogic_vector(31 downto 0);         -- Write Data
@@ -167,11 +188,43 @@ architecture neorv32_iCEBreaker_BoardTop_MinimalBoot_rtl of neorv32_iCEBreaker_B
   signal wb_err_keypad_s2m   : std_ulogic;                     -- Transfer error from display
   signal wb_ack_display_s2m   : std_ulogic;                    -- Transfer Ack from display 
   signal wb_err_display_s2m   : std_ulogic;                    -- Transfer error from display
-
-
-  signal s_reset      : std_logic := '0';
+  signal wb_ack_s2m   : std_ulogic;                             -- Transfer Ack from the interconnect
+  signal wb_err_s2m   : std_ulogic;                             -- Transfer error from the interconnect
+
+  -- Signals for the Wishbone interconnect, one bit/word per slave --
+  signal wb_stb_slv   : std_ulogic_vector(WB_NUM_SLAVES-1 downto 0);    -- Strobe of each slave
+  signal wb_cyc_slv   : std_ulogic_vector(WB_NUM_SLAVES-1 downto 0);    -- Valid Cycle of each slave
+  signal wb_dat_slv   : std_ulogic_vector(WB_NUM_SLAVES*32-1 downto 0); -- Read Data of each slave
+  signal wb_ack_slv   : std_ulogic_vector(WB_NUM_SLAVES-1 downto 0);    -- Transfer Ack of each slave
+  signal wb_err_slv   : std_ulogic_vector(WB_NUM_SLAVES-1 downto 0);    -- Transfer error of each slave
+
+  -- Signals for external interrupts --
+  signal xirq_s       : std_ulogic_vector(XIRQ_NUM_CH-1 downto 0); -- XIRQ channels
+  signal irq_keypad_s : std_ulogic;                               -- Key pressed interrupt from teclado
+  signal irq_buttons_s : std_ulogic;                              -- Button edge interrupt
+
+  -- Signals of the lock engine --
+  signal lock_active_s : std_ulogic;                              -- The lock engine drives LEDs and display
+  signal lock_led_s    : std_ulogic_vector(4 downto 0);           -- Bytes A/B/C/D accepted, locked out
+  signal lock_text_s   : std_ulogic_vector(15 downto 0);          -- Display characters
+
+  -- Signals of the CFS conduits (keypad inside the CFS) --
+  signal cfs_in_s      : std_ulogic_vector(31 downto 0);          -- Bit 0 soft reset, bits 11-8 rows
+  signal cfs_out_s     : std_ulogic_vector(31 downto 0);          -- Bits 3-0 columns
+
+
+  -- Power-on reset of the custom peripherals: the iCE40 flip-flops start at 0
+  -- and the core only resets itself, so the peripherals are held in reset for
+  -- the first 15 cycles, then follow the reset button and gpio_o(5) --
+  signal c_por        : unsigned(3 downto 0) := (others => '0');
+  signal s_reset      : std_logic := '1';
 begin
 
+  -- Sanity Checks --------------------------------------------------------------------------
+  -- ----------------------------------------------------------------------------------------
+  assert (WB_PIPELINED = neorv32.neorv32_package.wb_pipe_mode_c) report "Board top config ERROR: <WB_PIPELINED> has to match wb_pipe_mode_c of the neorv32_package (osflow/synth builds a patched copy for the pipelined variant)." severity failure;
+  assert not (KEYPAD_CFS and KEYPAD_LOCK_EN) report "Board top config ERROR: the CFS keypad has no lock engine <KEYPAD_LOCK_EN>." severity failure;
+
   -- -------------------------------------------------------------------------------------------
   -- Instance the microprocessor
   -- -------------------------------------------------------------------------------------------
@@ -238,11 +291,16 @@ begin
     IO_PWM_NUM_CH                => IO_PWM_NUM_CH, -- number of PWM channels to implement (0..60); 0 = disabled
     IO_WDT_EN                    => IO_WDT_EN,     -- implement watch dog timer (WDT)?
     IO_TRNG_EN                   => false,         -- implement true random number generator (TRNG)?
-    IO_CFS_EN                    => false,         -- implement custom functions subsystem (CFS)?
+    IO_CFS_EN                    => KEYPAD_CFS,    -- implement custom functions subsystem (CFS)?
     IO_CFS_CONFIG                => x"00000000",   -- custom CFS configuration generic
     IO_CFS_IN_SIZE               => 32,            -- size of CFS input conduit in bits
     IO_CFS_OUT_SIZE              => 32,            -- size of CFS output conduit in bits
-    IO_NEOLED_EN                 => false          -- implement NeoPixel-compatible smart LED interface (NEOLED)?
+    IO_NEOLED_EN                 => false,         -- implement NeoPixel-compatible smart LED interface (NEOLED)?
+
+    -- External Interrupts Controller (XIRQ) --
+    XIRQ_NUM_CH                  => XIRQ_NUM_CH,   -- number of external IRQ channels (0..32)
+    XIRQ_TRIGGER_TYPE            => x"FFFFFFFF",   -- trigger type: 0=level, 1=edge
+    XIRQ_TRIGGER_POLARITY        => x"FFFFFFFF"    -- trigger polarity: 0=low-level/falling-edge, 1=high-level/rising-edge
   )
   port map (
     -- Global control --
@@ -259,15 +317,15 @@ begin
     -- Wishbone bus interface (available if MEM_EXT_EN = true) --
     wb_tag_o    => wb_tag_m2s,     -- request tag
     wb_adr_o    => wb_adr_m2s,     -- address
-    wb_dat_i    => wb_dat_keypad_s2m or wb_ack_display_s2m,     -- read data
+    wb_dat_i    => wb_dat_s2m,     -- read data
     wb_dat_o    => wb_dat_m2s,     -- write data
     wb_we_o     => wb_we_m2s,      -- read/write
     wb_sel_o    => wb_sel_m2s,     -- byte enable
     wb_stb_o    => wb_stb_m2s,     -- strobe
     wb_cyc_o    => wb_cyc_m2s,     -- valid cycle
     wb_lock_o   => wb_lock_m2s,    -- exclusive access request
-    wb_ack_i    => wb_ack_display_s2m or wb_ack_keypad_s2m,     -- transfer acknowledge
-    wb_err_i    => wb_err_display_s2m or wb_err_keypad_s2m,     -- transfer error
+    wb_ack_i    => wb_ack_s2m,     -- transfer acknowledge
+    wb_err_i    => wb_err_s2m,     -- transfer error
 
     -- Advanced memory control signals (available if MEM_EXT_EN = true) --
     fence_o     => open,                         -- indicates an executed FENCE operation
@@ -303,12 +361,15 @@ begin
     pwm_o       => open,                         -- pwm channels
 
     -- Custom Functions Subsystem IO --
-    cfs_in_i    => (others => '0'),              -- custom CFS inputs conduit
-    cfs_out_o   => open,                         -- custom CFS outputs conduit
+    cfs_in_i    => cfs_in_s,                     -- custom CFS inputs conduit: keypad rows and soft reset
+    cfs_out_o   => cfs_out_s,                    -- custom CFS outputs conduit: keypad columns
 
     -- NeoPixel-compatible smart LED interface (available if IO_NEOLED_EN = true) --
     neoled_o    => open,                         -- async serial data line
 
+    -- External platform interrupts (available if XIRQ_NUM_CH > 0) --
+    xirq_i      => xirq_s,                       -- IRQ channels
+
     -- System time --
     mtime_i     => (others => '0'),              -- current system time from ext. MTIME (if IO_MTIME_EN = false)
     mtime_o     => open,                         -- current system time from int. MTIME (if IO_MTIME_EN = true)
@@ -320,9 +381,47 @@ begin
   );
 
 
+  -- -------------------------------------------------------------------------------------------
+  -- Wishbone interconnect: address decode and read mux of the slaves
+  -- -------------------------------------------------------------------------------------------
+
+  wb_interconnect_0: entity neorv32.wb_interconnect
+  generic map(NUM_SLAVES      => WB_NUM_SLAVES,
+              SLAVE_BASE      => x"90000300" & x"90000100" & x"90000000",   -- buttons & display & teclado
+              SLAVE_SIZE      => x"00000020" & x"00000080" & x"00000100",
+              REGISTERED_RESP => WB_REGISTERED_RESP )
+  port map(
+    clk_i     => std_ulogic(iCEBreakerv10_CLK),
+    reset_i   => s_reset,
+
+    wb_adr_i  => wb_adr_m2s,     -- address
+    wb_stb_i  => wb_stb_m2s,     -- strobe
+    wb_cyc_i  => wb_cyc_m2s,     -- valid cycle
+    wb_dat_o  => wb_dat_s2m,     -- read data
+    wb_ack_o  => wb_ack_s2m,     -- transfer acknowledge
+    wb_err_o  => wb_err_s2m,     -- transfer error
+
+    wb_stb_o  => wb_stb_slv,     -- strobe of each slave
+    wb_cyc_o  => wb_cyc_slv,     -- valid cycle of each slave
+    wb_dat_i  => wb_dat_slv,     -- read data of each slave
+    wb_ack_i  => wb_ack_slv,     -- transfer acknowledge of each slave
+    wb_err_i  => wb_err_slv      -- transfer error of each slave
+    );
+
+  wb_dat_slv(WB_SLAVE_KEYPAD*32+31 downto WB_SLAVE_KEYPAD*32)   <= wb_dat_keypad_s2m;
+  wb_dat_slv(WB_SLAVE_DISPLAY*32+31 downto WB_SLAVE_DISPLAY*32) <= wb_dat_display_s2m;
+  wb_ack_slv(WB_SLAVE_KEYPAD)  <= wb_ack_keypad_s2m;
+  wb_ack_slv(WB_SLAVE_DISPLAY) <= wb_ack_display_s2m;
+  wb_err_slv(WB_SLAVE_KEYPAD)  <= wb_err_keypad_s2m;
+  wb_err_slv(WB_SLAVE_DISPLAY) <= wb_err_display_s2m;
+
+
+  keypad_wb: if not KEYPAD_CFS generate
   peripheral_teclado_0: entity neorv32.wb_peripheral_teclado
   generic map(WB_ADDR_BASE   => x"90000000",
-              WB_ADDR_SIZE   => 32 )    
+              WB_ADDR_SIZE   => 256,
+              LOCK_EN        => KEYPAD_LOCK_EN,
+              WB_PIPELINED   => WB_PIPELINED )    
   port map(
     clk_i     => std_ulogic(iCEBreakerv10_CLK),
     reset_i   => s_reset,
@@ -334,25 +433,62 @@ begin
     wb_dat_o  => wb_dat_keypad_s2m,     -- write data
     wb_we_i   => wb_we_m2s,      -- read/write
     wb_sel_i  => wb_sel_m2s,     -- byte enable
-    wb_stb_i  => wb_stb_m2s,     -- strobe
-    wb_cyc_i  => wb_cyc_m2s,     -- valid cycle
+    wb_stb_i  => wb_stb_slv(WB_SLAVE_KEYPAD),  -- strobe
+    wb_cyc_i  => wb_cyc_slv(WB_SLAVE_KEYPAD),  -- valid cycle
     wb_lock_i => wb_lock_m2s,    -- exclusive access request
     wb_ack_o  => wb_ack_keypad_s2m,     -- transfer acknowledge
     wb_err_o  => wb_err_keypad_s2m,     -- transfer error
-
-    Row_1_i   => std_ulogic(iCEBreakerv10_PMOD1B_7),
-    Row_2_i   => std_ulogic(iCEBreakerv10_PMOD1B_8), 
-    Row_3_i   => std_ulogic(iCEBreakerv10_PMOD1B_9),     
-    Row_4_i   => std_ulogic(iCEBreakerv10_PMOD1B_10), 
-    Col_1_o   => iCEBreakerv10_PMOD1B_1,
-    Col_2_o   => iCEBreakerv10_PMOD1B_2,
-    Col_3_o   => iCEBreakerv10_PMOD1B_3,
-    Col_4_o   => iCEBreakerv10_PMOD1B_4     
+    wb_stall_o => open,                 -- never stalls
+
+    irq_o     => irq_keypad_s,          -- key pressed interrupt
+
+    Row_i(0)  => std_ulogic(iCEBreakerv10_PMOD1B_7),
+    Row_i(1)  => std_ulogic(iCEBreakerv10_PMOD1B_8), 
+    Row_i(2)  => std_ulogic(iCEBreakerv10_PMOD1B_9),     
+    Row_i(3)  => std_ulogic(iCEBreakerv10_PMOD1B_10), 
+    Col_o(0)  => iCEBreakerv10_PMOD1B_1,
+    Col_o(1)  => iCEBreakerv10_PMOD1B_2,
+    Col_o(2)  => iCEBreakerv10_PMOD1B_3,
+    Col_o(3)  => iCEBreakerv10_PMOD1B_4,
+
+    Lock_active_o => lock_active_s,
+    Lock_led_o    => lock_led_s,
+    Lock_open_o   => open,             -- no door strike on the board, the LEDs show it
+    Lock_text_o   => lock_text_s
     );
 
+  cfs_in_s <= (others => '0');
+  end generate;
+
+  -- The keypad lives in the CFS, its Wishbone slot answers with a bus error
+  keypad_cfs: if KEYPAD_CFS generate
+    wb_dat_keypad_s2m <= (others => '0');
+    wb_ack_keypad_s2m <= '0';
+    wb_err_keypad_s2m <= wb_cyc_slv(WB_SLAVE_KEYPAD) and wb_stb_slv(WB_SLAVE_KEYPAD);
+    irq_keypad_s      <= '0';              -- the keypad interrupt is the CFS fast interrupt
+
+    lock_active_s     <= '0';
+    lock_led_s        <= (others => '0');
+    lock_text_s       <= (others => '0');
+
+    cfs_in_s(31 downto 12) <= (others => '0');
+    cfs_in_s(11)      <= std_ulogic(iCEBreakerv10_PMOD1B_10);
+    cfs_in_s(10)      <= std_ulogic(iCEBreakerv10_PMOD1B_9);
+    cfs_in_s(9)       <= std_ulogic(iCEBreakerv10_PMOD1B_8);
+    cfs_in_s(8)       <= std_ulogic(iCEBreakerv10_PMOD1B_7);
+    cfs_in_s(7 downto 1) <= (others => '0');
+    cfs_in_s(0)       <= s_reset;
+
+    iCEBreakerv10_PMOD1B_1 <= cfs_out_s(0);
+    iCEBreakerv10_PMOD1B_2 <= cfs_out_s(1);
+    iCEBreakerv10_PMOD1B_3 <= cfs_out_s(2);
+    iCEBreakerv10_PMOD1B_4 <= cfs_out_s(3);
+  end generate;
+
     peripheral_7segmentDisplay: entity neorv32.wb_7segmentDisplay
-    generic map(WB_ADDR_BASE   => x"90000020",
-                WB_ADDR_SIZE   => 16 )    
+    generic map(WB_ADDR_BASE   => x"90000100",
+                WB_ADDR_SIZE   => 128,
+                WB_PIPELINED   => WB_PIPELINED )    
     port map(
       clk_i     => std_ulogic(iCEBreakerv10_CLK),
       reset_i   => s_reset,
@@ -363,11 +499,12 @@ begin
       wb_dat_o  => wb_dat_display_s2m,     -- write data
       wb_we_i   => wb_we_m2s,      -- read/write
       wb_sel_i  => wb_sel_m2s,     -- byte enable
-      wb_stb_i  => wb_stb_m2s,     -- strobe
-      wb_cyc_i  => wb_cyc_m2s,     -- valid cycle
+      wb_stb_i  => wb_stb_slv(WB_SLAVE_DISPLAY), -- strobe
+      wb_cyc_i  => wb_cyc_slv(WB_SLAVE_DISPLAY), -- valid cycle
       wb_lock_i => wb_lock_m2s,    -- exclusive access request
       wb_ack_o  => wb_ack_display_s2m,     -- transfer acknowledge
       wb_err_o  => wb_err_display_s2m,     -- transfer error
+      wb_stall_o => open,                 -- never stalls
 
             -- 7 Segment Dislay
       aa_o      => iCEBreakerv10_PMOD1A_1,
@@ -377,52 +514,72 @@ begin
       ae_o      => iCEBreakerv10_PMOD1A_7,
       af_o      => iCEBreakerv10_PMOD1A_8,
       ag_o      => iCEBreakerv10_PMOD1A_9,
-      ds_o      => iCEBreakerv10_PMOD1A_10
+      ds_o      => iCEBreakerv10_PMOD1A_10,
+      dig_o     => open,                -- 2 digit PMOD, ds_o selects the digit
+
+      ext_en_i  => lock_active_s,       -- the lock engine owns the display while it runs
+      ext_text_i => lock_text_s
       );
-    
 
-  -- -------------------------------------------------------------------------------------------
-  -- IO Connections
-  -- -------------------------------------------------------------------------------------------
-  iCEBreakerv10_PMOD2_1_LED_left   <= gpio_o(0);
-  iCEBreakerv10_PMOD2_2_LED_right  <= gpio_o(1);
-  iCEBreakerv10_PMOD2_8_LED_up     <= gpio_o(2);
-  iCEBreakerv10_PMOD2_3_LED_down   <= gpio_o(3);
-  iCEBreakerv10_PMOD2_7_LED_center <= gpio_o(4);  
-  s_reset  <= gpio_o(5);
+  buttons_0: entity neorv32.wb_buttons
+  generic map(WB_ADDR_BASE   => x"90000300",
+              WB_ADDR_SIZE   => 32,
+              NUM_BUTTONS    => 3,
+              WB_PIPELINED   => WB_PIPELINED )
+  port map(
+    clk_i     => std_ulogic(iCEBreakerv10_CLK),
+    reset_i   => s_reset,
 
-  gpio_i <= x"000000000000000"  &
-            c_button_val;
+    wb_tag_i  => wb_tag_m2s,     -- request tag
+    wb_adr_i  => wb_adr_m2s,     -- address
+    wb_dat_i  => wb_dat_m2s,     -- write data
+    wb_dat_o  => wb_dat_slv(WB_SLAVE_BUTTONS*32+31 downto WB_SLAVE_BUTTONS*32), -- read data
+    wb_we_i   => wb_we_m2s,      -- read/write
+    wb_sel_i  => wb_sel_m2s,     -- byte enable
+    wb_stb_i  => wb_stb_slv(WB_SLAVE_BUTTONS), -- strobe
+    wb_cyc_i  => wb_cyc_slv(WB_SLAVE_BUTTONS), -- valid cycle
+    wb_lock_i => wb_lock_m2s,    -- exclusive access request
+    wb_ack_o  => wb_ack_slv(WB_SLAVE_BUTTONS), -- transfer acknowledge
+    wb_err_o  => wb_err_slv(WB_SLAVE_BUTTONS), -- transfer error
+    wb_stall_o => open,                        -- never stalls
+
+    irq_o     => irq_buttons_s,  -- button edge interrupt
+
+    buttons_i(0) => std_ulogic(iCEBreakerv10_PMOD2_9_Button_1),
+    buttons_i(1) => std_ulogic(iCEBreakerv10_PMOD2_4_Button_2),
+    buttons_i(2) => std_ulogic(iCEBreakerv10_PMOD2_10_Button_3),
+    last_o    => button_val_s
+    );
+    
 
   -- -------------------------------------------------------------------------------------------
-  -- Buttom process
+  -- IO Connections
   -- -------------------------------------------------------------------------------------------
-  State_buttom_sinc: process(iCEBreakerv10_CLK,iCEBreakerv10_PMOD2_10_Button_3)
+  -- Same LEDs as the firmware lock: A/B/C/D accepted, center = locked out
+  iCEBreakerv10_PMOD2_1_LED_left   <= lock_led_s(0) when (lock_active_s = '1') else gpio_o(0);
+  iCEBreakerv10_PMOD2_2_LED_right  <= lock_led_s(1) when (lock_active_s = '1') else gpio_o(1);
+  iCEBreakerv10_PMOD2_8_LED_up     <= lock_led_s(2) when (lock_active_s = '1') else gpio_o(2);
+  iCEBreakerv10_PMOD2_3_LED_down   <= lock_led_s(3) when (lock_active_s = '1') else gpio_o(3);
+  iCEBreakerv10_PMOD2_7_LED_center <= lock_led_s(4) when (lock_active_s = '1') else gpio_o(4);
+
+  -- Peripheral reset: power-on, reset button (as rstn_i of the core) or Reset_teclado() of the firmware
+  por_sinc: process(iCEBreakerv10_CLK)
   begin
-    if (iCEBreakerv10_PMOD2_10_Button_3) then --Reset
-      c_button_val <= (others => '0'); 
-  
-    elsif (rising_edge(iCEBreakerv10_CLK)) then
-      c_button_val <= n_button_val;
-
+    if rising_edge(iCEBreakerv10_CLK) then
+      if (c_por /= 15) then
+        c_por <= c_por + 1;
+      end if;
     end if;
-
   end process;
 
-  State_Buttom_comb: process(iCEBreakerv10_PMOD2_9_Button_1,iCEBreakerv10_PMOD2_4_Button_2,iCEBreakerv10_PMOD2_10_Button_3,c_button_val)
-  begin
- 	-- Keep the state
-  	n_button_val <= c_button_val; 
-  	-- We are sending which buttom has been pushed
-  	if (iCEBreakerv10_PMOD2_9_Button_1 = '1') then
-		n_button_val <= x"1";
-	elsif (iCEBreakerv10_PMOD2_4_Button_2 = '1') then
-		n_button_val <= x"2";
-	elsif (iCEBreakerv10_PMOD2_10_Button_3 = '1') then 
-		n_button_val <= x"3";
-
-	end if;  
-  end process;
-  
+  s_reset  <= '1' when (c_por /= 15) or (iCEBreakerv10_BTN_N = '0') or (gpio_o(5) = '1') else '0';
+
+  -- XIRQ channel 0: teclado, channel 1: buttons
+  xirq_s <= (0 => irq_keypad_s, 1 => irq_buttons_s, others => '0');
+
+  -- Last pressed button, same code as the old GPIO latch
+  gpio_i <= x"000000000000000"  &
+            std_logic_vector(button_val_s);
+
 
 end architecture;
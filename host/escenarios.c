@@ -0,0 +1,712 @@
+/************************************************************************//**
+ * Scenario runner of the host build.
+ *
+ * A script is a string of keypad taps: 0-9 and A-F are single keys,
+ * (EF) presses several keys at once, {EF} presses them one after the other
+ * DESFASE_MS apart and releases them together, [NNN] waits NNN ms more.
+ * Keys pressed at once that are not the chord are read one by one, highest
+ * index first. E or F alone waits ACORDE_MS in the keypad for the rest of
+ * the chord before it is read. Every tap
+ * holds the key PULSACION_MS and leaves HUECO_MS before the next one.
+ *
+ * Built with HOST_CERRADURA (Proyecto) the runner also checks the lock:
+ * an oracle, written from the firmware and the keypad registers, gives
+ * the tokens the script has to produce and the firmware is watched for
+ * them on the UART and the display:
+ *   A/B/C/D  "Clave X correcta"      O  door open, "OP" on the display
+ *   X        lockout, "CL" on the display
+ * A byte that does not match the master code is stored without a token,
+ * once the four are given the user code table of Proyecto/claves.h decides.
+ * Random scripts are generated with the waits the oracle needs, every
+ * scenario runs in a forked process so the firmware starts from its
+ * initial data each time.
+ * *************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <time.h>
+#include "host.h"
+
+int firmware_main(void);
+
+/************************************************************************//**
+ * DEFINES :
+ * *************************************************************************/
+#define PULSACION_MS     60   // Key held
+#define HUECO_MS         60   // Released before the next tap
+#define INICIO_MS        10   // First tap, the firmware is set up by then
+#define REGISTRO_MS      6    // Press to key in the fifo, 5 debounce frames
+#define ACORDE_MS        50   // CHORD_WINDOW of the keypad, 1 ms frames
+#define DESFASE_MS       20   // Between the keys of {EF}
+#define MARGEN_MS        100  // Extra wait of the generated scripts after a timeout
+#define CIERRE_MS        100  // Script end after the last timeout
+#define SEGMENTOS        12   // Default random actions per scenario
+#define TOKENS_MAX       65536
+
+#define ESPERA_ACEPTADA  1000 // Firmware timeouts in ms: correct byte shown,
+#define ESPERA_ABIERTA   5000 // door open,
+#define ESPERA_BLOQUEO   3000 // lockout
+#define CLAVE            0x75123456 // Master code, REG3
+#define PUERTA           0x01       // Door of the lock in Clave_t.puertas, as PUERTA of the firmware
+
+#define MS(x)            ((uint64_t)(x) * HOST_CICLOS_MS)
+
+/************************************************************************//**
+ * Keypad: One Hot index of every code, as KeyValue[] of the firmware
+ * *************************************************************************/
+static const uint8_t KeyValue[16] = {  0 ,  7 ,  4 ,  1,
+                                      68 , 67 , 66 , 65,
+                                      69 ,  9 ,  6 ,  3,
+                                      70 ,  8 ,  5 ,  2 };
+
+#define CODIGO_ACORDE  71     // E+F emergency chord of the firmware
+#define TECLAS_ACORDE  0x1100
+
+/************************************************************************//**
+ * User code table of the firmware, claves.h under other names
+ * *************************************************************************/
+#define CLAVE_ACTIVA   0x01
+
+typedef struct {
+  uint32_t codigo;
+  uint16_t usuario;
+  uint8_t  flags;
+  uint8_t  puertas;
+} Clave_t;
+
+#ifdef HOST_CERRADURA
+#define Claves       Oraculo_claves
+#define Claves_bloom Oraculo_bloom
+#include "claves.h"
+#undef Claves
+#undef Claves_bloom
+#else
+#define CLAVES_NUM 1
+static const Clave_t Oraculo_claves[CLAVES_NUM] = { {CLAVE, 0, CLAVE_ACTIVA, 0xFF} };
+#endif
+
+typedef struct {
+  uint64_t Ciclo;
+  uint16_t Teclas;            // Keys held from this cycle on
+} Evento_t;
+
+/************************************************************************//**
+ * Oracle: lock state machine of Proyecto/main.c over the keypad registers
+ * *************************************************************************/
+enum { ORACULO_LIBRE, ORACULO_ACEPTADA, ORACULO_ABIERTA, ORACULO_BLOQUEADA, ORACULO_PARADA };
+
+typedef struct {
+  uint8_t  Estado;
+  uint64_t Hasta;             // End of the timeout of the state, ms
+  uint32_t Reg1;              // Typed password bytes
+  uint8_t  Reg2;              // Commands A/B/C/D given since the last reset
+  uint8_t  Resultado;         // Sticky result bits of the compare
+  uint8_t  Total;             // total_value of the firmware
+  uint8_t  Cola[8];           // Keys stored in the fifo while a correct byte is shown
+  uint8_t  Num_cola;
+  uint8_t  Gpio;              // v_gpio of the firmware, bit 5 holds the keypad in reset
+  char    *Tokens;
+  uint32_t Num_tokens;
+} Oraculo_t;
+
+/************************************************************************//**
+ * Global variables:
+ * *************************************************************************/
+  static Evento_t *Eventos;
+  static uint32_t Num_eventos;
+  static uint32_t Siguiente;
+  static uint64_t Fin;                      // Last cycle of the scenario
+  static const char *Guion;
+  static uint8_t Verbose = 0;
+  static uint8_t En_hijo = 0;               // Scenario in a forked process
+
+  static char Esperado[TOKENS_MAX];
+  static char Obtenido[TOKENS_MAX];
+  static uint32_t Num_obtenido;
+  static char Linea[128];                    // UART line being received
+  static uint8_t Num_linea;
+  static char Texto_display[3] = "--";
+
+  // Shared with the forked scenarios
+  typedef struct {
+    uint64_t Ciclos;
+    uint32_t Fallos;
+    uint32_t Display_parcial;  // Scenarios through the known deviation, see host.h
+  } Totales_t;
+  static Totales_t *Totales;
+
+
+/**********************************************************************//**
+ * C functions of the scripts
+ **************************************************************************/
+static int      Tecla_indice(char Caracter);
+static uint32_t Guion_carga(const char *Texto, Oraculo_t *Oraculo);
+static char    *Guion_aleatorio(uint32_t Segmentos);
+static void     Guion_anade(char **Texto, size_t *Longitud, size_t *Capacidad, const char *Formato, uint32_t Dato);
+static void     Escenario(const char *Texto);
+
+/**********************************************************************//**
+ * C functions of the oracle
+ **************************************************************************/
+static void     Oraculo_reset(Oraculo_t *Oraculo, char *Tokens);
+static void     Oraculo_avanza(Oraculo_t *Oraculo, uint64_t Ahora);
+static void     Oraculo_tecla(Oraculo_t *Oraculo, uint8_t Codigo, uint64_t Ahora);
+static void     Oraculo_teclas(Oraculo_t *Oraculo, uint16_t Teclas, uint64_t Ahora);
+static void     Oraculo_codigo(Oraculo_t *Oraculo, uint8_t Codigo, uint64_t Ahora);
+static uint8_t  Oraculo_abre(Oraculo_t *Oraculo);
+static void     Oraculo_completa(Oraculo_t *Oraculo, uint64_t Ahora);
+static uint64_t Oraculo_libre(Oraculo_t *Oraculo);
+static void     Oraculo_token(Oraculo_t *Oraculo, char Token);
+
+
+int main(int argc, char *argv[]){
+
+  const char *Texto = NULL;
+  uint32_t Escenarios = 1000;
+  uint32_t Segmentos = SEGMENTOS;
+  uint32_t Semilla = 1;
+  uint8_t Largo = 0;
+  uint32_t i;
+  char *Aleatorio;
+  pid_t Hijo;
+  int Estado;
+  struct timespec Inicio, Final;
+  double Segundos;
+  int Opcion;
+
+  while ((Opcion = getopt(argc, argv, "s:n:S:k:lv")) != -1){
+    switch (Opcion){
+      case 's': Texto = optarg; break;
+      case 'n': Escenarios = (uint32_t)strtoul(optarg, NULL, 0); break;
+      case 'S': Semilla = (uint32_t)strtoul(optarg, NULL, 0); break;
+      case 'k': Segmentos = (uint32_t)strtoul(optarg, NULL, 0); break;
+      case 'l': Largo = 1; break;
+      case 'v': Verbose = 1; break;
+      default:
+        fprintf(stderr, "uso: %s [-s guion] [-n escenarios] [-S semilla] [-k acciones] [-l] [-v]\n"
+                        "  -s  run one script, e.g. \"56A34B12C75D\", \"(EF)\", \"1[500]E\"\n"
+                        "  -n  random scenarios, each one in its own process\n"
+                        "  -l  one long random scenario in this process, for gprof/perf\n", argv[0]);
+        return 2;
+    }
+  }
+
+  //One script or one long scenario: this process runs the firmware and never comes back
+  if (Texto != NULL){Escenario(Texto);}
+  srand(Semilla);
+  if (Largo != 0){Escenario(Guion_aleatorio(Segmentos));}
+
+  Totales = mmap(NULL, sizeof(Totales_t), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+  if (Totales == MAP_FAILED){
+    perror("mmap");
+    return 2;
+  }
+
+  clock_gettime(CLOCK_MONOTONIC, &Inicio);
+  for (i=0 ; i<Escenarios ; i++){
+    Aleatorio = Guion_aleatorio(Segmentos);
+    fflush(stdout);
+    Hijo = fork();
+    if (Hijo == 0){
+      En_hijo = 1;
+      Escenario(Aleatorio);
+    }
+    if (Hijo < 0 || waitpid(Hijo, &Estado, 0) < 0 || !WIFEXITED(Estado) || WEXITSTATUS(Estado) > 1){
+      fprintf(stderr, "escenario %u: el proceso no ha terminado bien\n", i);
+      Totales->Fallos++;
+    }
+    free(Aleatorio);
+  }
+  clock_gettime(CLOCK_MONOTONIC, &Final);
+  Segundos = (double)(Final.tv_sec - Inicio.tv_sec) + (double)(Final.tv_nsec - Inicio.tv_nsec) * 1e-9;
+
+  printf("%u escenarios, %u fallos, %.0f escenarios/s, %.1f h de tiempo virtual (x%.0f)\n",
+         Escenarios, Totales->Fallos, Escenarios / Segundos,
+         (double)Totales->Ciclos / NEORV32_HOST_CLOCK / 3600.0,
+         (double)Totales->Ciclos / NEORV32_HOST_CLOCK / Segundos);
+  printf("desviaciones conocidas del RTL: %u escenarios escriben el display a medias\n", Totales->Display_parcial);
+  return Totales->Fallos != 0;
+}
+
+/************************************************************************//**
+ * Scenario: load the script and run the firmware until its end
+ * *************************************************************************/
+static void Escenario(const char *Texto){
+
+  Oraculo_t Oraculo;
+
+  Guion = Texto;
+  Oraculo_reset(&Oraculo, Esperado);
+  if (Guion_carga(Texto, &Oraculo) != 0){
+    fprintf(stderr, "guion no valido: \"%s\"\n", Texto);
+    exit(2);
+  }
+  Esperado[Oraculo.Num_tokens] = 0;
+  if (Verbose != 0){printf("guion \"%s\"\nesperado \"%s\"\n", Guion, Esperado);}
+
+  Host_reset();
+  firmware_main();
+
+  //The firmware ended by itself: the rest of the script is not served
+  Host_hasta(Fin);
+  Guion_fin();
+};
+
+static int Tecla_indice(char Caracter){
+
+  uint8_t Codigo, i;
+
+  if (Caracter >= '0' && Caracter <= '9'){Codigo = Caracter - '0';}
+  else if (Caracter >= 'A' && Caracter <= 'F'){Codigo = Caracter - 'A' + 65;}
+  else{return -1;}
+
+  for (i=0 ; KeyValue[i] != Codigo ; i++);
+  return i;
+};
+
+static uint32_t Guion_carga(const char *Texto, Oraculo_t *Oraculo){
+
+  uint64_t Ahora = MS(INICIO_MS);
+  uint16_t Teclas, Pendientes;
+  int Indice;
+  char *Final;
+
+  Num_eventos = 0;
+  Siguiente = 0;
+  Eventos = realloc(Eventos, (2 * strlen(Texto) + 1) * sizeof(Evento_t));
+
+  while (*Texto != 0){
+    if (*Texto == '['){
+      Ahora += MS(strtoul(Texto + 1, &Final, 10));
+      if (Final == Texto + 1 || *Final != ']'){return 1;}
+      Texto = Final + 1;
+      continue;
+    }
+
+    //Keys one after the other: the chord is read once complete, other keys at their press
+    if (*Texto == '{'){
+      Teclas = 0;
+      Pendientes = 0;
+      for (Texto++ ; *Texto != '}' ; Texto++){
+        if ((Indice = Tecla_indice(*Texto)) < 0){return 1;}
+        if (Teclas != 0){Ahora += MS(DESFASE_MS);}
+        Teclas |= 1U << Indice;
+        Pendientes |= 1U << Indice;
+        Eventos[Num_eventos].Ciclo  = Ahora;
+        Eventos[Num_eventos].Teclas = Teclas;
+        Num_eventos++;
+        if (Teclas == TECLAS_ACORDE){
+          Oraculo_tecla(Oraculo, CODIGO_ACORDE, Ahora + MS(REGISTRO_MS));
+          Pendientes = 0;
+        }
+        else if ((Teclas & ~TECLAS_ACORDE) != 0){
+          Oraculo_teclas(Oraculo, Pendientes, Ahora + MS(REGISTRO_MS));
+          Pendientes = 0;
+        }
+      }
+      Texto++;
+      //Part of the chord only: read at the end of the window, the keys are still held
+      Oraculo_teclas(Oraculo, Pendientes, Ahora + MS(REGISTRO_MS + ACORDE_MS));
+    }
+    else{
+      Teclas = 0;
+      if (*Texto == '('){
+        for (Texto++ ; *Texto != ')' ; Texto++){
+          if ((Indice = Tecla_indice(*Texto)) < 0){return 1;}
+          Teclas |= 1U << Indice;
+        }
+      }
+      else{
+        if ((Indice = Tecla_indice(*Texto)) < 0){return 1;}
+        Teclas = 1U << Indice;
+      }
+      Texto++;
+
+      //Codes read by the firmware: the chord, or every key of the press, highest first
+      if (Teclas == TECLAS_ACORDE){Oraculo_tecla(Oraculo, CODIGO_ACORDE, Ahora + MS(REGISTRO_MS));}
+      else if ((Teclas & ~TECLAS_ACORDE) == 0){Oraculo_teclas(Oraculo, Teclas, Ahora + MS(REGISTRO_MS + ACORDE_MS));}
+      else{Oraculo_teclas(Oraculo, Teclas, Ahora + MS(REGISTRO_MS));}
+
+      Eventos[Num_eventos].Ciclo  = Ahora;
+      Eventos[Num_eventos].Teclas = Teclas;
+      Num_eventos++;
+    }
+
+    Eventos[Num_eventos].Ciclo  = Ahora + MS(PULSACION_MS);
+    Eventos[Num_eventos].Teclas = 0;
+    Num_eventos++;
+    Ahora += MS(PULSACION_MS + HUECO_MS);
+  }
+
+  //The scenario ends once every timeout of the lock is over, the keys left in the fifo included
+  while (Oraculo_libre(Oraculo) != HOST_NUNCA && Oraculo_libre(Oraculo) + MS(MARGEN_MS) > Ahora){
+    Ahora = Oraculo_libre(Oraculo) + MS(MARGEN_MS);
+    Oraculo_avanza(Oraculo, Ahora);
+  }
+  Fin = Ahora + MS(CIERRE_MS);
+  Oraculo_avanza(Oraculo, Fin);
+  return 0;
+};
+
+static char *Guion_aleatorio(uint32_t Segmentos){
+
+  static const char Letras[4] = { 'A', 'B', 'C', 'D' };
+  Oraculo_t Oraculo;
+  char Tokens[TOKENS_MAX];
+  char *Texto = NULL;
+  size_t Longitud = 0, Capacidad = 0;
+  uint64_t Ahora = MS(INICIO_MS);
+  uint8_t Byte, Valor, Codigo;
+  uint32_t i, Accion, Objetivo;
+  const char *Tap;
+  char Pieza[8];
+
+  Oraculo_reset(&Oraculo, Tokens);
+  Guion_anade(&Texto, &Longitud, &Capacidad, "", 0);
+  //Half of the scenarios type the master code, the rest a code of the table, disabled ones and other doors included
+  Objetivo = (rand() % 2 == 0) ? CLAVE : Oraculo_claves[rand() % CLAVES_NUM].codigo;
+
+  for (i=0 ; i<Segmentos && Oraculo.Estado != ORACULO_PARADA ; i++){
+    //Mostly correct bytes in a random order, with wrong ones, resets and the chord
+    Accion = (uint32_t)rand() % 20;
+    Byte = (uint8_t)(rand() % 4);
+    if (Accion < 7){
+      //Next byte of the code not given yet, A to D
+      for (Byte=0 ; Byte<3 && (Oraculo.Reg2 & (1 << Byte)) != 0 &&
+                    (uint8_t)(Oraculo.Reg1 >> (8*Byte)) == (uint8_t)(Objetivo >> (8*Byte)) ; Byte++);
+    }
+    Valor = (uint8_t)(Objetivo >> (8*Byte));
+    if (Accion >= 10 && Accion < 14){Valor = (uint8_t)(((rand() % 10) << 4) | (rand() % 10));}
+
+    if (Accion < 14){
+      snprintf(Pieza, sizeof(Pieza), "%x%x%c", Valor >> 4, Valor & 0xF, Letras[Byte]);
+    }
+    else if (Accion < 16){snprintf(Pieza, sizeof(Pieza), "E");}
+    else if (Accion < 17){snprintf(Pieza, sizeof(Pieza), (rand() % 3 == 0) ? "(EF)" : (rand() % 2 == 0) ? "{EF}" : "{FE}");}
+    else{snprintf(Pieza, sizeof(Pieza), "%d", rand() % 10);}
+
+    //One more accepted byte could carry v_gpio into bit 5, the keypad reset, and the
+    //firmware would never read a key again: E clears it so long runs keep going
+    if (Oraculo.Gpio >= 0x18){snprintf(Pieza, sizeof(Pieza), "E");}
+
+    //F is left out: the firmware has no case for it and stops serving the keypad
+    for (Tap=Pieza ; *Tap != 0 ; Tap++){
+      if (Oraculo.Estado != ORACULO_LIBRE && Oraculo_libre(&Oraculo) + MS(MARGEN_MS) > Ahora){
+        Accion = (uint32_t)((Oraculo_libre(&Oraculo) + MS(MARGEN_MS) - Ahora + MS(1) - 1) / MS(1));
+        Guion_anade(&Texto, &Longitud, &Capacidad, "[%u]", Accion);
+        Ahora += MS(Accion);
+      }
+      if (*Tap == '(' || *Tap == '{'){
+        //The chord, read once its second key settles
+        Guion_anade(&Texto, &Longitud, &Capacidad, (*Tap == '(') ? "(EF)" : (Tap[1] == 'E') ? "{EF}" : "{FE}", 0);
+        if (*Tap == '{'){Ahora += MS(DESFASE_MS);}
+        Oraculo_tecla(&Oraculo, CODIGO_ACORDE, Ahora + MS(REGISTRO_MS));
+        Tap += 3;
+      }
+      else{
+        //E alone waits for the rest of the chord
+        Codigo = KeyValue[Tecla_indice(*Tap)];
+        Guion_anade(&Texto, &Longitud, &Capacidad, (const char[]){ *Tap, 0 }, 0);
+        Oraculo_tecla(&Oraculo, Codigo, Ahora + MS(REGISTRO_MS + ((Codigo == 69) ? ACORDE_MS : 0)));
+      }
+      Ahora += MS(PULSACION_MS + HUECO_MS);
+    }
+  }
+  return Texto;
+};
+
+static void Guion_anade(char **Texto, size_t *Longitud, size_t *Capacidad, const char *Formato, uint32_t Dato){
+
+  int Escrito;
+
+  if (*Longitud + 16 > *Capacidad){
+    *Capacidad = (*Capacidad != 0) ? 2 * *Capacidad : 256;
+    *Texto = realloc(*Texto, *Capacidad);
+  }
+  Escrito = snprintf(*Texto + *Longitud, *Capacidad - *Longitud, Formato, Dato);
+  *Longitud += (size_t)Escrito;
+};
+
+/************************************************************************//**
+ * Hooks of the stub: scripted keypad and observers of the firmware
+ * *************************************************************************/
+uint64_t Guion_proximo(void){
+
+  return (Siguiente < Num_eventos) ? Eventos[Siguiente].Ciclo : Fin;
+};
+
+void Guion_evento(uint64_t Ahora){
+
+  while (Siguiente < Num_eventos && Eventos[Siguiente].Ciclo <= Ahora){
+    Teclado_pulsa(Eventos[Siguiente].Teclas, Ahora);
+    Siguiente++;
+  }
+  if (Siguiente == Num_eventos && Ahora >= Fin){Guion_fin();}
+};
+
+void Guion_fin(void){
+
+  int Fallo = 0;
+
+  Obtenido[Num_obtenido] = 0;
+#ifdef HOST_CERRADURA
+  Fallo = strcmp(Obtenido, Esperado) != 0;
+  if (Fallo != 0 || Verbose != 0){
+    printf("%s guion \"%s\"\n  esperado \"%s\"\n  obtenido \"%s\"\n",
+           Fallo != 0 ? "FALLO" : "ok", Guion, Esperado, Obtenido);
+  }
+  else if (Totales == NULL){
+    printf("ok, %u tokens\n", Num_obtenido);
+  }
+#endif
+  if (Totales != NULL){
+    Totales->Ciclos += Host_ciclos;
+    Totales->Fallos += (uint32_t)Fallo;
+    Totales->Display_parcial += Host_desvios.Display_parcial != 0;
+  }
+  else{
+    if (Num_linea != 0){putchar('\n');}
+    printf("%.3f s de tiempo virtual\n", (double)Host_ciclos / NEORV32_HOST_CLOCK);
+    if (Host_desvios.Display_parcial != 0){
+      printf("desviaciones conocidas del RTL: %u escrituras parciales al display\n", Host_desvios.Display_parcial);
+    }
+  }
+  fflush(stdout);
+  if (En_hijo != 0){_exit(Fallo);}
+  exit(Fallo);
+};
+
+void Guion_uart(char Caracter){
+
+#ifdef HOST_CERRADURA
+  if (Verbose != 0){putchar(Caracter);}
+#else
+  putchar(Caracter);
+#endif
+
+  if (Caracter == '\r'){return;}
+  if (Caracter != '\n' && Num_linea < sizeof(Linea) - 1){
+    Linea[Num_linea++] = Caracter;
+    return;
+  }
+  Linea[Num_linea] = 0;
+  Num_linea = 0;
+  //"Clave X correcta" of the cases 1-4
+  if (strncmp(Linea, "Clave ", 6) == 0 && strcmp(Linea + 7, " correcta") == 0){
+    if (Num_obtenido < TOKENS_MAX - 1){Obtenido[Num_obtenido++] = Linea[6];}
+  }
+};
+
+void Guion_gpio(uint64_t Valor){
+
+  (void)Valor;
+  Guion_display(Host_ciclos);
+};
+
+void Guion_display(uint64_t Ahora){
+
+  char Texto[3];
+  char Token = 0;
+
+  //Only the messages count, the digit frame goes through C and L on the way back to dashes
+  Display_texto(Texto, Ahora);
+  if ((Display_lee(0x08, Ahora) & 0x3) != 0x2){strcpy(Texto, "--");}
+  if (strcmp(Texto, Texto_display) == 0){return;}
+  if (strcmp(Texto, "OP") == 0){Token = 'O';}
+  if (strcmp(Texto, "CL") == 0){Token = 'X';}
+  if (Token != 0 && Num_obtenido < TOKENS_MAX - 1){Obtenido[Num_obtenido++] = Token;}
+  strcpy(Texto_display, Texto);
+};
+
+/************************************************************************//**
+ * Oracle
+ * *************************************************************************/
+static void Oraculo_reset(Oraculo_t *Oraculo, char *Tokens){
+
+  memset(Oraculo, 0, sizeof(Oraculo_t));
+  Oraculo->Estado = ORACULO_LIBRE;
+  Oraculo->Tokens = Tokens;
+};
+
+static void Oraculo_token(Oraculo_t *Oraculo, char Token){
+
+  if (Oraculo->Num_tokens < TOKENS_MAX - 1){Oraculo->Tokens[Oraculo->Num_tokens++] = Token;}
+};
+
+static void Oraculo_avanza(Oraculo_t *Oraculo, uint64_t Ahora){
+
+  uint8_t i;
+
+  while (Oraculo->Estado != ORACULO_LIBRE && Oraculo->Estado != ORACULO_PARADA && Ahora >= Oraculo->Hasta){
+    switch (Oraculo->Estado){
+      case ORACULO_ACEPTADA:
+        //Case 7: with the four bytes the door opens or locks, otherwise the stored keys
+        Oraculo->Total = 0;
+        Oraculo->Estado = ((Oraculo->Gpio & 0x20) != 0) ? ORACULO_PARADA : ORACULO_LIBRE;
+        if (Oraculo->Reg2 == 0xF){
+          Oraculo_completa(Oraculo, Oraculo->Hasta);
+          Oraculo->Num_cola = 0;
+          break;
+        }
+        for (i=0 ; i<Oraculo->Num_cola && Oraculo->Estado == ORACULO_LIBRE ; i++){
+          Oraculo_codigo(Oraculo, Oraculo->Cola[i], Oraculo->Hasta);
+        }
+        //Left in the fifo while the next byte is shown
+        if (Oraculo->Estado == ORACULO_ACEPTADA){
+          memmove(Oraculo->Cola, Oraculo->Cola + i, Oraculo->Num_cola - i);
+          Oraculo->Num_cola -= i;
+        }
+        else{
+          Oraculo->Num_cola = 0;
+        }
+        break;
+
+      case ORACULO_ABIERTA:
+      case ORACULO_BLOQUEADA:
+        //Reset_teclado(): password bytes, commands and results cleared
+        Oraculo->Gpio = 0;
+        Oraculo->Reg1 = 0;
+        Oraculo->Reg2 = 0;
+        Oraculo->Resultado = 0;
+        Oraculo->Total = 0;
+        Oraculo->Estado = ORACULO_LIBRE;
+        break;
+
+      default:
+        break;
+    }
+  }
+};
+
+static void Oraculo_tecla(Oraculo_t *Oraculo, uint8_t Codigo, uint64_t Ahora){
+
+  Oraculo_avanza(Oraculo, Ahora);
+  switch (Oraculo->Estado){
+    case ORACULO_LIBRE:
+      Oraculo_codigo(Oraculo, Codigo, Ahora);
+      break;
+    case ORACULO_ACEPTADA:
+      //Case 6 does not read the keypad, the key waits in the fifo
+      if ((Oraculo->Gpio & 0x20) == 0 && Oraculo->Num_cola < sizeof(Oraculo->Cola)){Oraculo->Cola[Oraculo->Num_cola++] = Codigo;}
+      break;
+    default:
+      //Open door and lockout discard the keys, a stopped firmware does not read them
+      break;
+  }
+};
+
+static void Oraculo_teclas(Oraculo_t *Oraculo, uint16_t Teclas, uint64_t Ahora){
+
+  int8_t i;
+
+  //One key per fifo entry, highest index first
+  for (i=15 ; i>=0 ; i--){
+    if ((Teclas & (1U << i)) != 0){Oraculo_tecla(Oraculo, KeyValue[i], Ahora);}
+  }
+};
+
+static void Oraculo_codigo(Oraculo_t *Oraculo, uint8_t Codigo, uint64_t Ahora){
+
+  uint8_t Byte, k;
+
+  if (Codigo < 10){
+    Oraculo->Total = (uint8_t)((Oraculo->Total << 4) + Codigo);
+    return;
+  }
+
+  switch (Codigo){
+    case 65: case 66: case 67: case 68:
+      //REG29 byte store: byte of REG1 and command bit, every matching commanded byte sets its result
+      Byte = Codigo - 65;
+      Oraculo->Reg1 = (Oraculo->Reg1 & ~(0xFFUL << (8*Byte))) | ((uint32_t)Oraculo->Total << (8*Byte));
+      Oraculo->Reg2 |= 1 << Byte;
+      for (k=0 ; k<4 ; k++){
+        if ((Oraculo->Reg2 & (1 << k)) != 0 && ((Oraculo->Reg1 ^ CLAVE) & (0xFFUL << (8*k))) == 0){Oraculo->Resultado |= 1 << k;}
+      }
+
+      if ((Oraculo->Resultado & (1 << Byte)) != 0){
+        Oraculo_token(Oraculo, (char)Codigo);
+        Oraculo->Estado = ORACULO_ACEPTADA;
+        Oraculo->Hasta = Ahora + MS(ESPERA_ACEPTADA);
+        //v_gpio+led carries into the next bits: on bit 5 the keypad stays in reset for good
+        Oraculo->Gpio = (uint8_t)(Oraculo->Gpio + (1 << Byte));
+        if ((Oraculo->Gpio & 0x20) != 0){
+          Oraculo->Reg1 = 0;
+          Oraculo->Reg2 = 0;
+          Oraculo->Resultado = 0;
+          Oraculo->Num_cola = 0;
+        }
+      }
+      else{
+        //Not the master byte: stored, the table decides with the fourth one
+        Oraculo->Total = 0;
+        if (Oraculo->Reg2 == 0xF){Oraculo_completa(Oraculo, Ahora);}
+      }
+      break;
+
+    case 69:
+      //E: keypad reset, total_value is kept and the keys still in the fifo are lost
+      Oraculo->Gpio = 0;
+      Oraculo->Num_cola = 0;
+      Oraculo->Reg1 = 0;
+      Oraculo->Reg2 = 0;
+      Oraculo->Resultado = 0;
+      break;
+
+    case CODIGO_ACORDE:
+      Oraculo_token(Oraculo, 'X');
+      Oraculo->Estado = ORACULO_BLOQUEADA;
+      Oraculo->Hasta = Ahora + MS(ESPERA_BLOQUEO);
+      break;
+
+    default:
+      //F has no case: the main loop spins on estado 70 and never reads the keypad again
+      Oraculo->Estado = ORACULO_PARADA;
+      break;
+  }
+};
+
+static uint64_t Oraculo_libre(Oraculo_t *Oraculo){
+
+  switch (Oraculo->Estado){
+    case ORACULO_LIBRE:     return 0;
+    case ORACULO_PARADA:    return HOST_NUNCA;
+    case ORACULO_ACEPTADA:
+      if (Oraculo->Reg2 != 0xF){return Oraculo->Hasta;}
+      return Oraculo->Hasta + (Oraculo_abre(Oraculo) ? MS(ESPERA_ABIERTA) : MS(ESPERA_BLOQUEO));
+    default:                return Oraculo->Hasta;
+  }
+};
+
+static uint8_t Oraculo_abre(Oraculo_t *Oraculo){
+
+  uint32_t i;
+
+  //The master code matched byte by byte, or an enabled user of this door
+  if (Oraculo->Resultado == 0xF){return 1;}
+  for (i=0 ; i<CLAVES_NUM ; i++){
+    if (Oraculo_claves[i].codigo == Oraculo->Reg1){
+      return (Oraculo_claves[i].flags & CLAVE_ACTIVA) != 0 && (Oraculo_claves[i].puertas & PUERTA) != 0;
+    }
+  }
+  return 0;
+};
+
+static void Oraculo_completa(Oraculo_t *Oraculo, uint64_t Ahora){
+
+  //The four bytes given: door open, or "Clave incorrecta" and lockout
+  if (Oraculo_abre(Oraculo) != 0){
+    Oraculo_token(Oraculo, 'O');
+    Oraculo->Estado = ORACULO_ABIERTA;
+    Oraculo->Hasta = Ahora + MS(ESPERA_ABIERTA);
+  }
+  else{
+    Oraculo_token(Oraculo, 'X');
+    Oraculo->Estado = ORACULO_BLOQUEADA;
+    Oraculo->Hasta = Ahora + MS(ESPERA_BLOQUEO);
+  }
+};
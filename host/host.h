@@ -0,0 +1,89 @@
+/************************************************************************//**
+ * Host build: interface between the NEORV32 stub, the peripheral models
+ * and the scenario runner. Everything runs on virtual time, counted in
+ * cycles of the 12 MHz processor clock.
+ * *************************************************************************/
+
+#ifndef host_h
+#define host_h
+
+#include <stdint.h>
+#include "neorv32.h"
+
+#define HOST_NUNCA      UINT64_MAX               // No event pending
+#define HOST_CICLOS_MS  (NEORV32_HOST_CLOCK/1000) // Cycles per millisecond
+
+/************************************************************************//**
+ * Address map of the Proyecto top
+ * *************************************************************************/
+#ifdef TECLADO_CFS
+#define HOST_TECLADO_BASE   0xFFFFFE00 // Keypad inside the CFS
+#define HOST_TECLADO_SIZE   128
+#else
+#define HOST_TECLADO_BASE   0x90000000
+#define HOST_TECLADO_SIZE   256
+#endif
+#define HOST_DISPLAY_BASE   0x90000100
+#define HOST_DISPLAY_SIZE   128
+
+/** Keypad interrupt: XIRQ channel 0, or the CFS fast interrupt */
+#define HOST_TECLADO_XIRQ_CH 0
+
+/** Bus access costs in cycles: external Wishbone and processor-internal IO bus */
+#define HOST_CICLOS_WB      6
+#define HOST_CICLOS_IO      3
+#define HOST_CICLOS_CSR     2
+#define HOST_CICLOS_TRAP    60 // Runtime environment entry and exit
+
+/************************************************************************//**
+ * Virtual time and interrupts (neorv32_host.c)
+ * *************************************************************************/
+extern uint64_t Host_ciclos;
+
+void Host_reset(void);
+void Host_avanza(uint64_t Ciclos);
+void Host_hasta(uint64_t Fin);
+void Host_irq_teclado(void);
+
+/************************************************************************//**
+ * Keypad model (modelo_teclado.c), wb_peripheral_teclado with LOCK_EN = false
+ * *************************************************************************/
+void     Teclado_reset(uint64_t Ahora);
+uint32_t Teclado_lee(uint32_t Offset, uint64_t Ahora);
+void     Teclado_escribe(uint32_t Offset, uint32_t Dato, uint8_t Sel, uint64_t Ahora);
+void     Teclado_pulsa(uint16_t Teclas, uint64_t Ahora);
+uint64_t Teclado_proximo(uint64_t Ahora);
+void     Teclado_evento(uint64_t Ahora);
+uint16_t Teclado_teclas(void);
+
+/************************************************************************//**
+ * 7 segment display model (modelo_display.c), wb_7segmentDisplay with 2 digits
+ * *************************************************************************/
+void     Display_reset(uint64_t Ahora);
+uint32_t Display_lee(uint32_t Offset, uint64_t Ahora);
+void     Display_escribe(uint32_t Offset, uint32_t Dato, uint8_t Sel, uint64_t Ahora);
+void     Display_texto(char Texto[3], uint64_t Ahora);
+
+/************************************************************************//**
+ * Known deviations: behaviour of the RTL that the models copy and the
+ * oracle takes as right, although it is not what the register map
+ * promises. Counted per scenario, the totals show how many runs went
+ * through them.
+ * *************************************************************************/
+typedef struct {
+  uint32_t Display_parcial;  // Byte or half word write to the display: ignored, only full words are taken
+} Host_desvios_t;
+
+extern Host_desvios_t Host_desvios;
+
+/************************************************************************//**
+ * Scenario runner (escenarios.c): scripted keypad and observers
+ * *************************************************************************/
+uint64_t Guion_proximo(void);
+void     Guion_evento(uint64_t Ahora);
+void     Guion_fin(void);
+void     Guion_uart(char Caracter);
+void     Guion_gpio(uint64_t Valor);
+void     Guion_display(uint64_t Ahora);
+
+#endif // host_h
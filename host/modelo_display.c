@@ -0,0 +1,235 @@
+/************************************************************************//**
+ * Model of rtl/periph/wb_7SegmentDisplay.vhd, DIGITS = 2.
+ *
+ * Same register map and reset values as the RTL. The effects (blink,
+ * scroll, auto-clear) and the binary to BCD conversion are evaluated
+ * from the time of the write that started them, there is no per
+ * cycle state to advance.
+ * *************************************************************************/
+
+#include "host.h"
+
+#define DIGITS       2
+#define BCD_CICLOS   35 // REG7 write to frame buffer, as the RTL
+
+/************************************************************************//**
+ * Segments: bit 0 = a ... bit 6 = g
+ * *************************************************************************/
+static const uint8_t Hex_seg[16] = { 0x3F, 0x06, 0x5B, 0x4F, 0x66, 0x6D, 0x7D, 0x07,
+                                     0x7F, 0x6F, 0x77, 0x7C, 0x39, 0x5E, 0x79, 0x71 };
+#define SEG_DASH   0x40
+#define SEG_BLANK  0x00
+#define SEG_OVF    0x49
+
+/************************************************************************//**
+ * Registers
+ * *************************************************************************/
+static uint32_t Reg0, Reg1, Reg2, Reg3, Reg4, Reg7, Reg11, Reg12, Reg13;
+static uint32_t Mensaje[4];
+static uint8_t  Frame[DIGITS];
+static uint64_t Efectos_inicio;   // Last REG2 write, the effects restart on it
+static uint64_t Bcd_fin;          // End of the conversion, HOST_NUNCA when loaded
+static uint64_t Bcd;              // 10 BCD digits of the magnitude
+static uint8_t  Bcd_neg;
+static uint8_t  Bcd_ovf;
+
+static uint8_t onehot_seg(uint32_t Codigo);
+static void    Display_actualiza(uint64_t Ahora);
+
+
+void Display_reset(uint64_t Ahora){
+
+  uint8_t i;
+
+  Reg0  = 0;
+  Reg1  = 0;
+  Reg2  = 0;
+  Reg3  = 65536;
+  Reg4  = 0;
+  Reg7  = 0;
+  Reg11 = (400UL << 16) | 500;
+  Reg12 = 3000;
+  Reg13 = 16;
+  for (i=0 ; i<4 ; i++){Mensaje[i] = 0x20202020;}
+  for (i=0 ; i<DIGITS ; i++){Frame[i] = onehot_seg(0);}
+  Efectos_inicio = Ahora;
+  Bcd_fin = HOST_NUNCA;
+  Bcd     = 0;
+  Bcd_neg = 0;
+  Bcd_ovf = 0;
+};
+
+static uint8_t onehot_seg(uint32_t Codigo){
+
+  //Legacy One Hot code of REG0/REG1
+  switch (Codigo & 0xFFF){
+    case 0x000: return 0x3F;
+    case 0x001: return 0x06;
+    case 0x002: return 0x5B;
+    case 0x004: return 0x4F;
+    case 0x008: return 0x66;
+    case 0x010: return 0x6D;
+    case 0x020: return 0x7D;
+    case 0x040: return 0x07;
+    case 0x080: return 0x7F;
+    case 0x100: return 0x6F;
+    case 0x200: return 0x39; // C
+    case 0x400: return 0x38; // L
+    default:    return 0x73; // P
+  }
+};
+
+static void Display_actualiza(uint64_t Ahora){
+
+  uint8_t Msd = 0;
+  uint8_t i;
+
+  //Auto-clear: REG2 back to dashes REG12 ms after the REG2 write
+  if ((Reg2 & 0x40) != 0){
+    uint64_t Ms = (Reg12 & 0xFFFF) > 1 ? (Reg12 & 0xFFFF) : 1;
+    if (Ahora >= Efectos_inicio + Ms * HOST_CICLOS_MS){
+      Reg2 = 0;
+    }
+  }
+
+  //Finished conversion: the decimal number goes to the frame buffer
+  if (Ahora >= Bcd_fin){
+    Bcd_fin = HOST_NUNCA;
+    for (i=0 ; i<10 ; i++){
+      if (((Bcd >> (4*i)) & 0xF) != 0){Msd = i;}
+    }
+    Bcd_ovf = (Msd > DIGITS-1) || (Bcd_neg != 0 && Msd == DIGITS-1);
+    for (i=0 ; i<DIGITS ; i++){
+      Frame[DIGITS-1-i] = SEG_BLANK;
+      if (i <= Msd){Frame[DIGITS-1-i] = Hex_seg[(Bcd >> (4*i)) & 0xF];}
+      else if (i == Msd+1 && Bcd_neg != 0){Frame[DIGITS-1-i] = SEG_DASH;}
+      if (Bcd_ovf != 0){Frame[DIGITS-1-i] = SEG_OVF;}
+    }
+  }
+};
+
+uint32_t Display_lee(uint32_t Offset, uint64_t Ahora){
+
+  uint32_t Dato = 0;
+  uint8_t i;
+
+  Display_actualiza(Ahora);
+  switch (Offset >> 2){
+    case 0:  Dato = Reg0; break;
+    case 1:  Dato = Reg1; break;
+    case 2:  Dato = Reg2; break;
+    case 3:  Dato = Reg3; break;
+    case 4:  Dato = Reg4; break;
+    case 5:
+      for (i=0 ; i<DIGITS && i<4 ; i++){Dato |= (uint32_t)Frame[i] << (8*i);}
+      break;
+    case 7:  Dato = Reg7; break;
+    case 8:  Dato = (Bcd_fin != HOST_NUNCA) | (Bcd_neg << 1) | (Bcd_ovf << 2); break;
+    case 9:  Dato = (Bcd_fin != HOST_NUNCA) ? 0 : (uint32_t)Bcd; break;
+    case 10: Dato = (Bcd_fin != HOST_NUNCA) ? 0 : (uint32_t)(Bcd >> 32) & 0xFF; break;
+    case 11: Dato = Reg11; break;
+    case 12: Dato = Reg12; break;
+    case 13: Dato = Reg13; break;
+    case 16: case 17: case 18: case 19:
+      Dato = Mensaje[(Offset >> 2) - 16];
+      break;
+    default: break;
+  }
+  return Dato;
+};
+
+void Display_escribe(uint32_t Offset, uint32_t Dato, uint8_t Sel, uint64_t Ahora){
+
+  uint32_t Magnitud;
+  uint8_t i;
+
+  Display_actualiza(Ahora);
+
+  //Only full-word writes, the RTL drops the rest without an error
+  if (Sel != 0xF){
+    Host_desvios.Display_parcial++;
+    return;
+  }
+
+  switch (Offset >> 2){
+    case 0: Reg0 = Dato; Frame[0] = onehot_seg(Dato); break;
+    case 1: Reg1 = Dato; Frame[1] = onehot_seg(Dato); break;
+    case 2: Reg2 = Dato; Efectos_inicio = Ahora; break;
+    case 3: Reg3 = Dato & 0x1FFFF; break;
+    case 4:
+      Reg4 = Dato;
+      for (i=0 ; i<DIGITS ; i++){Frame[DIGITS-1-i] = Hex_seg[(Dato >> (4*i)) & 0xF];}
+      break;
+    case 5:
+      for (i=0 ; i<DIGITS && i<4 ; i++){Frame[i] = (uint8_t)(Dato >> (8*i));}
+      break;
+    case 7:
+      Reg7     = Dato;
+      Bcd_neg  = (Dato >> 31) & 1;
+      Magnitud = Bcd_neg != 0 ? (~Dato + 1) : Dato;
+      Bcd      = 0;
+      for (i=0 ; i<10 ; i++){
+        Bcd |= (uint64_t)(Magnitud % 10) << (4*i);
+        Magnitud /= 10;
+      }
+      Bcd_fin  = Ahora + BCD_CICLOS;
+      break;
+    case 11: Reg11 = Dato; break;
+    case 12: Reg12 = Dato & 0xFFFF; break;
+    case 13:
+      Reg13 = Dato & 0x1F;
+      if (Reg13 == 0 || Reg13 > 16){Reg13 = 16;}
+      break;
+    case 16: case 17: case 18: case 19:
+      Mensaje[(Offset >> 2) - 16] = Dato;
+      break;
+    default: break;
+  }
+};
+
+void Display_texto(char Texto[3], uint64_t Ahora){
+
+  uint64_t Ms;
+  uint32_t Pos = 0;
+  uint32_t Indice;
+  uint8_t Seg;
+  uint8_t i, j;
+
+  Display_actualiza(Ahora);
+  Ms = (Ahora - Efectos_inicio) / HOST_CICLOS_MS;
+
+  //Scroll position of the message
+  if ((Reg2 & 0x20) != 0 && (Reg11 >> 16) != 0){
+    Pos = (uint32_t)((Ms / (Reg11 >> 16)) % Reg13);
+  }
+
+  for (i=0 ; i<DIGITS ; i++){
+    switch (Reg2 & 3){
+      case 0:
+        Texto[i] = '-';
+        break;
+      case 2:
+        Indice = Pos + i;
+        Texto[i] = (Indice < Reg13) ? (char)(Mensaje[Indice / 4] >> (8*(Indice % 4))) : ' ';
+        break;
+      default:
+        //Frame buffer back to a character
+        Seg = Frame[i];
+        Texto[i] = '?';
+        for (j=0 ; j<16 ; j++){
+          if (Hex_seg[j] == Seg){Texto[i] = "0123456789AbCdEF"[j];}
+        }
+        if (Seg == SEG_DASH){Texto[i] = '-';}
+        if (Seg == SEG_BLANK){Texto[i] = ' ';}
+        if (Seg == SEG_OVF){Texto[i] = '=';}
+        if (Seg == 0x38){Texto[i] = 'L';}
+        if (Seg == 0x73){Texto[i] = 'P';}
+        break;
+    }
+    //Blink, off phase
+    if ((Reg2 & 0x10) != 0 && (Reg11 & 0xFFFF) != 0 && ((Ms / (Reg11 & 0xFFFF)) & 1) != 0){
+      Texto[i] = ' ';
+    }
+  }
+  Texto[DIGITS] = 0;
+};
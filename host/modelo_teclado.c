@@ -0,0 +1,414 @@
+/************************************************************************//**
+ * Model of rtl/periph/wb_peripheral_teclado.vhd and of its scanner
+ * rtl/periph/peripheral_teclado.vhd: 4x4 keypad, FIFO_DEPTH = 8,
+ * CAM_SLOTS = 16, CHORD_NUM = 4, CHORD_WINDOW = 50, LOCK_EN = false.
+ *
+ * Same register map, reset values and byte enables as the RTL. The
+ * scanner runs frame by frame (one frame every 4 x 3000 cycles) and
+ * only while a key or a debounce counter is changing, the rest of the
+ * time no event is scheduled. Everything the RTL settles in one or two
+ * cycles after a bus write (compare, code bank) is done at the write.
+ * *************************************************************************/
+
+#include "host.h"
+
+#define ROWS             4
+#define COLS             4
+#define TECLAS           (ROWS*COLS)
+#define FIFO_DEPTH       8
+#define CAM_SLOTS        16
+#define CHORD_NUM        4
+#define CHORD_WINDOW     50
+#define DEBOUNCE_FRAMES  5
+#define FRAME_CICLOS     (COLS*3000)
+
+/************************************************************************//**
+ * Registers
+ * *************************************************************************/
+static uint32_t Reg1, Reg2, Reg3, Reg5, Reg8, Reg9, Reg31;
+static uint8_t  Resultado;       // REG4 bits 3-0, bytes A/B/C/D matched
+static uint8_t  Cmp_done;
+static uint8_t  Cmp_match;
+static uint32_t Keymap[4];
+static uint32_t Chord[CHORD_NUM];
+
+// No reset in the RTL: the codes and the fifo storage survive the soft reset
+static uint32_t Cam[CAM_SLOTS];
+static uint32_t Cam_en;
+static uint32_t Fifo[FIFO_DEPTH];
+
+static uint8_t  Fifo_wp;         // Pointers with the wrap bit
+static uint8_t  Fifo_rp;
+static uint8_t  Fifo_ovf;
+
+/************************************************************************//**
+ * Scanner
+ * *************************************************************************/
+static uint16_t Fisico;          // Keys held on the keypad
+static uint16_t Teclas;          // Debounced keys, REG0
+static uint8_t  Debounce[TECLAS];
+static uint8_t  Ghost;
+static uint16_t Pendientes;      // Presses held while only part of a chord is pressed
+static uint64_t Ventana;         // End of the chord window, 0 if not running
+static uint64_t Fase;            // Scan start, a frame ends every FRAME_CICLOS
+static uint64_t Frame;           // End of the next frame
+
+static uint8_t  ghost(uint16_t Frame_teclas);
+static uint8_t  Activo(void);
+static void     Teclado_frame(void);
+static void     Teclado_pulsacion(uint16_t Pulsadas);
+static void     Teclado_guarda(uint32_t Entrada);
+static void     Teclado_compara(uint8_t Inicio);
+static uint8_t  indice(uint16_t Vector);
+static uint8_t  codigo(uint8_t Indice);
+
+
+void Teclado_reset(uint64_t Ahora){
+
+  uint8_t i;
+
+  Reg1 = 0;
+  Reg2 = 0;
+  Reg3 = 0;
+  Reg5 = 0;
+  Reg8 = DEBOUNCE_FRAMES;
+  Reg9 = 0;
+  Reg31 = 0;
+  Resultado = 0;
+  Cmp_done  = 0;
+  Cmp_match = 0;
+  Keymap[0] = 0x01040700;
+  Keymap[1] = 0x41424344;
+  Keymap[2] = 0x03060945;
+  Keymap[3] = 0x02050846;
+  for (i=0 ; i<CHORD_NUM ; i++){Chord[i] = 0;}
+  Fifo_wp  = 0;
+  Fifo_rp  = 0;
+  Fifo_ovf = 0;
+
+  Teclas = 0;
+  Ghost  = 0;
+  Pendientes = 0;
+  Ventana    = 0;
+  for (i=0 ; i<TECLAS ; i++){Debounce[i] = 0;}
+  Fase  = Ahora;
+  Frame = Ahora + FRAME_CICLOS;
+};
+
+/************************************************************************//**
+ * Scanner: scripted keys, scan frames and debounce
+ * *************************************************************************/
+void Teclado_pulsa(uint16_t Nuevas, uint64_t Ahora){
+
+  //Stopped scanner: the next frame is the first one after the change
+  if (Activo() == 0){
+    Frame = Fase + ((Ahora - Fase) / FRAME_CICLOS + 1) * FRAME_CICLOS;
+  }
+  Fisico = Nuevas;
+};
+
+uint16_t Teclado_teclas(void){
+
+  return Teclas;
+};
+
+uint64_t Teclado_proximo(uint64_t Ahora){
+
+  (void)Ahora;
+  return (Activo() != 0) ? Frame : HOST_NUNCA;
+};
+
+void Teclado_evento(uint64_t Ahora){
+
+  while (Frame <= Ahora && Activo() != 0){
+    Teclado_frame();
+    Frame += FRAME_CICLOS;
+  }
+};
+
+static uint8_t ghost(uint16_t Frame_teclas){
+
+  uint8_t a, b, Comunes;
+
+  //Two columns sharing two or more rows
+  for (a=0 ; a<COLS-1 ; a++){
+    for (b=a+1 ; b<COLS ; b++){
+      Comunes = (Frame_teclas >> (ROWS*a)) & (Frame_teclas >> (ROWS*b)) & ((1 << ROWS) - 1);
+      if ((Comunes & (Comunes - 1)) != 0){return 1;}
+    }
+  }
+  return 0;
+};
+
+static uint8_t Activo(void){
+
+  uint8_t i;
+
+  if (Fisico != Teclas || Ghost != ghost(Fisico) || Pendientes != 0){return 1;}
+  for (i=0 ; i<TECLAS ; i++){
+    if (Debounce[i] != 0){return 1;}
+  }
+  return 0;
+};
+
+static void Teclado_frame(void){
+
+  uint16_t Previas = Teclas;
+  uint8_t Settle = Reg8 & 0xF;
+  uint8_t i;
+
+  //An ambiguous frame is discarded, keys and counters keep their values
+  if (ghost(Fisico) != 0){
+    Ghost = 1;
+    Teclado_pulsacion(0);
+    return;
+  }
+  Ghost = 0;
+
+  for (i=0 ; i<TECLAS ; i++){
+    if (((Fisico ^ Teclas) & (1U << i)) != 0){
+      if (((Debounce[i] + 1) & 0xF) >= Settle){
+        Teclas ^= 1U << i;
+        Debounce[i] = 0;
+      }
+      else{
+        Debounce[i]++;
+      }
+    }
+    else{
+      Debounce[i] = 0;
+    }
+  }
+
+  Teclado_pulsacion(Teclas & ~Previas);
+};
+
+static void Teclado_pulsacion(uint16_t Pulsadas){
+
+  int8_t Acorde = -1;
+  uint8_t Parte = 0;
+  int8_t i;
+
+  //Lowest enabled chord with exactly the keys held, and chords with only some of them
+  for (i=CHORD_NUM-1 ; i>=0 ; i--){
+    if ((Chord[i] & 0x80000000UL) == 0){continue;}
+    if ((Chord[i] & 0xFFFF) == Teclas){Acorde = i;}
+    else if (Teclas != 0 && (Teclas & ~Chord[i]) == 0){Parte = 1;}
+  }
+
+  if (Pulsadas != 0 && Acorde >= 0){
+    Teclado_guarda((1UL << 30) | ((uint32_t)Acorde << 24) | (Chord[Acorde] & 0x00FFFFFF));
+    Pendientes = 0;
+    Ventana    = 0;
+    return;
+  }
+
+  //Part of a chord: the presses wait CHORD_WINDOW frames for the rest of it
+  Pendientes |= Pulsadas;
+  if (Parte != 0){
+    if (Ventana == 0){Ventana = Frame + (uint64_t)CHORD_WINDOW * FRAME_CICLOS;}
+    if (Frame < Ventana){return;}
+  }
+  else{
+    Ventana = 0;
+  }
+
+  //One event per key, highest index first, the RTL stores one per cycle
+  for (i=TECLAS-1 ; i>=0 ; i--){
+    if ((Pendientes & (1U << i)) != 0){
+      Teclado_guarda(((uint32_t)i << 24) | ((uint32_t)codigo(i) << 16) | (1U << i));
+    }
+  }
+  Pendientes = 0;
+};
+
+static void Teclado_guarda(uint32_t Entrada){
+
+  Reg5 |= 1UL << 8;
+
+  if ((uint8_t)(Fifo_wp - Fifo_rp) == FIFO_DEPTH){
+    Fifo_ovf = 1;
+  }
+  else{
+    Fifo[Fifo_wp & (FIFO_DEPTH-1)] = Entrada;
+    Fifo_wp = (Fifo_wp + 1) & (2*FIFO_DEPTH-1);
+  }
+
+  if ((Reg5 & 0x1) != 0){Host_irq_teclado();}
+};
+
+static uint8_t indice(uint16_t Vector){
+
+  uint8_t i, Indice = 0;
+
+  //Highest key of the One Hot vector
+  for (i=0 ; i<TECLAS ; i++){
+    if ((Vector & (1U << i)) != 0){Indice = i;}
+  }
+  return Indice;
+};
+
+static uint8_t codigo(uint8_t Indice){
+
+  return (uint8_t)(Keymap[Indice / 4] >> (8*(Indice % 4)));
+};
+
+/************************************************************************//**
+ * Password compare
+ * *************************************************************************/
+static void Teclado_compara(uint8_t Inicio){
+
+  uint8_t Match = 1;
+  uint8_t k;
+
+  //Every commanded byte is compared, each matching one sets its result bit (sticky until reset)
+  for (k=0 ; k<4 ; k++){
+    if ((Reg2 & (1UL << k)) != 0){
+      if (((Reg1 ^ Reg3) & (0xFFUL << (8*k))) == 0){Resultado |= 1 << k;}
+      else{Match = 0;}
+    }
+  }
+
+  if (Inicio != 0){
+    Cmp_done  = 1;
+    Cmp_match = Match;
+    Reg5 |= 1UL << 9;
+    if ((Reg5 & 0x2) != 0){Host_irq_teclado();}
+  }
+
+  //New password command
+  if ((Reg2 & 0xFF) == 0x10){
+    Reg3 = Reg1;
+    Reg2 = 0;
+  }
+};
+
+/************************************************************************//**
+ * Bus
+ * *************************************************************************/
+uint32_t Teclado_lee(uint32_t Offset, uint64_t Ahora){
+
+  uint32_t Palabra = Offset >> 2;
+  uint32_t Dato = 0;
+  uint8_t Nivel = (Fifo_wp - Fifo_rp) & (2*FIFO_DEPTH-1);
+  uint8_t i;
+
+  (void)Ahora;
+  switch (Palabra){
+    case 0:  Dato = Teclas; break;
+    case 1:  Dato = Reg1; break;
+    case 2:  Dato = Reg2; break;
+    case 3:  Dato = Reg3; break;
+    case 4:
+      Dato = ((uint32_t)(Cmp_done & !Cmp_match) << 10) | ((uint32_t)Cmp_match << 9) | ((uint32_t)Cmp_done << 8) | Resultado;
+      break;
+    case 5:  Dato = Reg5; break;
+    case 6:
+      if (Nivel != 0){
+        Dato = 0x80000000UL | Fifo[Fifo_rp & (FIFO_DEPTH-1)];
+        Fifo_rp = (Fifo_rp + 1) & (2*FIFO_DEPTH-1);
+      }
+      break;
+    case 7:  Dato = Nivel | ((uint32_t)Fifo_ovf << 16); break;
+    case 8:  Dato = Reg8; break;
+    case 9:  Dato = Reg9; break;
+    case 11: Dato = (Cam_en >> (Reg9 & (CAM_SLOTS-1))) & 1; break;
+    case 12:
+      for (i=CAM_SLOTS ; i>0 ; i--){
+        if ((Cam_en & (1UL << (i-1))) != 0 && Cam[i-1] == Reg1){Dato = 0x80000000UL | (i-1);}
+      }
+      break;
+    case 13:
+      Dato = (uint32_t)Ghost << 30;
+      if (Teclas != 0){
+        Dato |= 0x80000000UL | ((uint32_t)indice(Teclas) << 8) | codigo(indice(Teclas));
+      }
+      break;
+    case 14: case 15: case 16: case 17:
+      Dato = Keymap[Palabra - 14];
+      break;
+    case 18: case 19: case 20: case 21:
+      Dato = Chord[Palabra - 18];
+      break;
+    case 27: case 28: Dato = Reg2; break;
+    case 29: Dato = Reg1; break;
+    case 30: //Status snapshot
+      Dato = ((uint32_t)(Nivel != 0) << 31) | ((uint32_t)Fifo_ovf << 30) |
+             ((uint32_t)(Teclas != 0) << 29) | ((uint32_t)Ghost << 28) |
+             ((Reg2 & 0xF) << 24) | ((uint32_t)Resultado << 20) |
+             ((uint32_t)Cmp_done << 19) | ((uint32_t)Cmp_match << 18) |
+             (((Reg5 >> 8) & 0x3) << 16) | ((uint32_t)Nivel << 8);
+      if (Teclas != 0){Dato |= codigo(indice(Teclas));}
+      Reg5 &= ~(Reg31 >> 8); //Read-to-clear mask, bits 17-16 on bits 9-8
+      break;
+    case 31: Dato = Reg31; break;
+    default: break;
+  }
+  return Dato;
+};
+
+void Teclado_escribe(uint32_t Offset, uint32_t Dato, uint8_t Sel, uint64_t Ahora){
+
+  uint32_t Palabra = Offset >> 2;
+  uint32_t Mascara = 0;
+  uint32_t Bits;
+  uint8_t Inicio = 0;
+  uint8_t i;
+
+  (void)Ahora;
+  for (i=0 ; i<4 ; i++){
+    if ((Sel & (1 << i)) != 0){Mascara |= 0xFFUL << (8*i);}
+  }
+  Bits = Dato & Mascara;
+
+  switch (Palabra){
+    case 1: Reg1 = (Reg1 & ~Mascara) | Bits; break;
+    case 2:
+      Reg2 = (Reg2 & ~Mascara) | Bits;
+      Inicio = (Reg2 & 0xF) != 0;
+      break;
+    case 3: Reg3 = (Reg3 & ~Mascara) | Bits; break;
+    case 5:
+      if ((Sel & 1) != 0){Reg5 = (Reg5 & ~0x3UL) | (Dato & 0x3);}
+      Reg5 &= ~(Bits & 0x300);
+      break;
+    case 7:
+      if ((Bits & 0x00001) != 0){Fifo_rp = Fifo_wp;}
+      if ((Bits & 0x10000) != 0){Fifo_ovf = 0;}
+      break;
+    case 8: Reg8 = ((Reg8 & ~Mascara) | Bits) & 0xF; break;
+    case 9: Reg9 = ((Reg9 & ~Mascara) | Bits) & (CAM_SLOTS-1); break;
+    case 10:
+      if (Sel == 0xF){
+        Cam[Reg9] = Dato;
+        Cam_en |= 1UL << Reg9;
+      }
+      break;
+    case 11:
+      if ((Sel & 1) != 0){Cam_en = (Cam_en & ~(1UL << Reg9)) | ((Dato & 1) << Reg9);}
+      break;
+    case 14: case 15: case 16: case 17:
+      Keymap[Palabra - 14] = (Keymap[Palabra - 14] & ~Mascara) | Bits;
+      break;
+    case 18: case 19: case 20: case 21:
+      Chord[Palabra - 18] = (Chord[Palabra - 18] & ~Mascara) | Bits;
+      break;
+    case 27:
+      Reg2 |= Bits;
+      Inicio = (Bits & 0xF) != 0;
+      break;
+    case 28: Reg2 &= ~Bits; break;
+    case 29:
+      Reg1 = (Reg1 & ~Mascara) | Bits;
+      Reg2 |= Sel;
+      Inicio = 1;
+      break;
+    case 31:
+      if ((Sel & 0x4) != 0){Reg31 = Dato & 0x30000;}
+      break;
+    default: break; // REG0 and REG4 are rewritten every cycle by the RTL
+  }
+
+  if (Inicio != 0){Cmp_done = 0;}
+  Teclado_compara(Inicio);
+};
@@ -0,0 +1,189 @@
+// #################################################################################################
+// # << NEORV32 host stub - API of the NEORV32 software framework for a Linux build >>             #
+// # ********************************************************************************************* #
+// # Only the subset used by Proyecto/ and Practica_*/ is declared. The names and the numbers of  #
+// # the traps, CSRs and fast interrupts are the ones of the NEORV32 v1.6 headers, the bodies are #
+// # in neorv32_host.c and run on virtual time (12 MHz processor clock).                           #
+// #################################################################################################
+
+#ifndef neorv32_h
+#define neorv32_h
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <stddef.h>
+
+
+/**********************************************************************//**
+ * Processor clock of the iCEBreaker setup, the virtual time counts it
+ **************************************************************************/
+#define NEORV32_HOST_CLOCK 12000000
+
+
+/**********************************************************************//**
+ * Control and status registers
+ **************************************************************************/
+enum NEORV32_CSR_enum {
+  CSR_MSTATUS = 0x300,
+  CSR_MIE     = 0x304,
+  CSR_MIP     = 0x344
+};
+
+/** Interrupt enable / pending bits of mie and mip */
+enum NEORV32_CSR_MIE_enum {
+  CSR_MIE_MSIE    =  3,
+  CSR_MIE_MTIE    =  7,
+  CSR_MIE_MEIE    = 11,
+  CSR_MIE_FIRQ0E  = 16,
+  CSR_MIE_FIRQ1E  = 17,
+  CSR_MIE_FIRQ2E  = 18,
+  CSR_MIE_FIRQ3E  = 19,
+  CSR_MIE_FIRQ8E  = 24
+};
+
+enum NEORV32_CSR_MIP_enum {
+  CSR_MIP_MSIP    =  3,
+  CSR_MIP_MTIP    =  7,
+  CSR_MIP_MEIP    = 11,
+  CSR_MIP_FIRQ0P  = 16,
+  CSR_MIP_FIRQ1P  = 17,
+  CSR_MIP_FIRQ2P  = 18,
+  CSR_MIP_FIRQ3P  = 19,
+  CSR_MIP_FIRQ8P  = 24
+};
+
+
+/**********************************************************************//**
+ * Runtime environment: trap IDs
+ **************************************************************************/
+enum NEORV32_RTE_TRAP_enum {
+  RTE_TRAP_I_MISALIGNED =  0,
+  RTE_TRAP_I_ACCESS     =  1,
+  RTE_TRAP_I_ILLEGAL    =  2,
+  RTE_TRAP_BREAKPOINT   =  3,
+  RTE_TRAP_L_MISALIGNED =  4,
+  RTE_TRAP_L_ACCESS     =  5,
+  RTE_TRAP_S_MISALIGNED =  6,
+  RTE_TRAP_S_ACCESS     =  7,
+  RTE_TRAP_UENV_CALL    =  8,
+  RTE_TRAP_MENV_CALL    =  9,
+  RTE_TRAP_MSI          = 10,
+  RTE_TRAP_MTI          = 11,
+  RTE_TRAP_MEI          = 12,
+  RTE_TRAP_FIRQ_0       = 13,
+  RTE_TRAP_FIRQ_1       = 14,
+  RTE_TRAP_FIRQ_2       = 15,
+  RTE_TRAP_FIRQ_3       = 16,
+  RTE_TRAP_FIRQ_8       = 21,
+  RTE_TRAP_FIRQ_15      = 28
+};
+
+#define NEORV32_RTE_NUM_TRAPS 29
+
+
+/**********************************************************************//**
+ * Fast interrupts of the processor-internal peripherals
+ **************************************************************************/
+#define CFS_RTE_ID             RTE_TRAP_FIRQ_1
+#define CFS_FIRQ_ENABLE        CSR_MIE_FIRQ1E
+#define CFS_FIRQ_PENDING       CSR_MIP_FIRQ1P
+#define UART0_TX_RTE_ID        RTE_TRAP_FIRQ_3
+#define UART0_TX_FIRQ_ENABLE   CSR_MIE_FIRQ3E
+#define UART0_TX_FIRQ_PENDING  CSR_MIP_FIRQ3P
+#define XIRQ_RTE_ID            RTE_TRAP_FIRQ_8
+#define XIRQ_FIRQ_ENABLE       CSR_MIE_FIRQ8E
+#define XIRQ_FIRQ_PENDING      CSR_MIP_FIRQ8P
+
+
+/**********************************************************************//**
+ * UART
+ **************************************************************************/
+enum NEORV32_UART_PARITY_enum {
+  PARITY_NONE = 0,
+  PARITY_EVEN = 2,
+  PARITY_ODD  = 3
+};
+
+enum NEORV32_UART_FLOW_CONTROL_enum {
+  FLOW_CONTROL_NONE = 0,
+  FLOW_CONTROL_RTS  = 1,
+  FLOW_CONTROL_CTS  = 2,
+  FLOW_CONTROL_RTSCTS = 3
+};
+
+
+/**********************************************************************//**
+ * CPU
+ **************************************************************************/
+int      neorv32_cpu_irq_enable(uint8_t irq_sel);
+int      neorv32_cpu_irq_disable(uint8_t irq_sel);
+void     neorv32_cpu_eint(void);
+void     neorv32_cpu_dint(void);
+void     neorv32_cpu_sleep(void);
+void     neorv32_cpu_delay_ms(uint32_t time_ms);
+uint64_t neorv32_cpu_get_cycle(void);
+void     neorv32_cpu_csr_write(const int csr_id, uint32_t data);
+uint32_t neorv32_cpu_csr_read(const int csr_id);
+
+void     neorv32_cpu_store_unsigned_word(uint32_t addr, uint32_t wdata);
+void     neorv32_cpu_store_unsigned_half(uint32_t addr, uint16_t wdata);
+void     neorv32_cpu_store_unsigned_byte(uint32_t addr, uint8_t wdata);
+uint32_t neorv32_cpu_load_unsigned_word(uint32_t addr);
+uint16_t neorv32_cpu_load_unsigned_half(uint32_t addr);
+uint8_t  neorv32_cpu_load_unsigned_byte(uint32_t addr);
+
+
+/**********************************************************************//**
+ * Runtime environment
+ **************************************************************************/
+void neorv32_rte_setup(void);
+int  neorv32_rte_exception_install(uint8_t id, void (*handler)(void));
+int  neorv32_rte_exception_uninstall(uint8_t id);
+
+
+/**********************************************************************//**
+ * CFS
+ **************************************************************************/
+int      neorv32_cfs_available(void);
+
+
+/**********************************************************************//**
+ * GPIO
+ **************************************************************************/
+int      neorv32_gpio_available(void);
+void     neorv32_gpio_port_set(uint64_t port_data);
+uint64_t neorv32_gpio_port_get(void);
+
+
+/**********************************************************************//**
+ * Machine system timer
+ **************************************************************************/
+void     neorv32_mtime_set_time(uint64_t time);
+uint64_t neorv32_mtime_get_time(void);
+void     neorv32_mtime_set_timecmp(uint64_t timecmp);
+uint64_t neorv32_mtime_get_timecmp(void);
+
+
+/**********************************************************************//**
+ * External interrupt controller
+ **************************************************************************/
+int  neorv32_xirq_setup(void);
+void neorv32_xirq_global_enable(void);
+void neorv32_xirq_global_disable(void);
+int  neorv32_xirq_install(uint8_t ch, void (*handler)(void));
+int  neorv32_xirq_uninstall(uint8_t ch);
+
+
+/**********************************************************************//**
+ * UART0
+ **************************************************************************/
+void neorv32_uart0_setup(uint32_t baudrate, uint8_t parity, uint8_t flow_con);
+int  neorv32_uart0_tx_busy(void);
+void neorv32_uart0_putc(char c);
+char neorv32_uart0_getc(void);
+int  neorv32_uart0_char_received(void);
+char neorv32_uart0_char_received_get(void);
+void neorv32_uart0_print(const char *s);
+void neorv32_uart0_printf(const char *format, ...);
+
+#endif // neorv32_h
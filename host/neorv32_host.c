@@ -0,0 +1,549 @@
+/************************************************************************//**
+ * NEORV32 host stub: the API of the software framework on virtual time.
+ *
+ * Every call costs the cycles of its bus access (HOST_CICLOS_*), the C
+ * code of the firmware between calls costs nothing. Time only moves
+ * forward through Host_avanza(), which runs the events due (scripted
+ * keys, keypad scan frames, UART, MTIME) and then takes the pending
+ * interrupts as the CPU would: one at a time, not nested.
+ * neorv32_cpu_sleep() jumps straight to the next event.
+ * *************************************************************************/
+
+#include <stdio.h>
+#include <stdarg.h>
+#include "neorv32.h"
+#include "host.h"
+
+/************************************************************************//**
+ * State of the processor
+ * *************************************************************************/
+uint64_t Host_ciclos;                                  // Virtual time
+Host_desvios_t Host_desvios;                           // Known deviations of the RTL, see host.h
+
+static uint32_t Mie;                                   // Interrupt enables
+static uint32_t Mip;                                   // Fast interrupts pending, MTIP is computed
+static uint8_t  Mstatus_mie;                           // Global interrupt enable
+static uint8_t  En_trap;                               // A handler is running, no nesting
+static void   (*Rte[NEORV32_RTE_NUM_TRAPS])(void);
+
+static void   (*Xirq[32])(void);
+static uint32_t Xirq_ier;                              // Channels enabled
+static uint32_t Xirq_ipr;                              // Channels pending
+
+static uint64_t Mtimecmp;
+static int64_t  Mtime_offset;                          // MTIME = Host_ciclos + offset
+
+static uint64_t Uart_fin;                              // End of the character being sent
+static uint8_t  Uart_irq;                              // TX done interrupt still to be raised
+static uint32_t Uart_ciclos_car = 10 * (NEORV32_HOST_CLOCK / 19200);
+
+static uint64_t Gpio_salida;
+
+/************************************************************************//**
+ * Prototypes
+ * *************************************************************************/
+static uint64_t Host_proximo(uint64_t Fin);
+static void     Host_eventos(void);
+static uint32_t Host_pendientes(void);
+static void     Host_trap(void);
+static void     Host_xirq(void);
+static uint32_t Host_lee(uint32_t Addr);
+static void     Host_escribe(uint32_t Addr, uint32_t Dato, uint8_t Sel);
+
+
+void Host_reset(void){
+
+  uint8_t i;
+
+  Host_ciclos  = 0;
+  Mie          = 0;
+  Mip          = 0;
+  Mstatus_mie  = 0;
+  En_trap      = 0;
+  Xirq_ier     = 0;
+  Xirq_ipr     = 0;
+  Mtimecmp     = 0;
+  Mtime_offset = 0;
+  Uart_fin     = 0;
+  Uart_irq     = 0;
+  Gpio_salida  = 0;
+  for (i=0 ; i<NEORV32_RTE_NUM_TRAPS ; i++){Rte[i] = NULL;}
+  for (i=0 ; i<32 ; i++){Xirq[i] = NULL;}
+  Host_desvios.Display_parcial = 0;
+
+  //Power-on reset of the tops (c_por): the peripheral reset is held for the
+  //first 15 cycles, so every register starts at its reset value. The code
+  //bank and the fifo storage have no reset, they start at 0 as the iCE40 does.
+  Teclado_reset(0);
+  Display_reset(0);
+};
+
+void Host_avanza(uint64_t Ciclos){
+
+  Host_hasta(Host_ciclos + Ciclos);
+  Host_trap();
+};
+
+void Host_hasta(uint64_t Fin){
+
+  //Jump from event to event, the models only change on them
+  while (Host_ciclos < Fin){
+    Host_ciclos = Host_proximo(Fin);
+    Host_eventos();
+  }
+};
+
+static uint64_t Host_proximo(uint64_t Fin){
+
+  uint64_t Proximo = Fin;
+  uint64_t Evento;
+
+  Evento = Guion_proximo();
+  if (Evento < Proximo){Proximo = Evento;}
+  //The keypad does not scan while its reset is held
+  Evento = ((Gpio_salida & 0x20) == 0) ? Teclado_proximo(Host_ciclos) : HOST_NUNCA;
+  if (Evento < Proximo){Proximo = Evento;}
+  if (Uart_irq != 0 && Uart_fin < Proximo){Proximo = Uart_fin;}
+  if ((Mie & (1 << CSR_MIE_MTIE)) != 0){
+    Evento = Mtimecmp - (uint64_t)Mtime_offset;
+    if (Evento > Host_ciclos && Evento < Proximo){Proximo = Evento;}
+  }
+  return (Proximo > Host_ciclos) ? Proximo : Host_ciclos;
+};
+
+static void Host_eventos(void){
+
+  if (Guion_proximo() <= Host_ciclos){Guion_evento(Host_ciclos);}
+  if ((Gpio_salida & 0x20) == 0 && Teclado_proximo(Host_ciclos) <= Host_ciclos){Teclado_evento(Host_ciclos);}
+  if (Uart_irq != 0 && Uart_fin <= Host_ciclos){
+    Uart_irq = 0;
+    Mip |= 1UL << UART0_TX_FIRQ_PENDING;
+  }
+};
+
+static uint32_t Host_pendientes(void){
+
+  uint32_t Pendientes = Mip;
+
+  if (Host_ciclos + (uint64_t)Mtime_offset >= Mtimecmp){
+    Pendientes |= 1UL << CSR_MIP_MTIP;
+  }
+  return Pendientes & Mie;
+};
+
+static void Host_trap(void){
+
+  uint32_t Pendientes;
+  uint8_t Bit, Id;
+
+  if (En_trap != 0 || Mstatus_mie == 0){return;}
+
+  while ((Pendientes = Host_pendientes()) != 0){
+    //Same priority as the CPU: MEI, MSI, MTI, then FIRQ 0..15
+    if      ((Pendientes & (1UL << CSR_MIP_MEIP)) != 0){Bit = CSR_MIP_MEIP; Id = RTE_TRAP_MEI;}
+    else if ((Pendientes & (1UL << CSR_MIP_MSIP)) != 0){Bit = CSR_MIP_MSIP; Id = RTE_TRAP_MSI;}
+    else if ((Pendientes & (1UL << CSR_MIP_MTIP)) != 0){Bit = CSR_MIP_MTIP; Id = RTE_TRAP_MTI;}
+    else{
+      for (Bit=CSR_MIP_FIRQ0P ; (Pendientes & (1UL << Bit)) == 0 ; Bit++);
+      Id = RTE_TRAP_FIRQ_0 + (Bit - CSR_MIP_FIRQ0P);
+    }
+
+    En_trap = 1;
+    Host_hasta(Host_ciclos + HOST_CICLOS_TRAP);
+    if (Id == XIRQ_RTE_ID){
+      Host_xirq();
+    }
+    else if (Rte[Id] != NULL){
+      Rte[Id]();
+    }
+    else{
+      //Default handler of the runtime environment: report it and mask the source
+      fprintf(stderr, "host: trap %u sin manejador en el ciclo %llu\n", Id, (unsigned long long)Host_ciclos);
+      Mie &= ~(1UL << Bit);
+    }
+    En_trap = 0;
+  }
+};
+
+static void Host_xirq(void){
+
+  uint32_t Pendientes;
+  uint8_t Ch;
+
+  //The library handler acknowledges the fast interrupt and runs the lowest pending channel
+  Mip &= ~(1UL << XIRQ_FIRQ_PENDING);
+  Pendientes = Xirq_ipr & Xirq_ier;
+  if (Pendientes == 0){return;}
+  for (Ch=0 ; (Pendientes & (1UL << Ch)) == 0 ; Ch++);
+  Xirq_ipr &= ~(1UL << Ch);
+  if (Xirq[Ch] != NULL){Xirq[Ch]();}
+  if ((Xirq_ipr & Xirq_ier) != 0){Mip |= 1UL << XIRQ_FIRQ_PENDING;}
+};
+
+void Host_irq_teclado(void){
+
+#ifdef TECLADO_CFS
+  Mip |= 1UL << CFS_FIRQ_PENDING;
+#else
+  //Rising edge channel of the XIRQ
+  if ((Xirq_ier & (1UL << HOST_TECLADO_XIRQ_CH)) != 0){
+    Xirq_ipr |= 1UL << HOST_TECLADO_XIRQ_CH;
+    Mip |= 1UL << XIRQ_FIRQ_PENDING;
+  }
+#endif
+};
+
+/************************************************************************//**
+ * Bus: keypad and display models, the rest of the map reads zero
+ * *************************************************************************/
+static uint32_t Host_lee(uint32_t Addr){
+
+  uint32_t Dato = 0;
+
+  if ((Addr & ~(uint32_t)(HOST_TECLADO_SIZE-1)) == HOST_TECLADO_BASE){
+    Dato = Teclado_lee(Addr & (HOST_TECLADO_SIZE-1) & ~3UL, Host_ciclos);
+#ifdef TECLADO_CFS
+    Host_avanza(HOST_CICLOS_IO);
+    return Dato;
+#endif
+  }
+  else if ((Addr & ~(uint32_t)(HOST_DISPLAY_SIZE-1)) == HOST_DISPLAY_BASE){
+    Dato = Display_lee(Addr & (HOST_DISPLAY_SIZE-1) & ~3UL, Host_ciclos);
+  }
+  Host_avanza(HOST_CICLOS_WB);
+  return Dato;
+};
+
+static void Host_escribe(uint32_t Addr, uint32_t Dato, uint8_t Sel){
+
+  //The soft reset of the peripherals (GPIO bit 5) is held
+  if ((Gpio_salida & 0x20) == 0){
+    if ((Addr & ~(uint32_t)(HOST_TECLADO_SIZE-1)) == HOST_TECLADO_BASE){
+      Teclado_escribe(Addr & (HOST_TECLADO_SIZE-1) & ~3UL, Dato, Sel, Host_ciclos);
+#ifdef TECLADO_CFS
+      Host_avanza(HOST_CICLOS_IO);
+      return;
+#endif
+    }
+    else if ((Addr & ~(uint32_t)(HOST_DISPLAY_SIZE-1)) == HOST_DISPLAY_BASE){
+      Display_escribe(Addr & (HOST_DISPLAY_SIZE-1) & ~3UL, Dato, Sel, Host_ciclos);
+      Guion_display(Host_ciclos);
+    }
+  }
+  Host_avanza(HOST_CICLOS_WB);
+};
+
+void neorv32_cpu_store_unsigned_word(uint32_t addr, uint32_t wdata){
+
+  Host_escribe(addr, wdata, 0xF);
+};
+
+void neorv32_cpu_store_unsigned_half(uint32_t addr, uint16_t wdata){
+
+  //The bus replicates the half word on both halves
+  Host_escribe(addr, wdata * 0x00010001UL, (addr & 2) != 0 ? 0xC : 0x3);
+};
+
+void neorv32_cpu_store_unsigned_byte(uint32_t addr, uint8_t wdata){
+
+  //The bus replicates the byte on every lane
+  Host_escribe(addr, wdata * 0x01010101UL, 1 << (addr & 3));
+};
+
+uint32_t neorv32_cpu_load_unsigned_word(uint32_t addr){
+
+  return Host_lee(addr);
+};
+
+uint16_t neorv32_cpu_load_unsigned_half(uint32_t addr){
+
+  return (uint16_t)(Host_lee(addr) >> (8*(addr & 2)));
+};
+
+uint8_t neorv32_cpu_load_unsigned_byte(uint32_t addr){
+
+  return (uint8_t)(Host_lee(addr) >> (8*(addr & 3)));
+};
+
+/************************************************************************//**
+ * CPU
+ * *************************************************************************/
+int neorv32_cpu_irq_enable(uint8_t irq_sel){
+
+  Mie |= 1UL << irq_sel;
+  Host_avanza(HOST_CICLOS_CSR);
+  return 0;
+};
+
+int neorv32_cpu_irq_disable(uint8_t irq_sel){
+
+  Mie &= ~(1UL << irq_sel);
+  Host_avanza(HOST_CICLOS_CSR);
+  return 0;
+};
+
+void neorv32_cpu_eint(void){
+
+  Mstatus_mie = 1;
+  Host_avanza(HOST_CICLOS_CSR);
+};
+
+void neorv32_cpu_dint(void){
+
+  Mstatus_mie = 0;
+  Host_avanza(HOST_CICLOS_CSR);
+};
+
+void neorv32_cpu_sleep(void){
+
+  //WFI wakes up on a pending enabled interrupt, even with mstatus.mie cleared
+  while (Host_pendientes() == 0){
+    Host_ciclos = Host_proximo(HOST_NUNCA);
+    Host_eventos();
+  }
+  Host_avanza(HOST_CICLOS_CSR);
+};
+
+void neorv32_cpu_delay_ms(uint32_t time_ms){
+
+  Host_avanza((uint64_t)time_ms * HOST_CICLOS_MS);
+};
+
+uint64_t neorv32_cpu_get_cycle(void){
+
+  Host_avanza(HOST_CICLOS_CSR);
+  return Host_ciclos;
+};
+
+void neorv32_cpu_csr_write(const int csr_id, uint32_t data){
+
+  switch (csr_id){
+    case CSR_MSTATUS: Mstatus_mie = (data >> 3) & 1; break;
+    case CSR_MIE:     Mie = data; break;
+    case CSR_MIP:     Mip &= data | 0x0000FFFFUL; break; // Only the fast interrupts can be cleared
+    default: break;
+  }
+  Host_avanza(HOST_CICLOS_CSR);
+};
+
+uint32_t neorv32_cpu_csr_read(const int csr_id){
+
+  uint32_t Dato = 0;
+
+  switch (csr_id){
+    case CSR_MSTATUS: Dato = (uint32_t)Mstatus_mie << 3; break;
+    case CSR_MIE:     Dato = Mie; break;
+    case CSR_MIP:     Dato = Mip | (Host_pendientes() & (1UL << CSR_MIP_MTIP)); break;
+    default: break;
+  }
+  Host_avanza(HOST_CICLOS_CSR);
+  return Dato;
+};
+
+/************************************************************************//**
+ * Runtime environment
+ * *************************************************************************/
+void neorv32_rte_setup(void){
+
+  uint8_t i;
+
+  for (i=0 ; i<NEORV32_RTE_NUM_TRAPS ; i++){Rte[i] = NULL;}
+};
+
+int neorv32_rte_exception_install(uint8_t id, void (*handler)(void)){
+
+  if (id >= NEORV32_RTE_NUM_TRAPS){return 1;}
+  Rte[id] = handler;
+  return 0;
+};
+
+int neorv32_rte_exception_uninstall(uint8_t id){
+
+  return neorv32_rte_exception_install(id, NULL);
+};
+
+/************************************************************************//**
+ * CFS: present in the build of the keypad inside it
+ * *************************************************************************/
+int neorv32_cfs_available(void){
+
+#ifdef TECLADO_CFS
+  return 1;
+#else
+  return 0;
+#endif
+};
+
+/************************************************************************//**
+ * GPIO: bit 5 is the soft reset of the keypad and the display
+ * *************************************************************************/
+int neorv32_gpio_available(void){
+
+  return 1;
+};
+
+void neorv32_gpio_port_set(uint64_t port_data){
+
+  //Registers cleared while the reset is held, the scan restarts when it is released
+  if (((port_data | Gpio_salida) & 0x20) != 0){
+    Teclado_reset(Host_ciclos);
+    Display_reset(Host_ciclos);
+  }
+  Gpio_salida = port_data;
+  Guion_gpio(port_data);
+  Host_avanza(HOST_CICLOS_IO);
+};
+
+uint64_t neorv32_gpio_port_get(void){
+
+  uint64_t Entrada = 0;
+
+#ifdef HOST_GPIO_TECLADO
+  //Practica_2: key valid on bit 24, index on bits 23-20, One Hot keys on bits 19-4
+  uint16_t Teclas = Teclado_teclas();
+  uint8_t i;
+
+  if (Teclas != 0){
+    for (i=15 ; (Teclas & (1U << i)) == 0 ; i--);
+    Entrada = (1ULL << 24) | ((uint64_t)i << 20);
+  }
+  Entrada |= (uint64_t)Teclas << 4;
+#endif
+  Host_avanza(HOST_CICLOS_IO);
+  return Entrada;
+};
+
+/************************************************************************//**
+ * Machine system timer, counts the processor clock
+ * *************************************************************************/
+void neorv32_mtime_set_time(uint64_t time){
+
+  Mtime_offset = (int64_t)(time - Host_ciclos);
+  Host_avanza(2*HOST_CICLOS_IO);
+};
+
+uint64_t neorv32_mtime_get_time(void){
+
+  uint64_t Tiempo = Host_ciclos + (uint64_t)Mtime_offset;
+
+  Host_avanza(2*HOST_CICLOS_IO);
+  return Tiempo;
+};
+
+void neorv32_mtime_set_timecmp(uint64_t timecmp){
+
+  Mtimecmp = timecmp;
+  Host_avanza(2*HOST_CICLOS_IO);
+};
+
+uint64_t neorv32_mtime_get_timecmp(void){
+
+  Host_avanza(2*HOST_CICLOS_IO);
+  return Mtimecmp;
+};
+
+/************************************************************************//**
+ * External interrupt controller, all channels on the rising edge
+ * *************************************************************************/
+int neorv32_xirq_setup(void){
+
+  uint8_t i;
+
+  for (i=0 ; i<32 ; i++){Xirq[i] = NULL;}
+  Xirq_ier = 0;
+  Xirq_ipr = 0;
+  return 0;
+};
+
+void neorv32_xirq_global_enable(void){
+
+  Mie |= 1UL << XIRQ_FIRQ_ENABLE;
+  Host_avanza(HOST_CICLOS_CSR);
+};
+
+void neorv32_xirq_global_disable(void){
+
+  Mie &= ~(1UL << XIRQ_FIRQ_ENABLE);
+  Host_avanza(HOST_CICLOS_CSR);
+};
+
+int neorv32_xirq_install(uint8_t ch, void (*handler)(void)){
+
+  if (ch >= 32){return 1;}
+  Xirq[ch] = handler;
+  Xirq_ier |= 1UL << ch;
+  return 0;
+};
+
+int neorv32_xirq_uninstall(uint8_t ch){
+
+  if (ch >= 32){return 1;}
+  Xirq[ch] = NULL;
+  Xirq_ier &= ~(1UL << ch);
+  Xirq_ipr &= ~(1UL << ch);
+  return 0;
+};
+
+/************************************************************************//**
+ * UART0: 10 bits per character, TX done interrupt at the end of each one
+ * *************************************************************************/
+void neorv32_uart0_setup(uint32_t baudrate, uint8_t parity, uint8_t flow_con){
+
+  (void)parity;
+  (void)flow_con;
+  Uart_ciclos_car = 10 * (NEORV32_HOST_CLOCK / baudrate);
+};
+
+int neorv32_uart0_tx_busy(void){
+
+  Host_avanza(HOST_CICLOS_IO);
+  return Host_ciclos < Uart_fin;
+};
+
+void neorv32_uart0_putc(char c){
+
+  //Wait for the transmitter as the library does
+  if (Host_ciclos < Uart_fin){Host_hasta(Uart_fin);}
+  Guion_uart(c);
+  Uart_fin = Host_ciclos + Uart_ciclos_car;
+  Uart_irq = 1;
+  Host_avanza(HOST_CICLOS_IO);
+};
+
+char neorv32_uart0_getc(void){
+
+  //Nothing is ever received: wait until the scenario ends
+  Host_hasta(HOST_NUNCA);
+  return 0;
+};
+
+int neorv32_uart0_char_received(void){
+
+  Host_avanza(HOST_CICLOS_IO);
+  return 0;
+};
+
+char neorv32_uart0_char_received_get(void){
+
+  Host_avanza(HOST_CICLOS_IO);
+  return 0;
+};
+
+void neorv32_uart0_print(const char *s){
+
+  while (*s != 0){
+    if (*s == '\n'){neorv32_uart0_putc('\r');}
+    neorv32_uart0_putc(*s++);
+  }
+};
+
+void neorv32_uart0_printf(const char *format, ...){
+
+  char Texto[256];
+  va_list Args;
+
+  va_start(Args, format);
+  vsnprintf(Texto, sizeof(Texto), format, Args);
+  va_end(Args);
+  neorv32_uart0_print(Texto);
+};
@@ -47,8 +47,23 @@ NEORV32_CORE_SRC := \
 
   NEORV32_PER_SRC := \
   $(RTL_CORE_SRC)/../periph/peripheral_teclado.vhd \
+  $(RTL_CORE_SRC)/../periph/peripheral_cerradura.vhd \
   $(RTL_CORE_SRC)/../periph/wb_peripheral_teclado.vhd \
-  $(RTL_CORE_SRC)/../periph/wb_7SegmentDisplay.vhd
+  $(RTL_CORE_SRC)/../periph/wb_7SegmentDisplay.vhd \
+  $(RTL_CORE_SRC)/../periph/wb_led_sequencer.vhd \
+  $(RTL_CORE_SRC)/../periph/wb_buttons.vhd \
+  $(RTL_CORE_SRC)/../periph/wb_interconnect.vhd
+
+# KEYPAD_CFS=1 builds the keypad inside the Custom Functions Subsystem:
+# rtl/periph/neorv32_cfs.vhd replaces the template of the core. KEYPAD_CFS_GEN
+# is the matching generic of the Proyecto top, every elaboration has to use it
+ifeq ($(KEYPAD_CFS),1)
+NEORV32_CORE_SRC := $(filter-out $(RTL_CORE_SRC)/neorv32_cfs.vhd,$(NEORV32_CORE_SRC))
+NEORV32_PER_SRC += $(RTL_CORE_SRC)/../periph/neorv32_cfs.vhd
+KEYPAD_CFS_GEN := -gKEYPAD_CFS=true
+else
+KEYPAD_CFS_GEN := -gKEYPAD_CFS=false
+endif
 
 # Before including this partial makefile, NEORV32_MEM_SRC needs to be set
 # (containing two VHDL sources: one for IMEM and one for DMEM)
@@ -0,0 +1,42 @@
+#!/usr/bin/env python3
+"""
+Fmax and utilization of one nextpnr-ice40 build as "bench,metric,value,unit"
+lines, the results format of sim/periph.
+
+  python3 report.py build/classic/report.json synth_classic >> synth.csv
+"""
+
+import json
+import re
+import sys
+
+# Cells of the iCE40UP5K that are worth following
+CELDAS = {
+    "ICESTORM_LC":    "lc",
+    "ICESTORM_RAM":   "ebr",
+    "ICESTORM_SPRAM": "spram",
+    "ICESTORM_DSP":   "dsp",
+    "SB_IO":          "io",
+}
+
+
+def main():
+    if len(sys.argv) != 3:
+        sys.exit("usage: report.py <nextpnr report.json> <bench>")
+    with open(sys.argv[1]) as f:
+        informe = json.load(f)
+    bench = sys.argv[2]
+
+    for reloj, fmax in sorted(informe.get("fmax", {}).items()):
+        nombre = re.sub(r"[^0-9A-Za-z]+", "_", reloj).strip("_")
+        print(f"{bench},fmax_{nombre},{fmax['achieved']:.2f},MHz")
+
+    uso = informe.get("utilization", {})
+    for celda, nombre in CELDAS.items():
+        if celda in uso:
+            print(f"{bench},{nombre}_used,{uso[celda]['used']},cells")
+            print(f"{bench},{nombre}_pct,{100.0 * uso[celda]['used'] / uso[celda]['available']:.1f},%")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,125 @@
+
+library ieee;
+use ieee.std_logic_1164.all;
+use ieee.numeric_std.all;
+
+library neorv32;
+use neorv32.neorv32_package.all;
+
+-- Custom Functions Subsystem with the keypad peripheral inside.
+-- Replaces rtl/core/neorv32_cfs.vhd when the design is built with
+-- KEYPAD_CFS=1 (osflow/filesets.mk), same entity as the core template.
+-- The keypad registers REG0-REG31 are the 32 CFS registers, so the
+-- firmware reaches them through the processor-internal IO bus instead
+-- of the external Wishbone interface. The display stays on Wishbone:
+-- the CFS window has room for one register map only.
+--
+-- Conduits:
+--   cfs_in_i(0)            : soft reset of the keypad (gpio_o(5) of the top)
+--   cfs_in_i(8+ROWS-1..8)  : keypad rows, active low
+--   cfs_out_o(COLS-1..0)   : keypad columns, the driven one is low
+-- The key pressed / compare done interrupt goes to the CFS fast interrupt.
+
+entity neorv32_cfs is
+  generic (
+    CFS_CONFIG   : std_ulogic_vector(31 downto 0); -- custom CFS configuration generic, unused
+    CFS_IN_SIZE  : positive := 32;  -- size of CFS input conduit in bits
+    CFS_OUT_SIZE : positive := 32   -- size of CFS output conduit in bits
+  );
+  port (
+    -- host access --
+    clk_i       : in  std_ulogic; -- global clock line
+    rstn_i      : in  std_ulogic; -- global reset line, low-active, use as async
+    addr_i      : in  std_ulogic_vector(31 downto 0); -- address
+    rden_i      : in  std_ulogic; -- read enable
+    wren_i      : in  std_ulogic; -- word write enable
+    data_i      : in  std_ulogic_vector(31 downto 0); -- data in
+    data_o      : out std_ulogic_vector(31 downto 0); -- data out
+    ack_o       : out std_ulogic; -- transfer acknowledge
+    err_o       : out std_ulogic; -- transfer error
+    -- clock generator --
+    clkgen_en_o : out std_ulogic; -- enable clock generator
+    clkgen_i    : in  std_ulogic_vector(07 downto 0); -- "clock" inputs
+    -- interrupt --
+    irq_o       : out std_ulogic; -- interrupt request
+    -- custom io (conduits) --
+    cfs_in_i    : in  std_ulogic_vector(CFS_IN_SIZE-1 downto 0);  -- custom inputs
+    cfs_out_o   : out std_ulogic_vector(CFS_OUT_SIZE-1 downto 0)  -- custom outputs
+  );
+end neorv32_cfs;
+
+architecture neorv32_cfs_rtl of neorv32_cfs is
+
+    -- keypad of the iCEBreaker PMOD --
+    constant ROWS : natural := 4;
+    constant COLS : natural := 4;
+
+    -----------------------------------------------------------
+    -- SIGNALS                                              ---
+    -----------------------------------------------------------
+
+    signal s_reset      : std_ulogic; -- Global or soft reset of the keypad
+    signal s_access     : std_ulogic; -- Read or write of a CFS register
+    signal s_col        : std_logic_vector(COLS-1 downto 0);
+
+    begin
+
+    -- Sanity Checks --------------------------------------------------------------------------
+    -- ----------------------------------------------------------------------------------------
+    assert not (CFS_IN_SIZE < 8+ROWS) report "neorv32_cfs config ERROR: <CFS_IN_SIZE> has to be at least 12 bits for the keypad rows." severity error;
+    assert not (CFS_OUT_SIZE < COLS) report "neorv32_cfs config ERROR: <CFS_OUT_SIZE> has to be at least 4 bits for the keypad columns." severity error;
+
+    -------------------------------------------------------
+    -- Keypad                                           ---
+    -------------------------------------------------------
+    -- The IO bus strobes rden_i/wren_i for one cycle and expects the
+    -- acknowledge in the next one: the keypad as a pipelined slave
+    -- registers ack and data exactly that way. Data is zero when the
+    -- CFS is not accessed, as the IO bus ORs the responses.
+
+    s_reset  <= (not rstn_i) or cfs_in_i(0);
+    s_access <= rden_i or wren_i;
+
+    peripheral_teclado_0: entity neorv32.wb_peripheral_teclado
+    generic map(WB_ADDR_BASE   => cfs_base_c,
+                WB_ADDR_SIZE   => cfs_size_c,
+                ROWS           => ROWS,
+                COLS           => COLS,
+                WB_PIPELINED   => true )
+    port map(
+      clk_i     => clk_i,
+      reset_i   => s_reset,
+      en_i      => '1',
+
+      wb_tag_i  => (others => '0'),
+      wb_adr_i  => addr_i,
+      wb_dat_i  => data_i,
+      wb_dat_o  => data_o,
+      wb_we_i   => wren_i,
+      wb_sel_i  => "1111",           -- the IO bus only writes full words
+      wb_stb_i  => s_access,
+      wb_cyc_i  => s_access,
+      wb_lock_i => '0',
+      wb_ack_o  => ack_o,
+      wb_err_o  => err_o,
+      wb_stall_o => open,            -- never stalls
+
+      irq_o     => irq_o,            -- key pressed / compare done interrupt
+
+      Row_i     => cfs_in_i(8+ROWS-1 downto 8),
+      Col_o     => s_col,
+
+      Lock_active_o => open,         -- no lock engine in the CFS
+      Lock_led_o    => open,
+      Lock_open_o   => open,
+      Lock_text_o   => open
+      );
+
+    -------------------------------------------------------
+    -- Concurrents Outputs                              ---
+    -------------------------------------------------------
+    cfs_out_o   <= std_ulogic_vector(resize(unsigned(s_col), CFS_OUT_SIZE));
+
+    clkgen_en_o <= '0'; -- the keypad has its own prescaler
+
+end neorv32_cfs_rtl;
@@ -0,0 +1,252 @@
+library ieee;
+use ieee.std_logic_1164.all;
+use ieee.numeric_std.all;
+
+library neorv32;
+use neorv32.neorv32_package.all;
+
+entity peripheral_cerradura is
+  generic(
+    TICK_PRESCALER       : integer := 12000  -- Clock cycles of the window timer, 12000 = 1 ms at 12 MHz
+  );
+  port (
+    -- 12MHz Clock input
+    clk_i                : in std_logic;
+    reset_i              : in std_logic;
+
+    -- Engine running, when low it is kept in IDLE with nothing typed
+    en_i                 : in std_logic;
+
+    -- Key events from the keypad, one cycle per pressed key or chord
+    key_valid_i          : in std_logic;
+    key_code_i           : in std_logic_vector(7 downto 0);
+
+    -- Configuration
+    password_i           : in std_logic_vector(31 downto 0); -- Byte A on bits 7-0 ... byte D on bits 31-24
+    open_ms_i            : in std_logic_vector(15 downto 0); -- Door open window
+    fail_ms_i            : in std_logic_vector(15 downto 0); -- Lockout after a wrong byte
+    reset_code_i         : in std_logic_vector(7 downto 0);  -- Key code that clears the typed code
+    alarm_code_i         : in std_logic_vector(7 downto 0);  -- Key code that locks at once
+
+    -- Status
+    State_o              : out std_logic_vector(1 downto 0); -- "00" idle, "01" door open, "10" locked out
+    Stages_o             : out std_logic_vector(3 downto 0); -- Bytes A/B/C/D accepted
+    Digits_o             : out std_logic_vector(7 downto 0); -- Last two digits typed
+    Open_evt_o           : out std_logic;                    -- One cycle, the door opens
+    Fail_evt_o           : out std_logic;                    -- One cycle, a lockout starts
+
+    -- Board outputs
+    Led_o                : out std_logic_vector(4 downto 0); -- Bits 3-0 accepted bytes, bit 4 locked out
+    Open_o               : out std_logic;                    -- Door open window
+    Text_o               : out std_logic_vector(15 downto 0) -- Display characters in ASCII, digit 0 on bits 7-0
+
+    );
+end entity;
+
+architecture peripheral_rtl of peripheral_cerradura is
+
+    -- TYPES
+
+    type lock_state_t is (
+        LK_IDLE,  -- Waiting for digits and A/B/C/D commands
+        LK_OPEN,  -- All bytes accepted, door open window
+        LK_FAIL   -- Wrong byte or alarm code, keys are discarded
+        );
+
+    -- FUNCTIONS
+
+    -- ASCII of a hex digit
+    function hex_char_f(hex : std_logic_vector(3 downto 0)) return std_logic_vector is
+    begin
+        if (unsigned(hex) < 10) then
+            return std_logic_vector(to_unsigned(16#30#, 8) + unsigned(hex));
+        else
+            return std_logic_vector(to_unsigned(16#41# - 10, 8) + unsigned(hex));
+        end if;
+    end function;
+
+    -- SIGNALS
+
+    signal c_state     : lock_state_t;
+    signal n_state     : lock_state_t;
+
+    signal c_digits    : std_logic_vector(7 downto 0); -- Two digits typed, as total_value in the firmware
+    signal n_digits    : std_logic_vector(7 downto 0);
+    signal c_typed     : std_logic;                    -- A digit was typed since the last command
+    signal n_typed     : std_logic;
+
+    signal c_stages    : std_logic_vector(3 downto 0);
+    signal n_stages    : std_logic_vector(3 downto 0);
+
+    signal c_timer     : unsigned(15 downto 0);        -- Milliseconds left of the window
+    signal n_timer     : unsigned(15 downto 0);
+    signal c_tick_cnt  : integer range 0 to TICK_PRESCALER-1;
+    signal n_tick_cnt  : integer range 0 to TICK_PRESCALER-1;
+
+    signal c_open_evt  : std_logic;
+    signal n_open_evt  : std_logic;
+    signal c_fail_evt  : std_logic;
+    signal n_fail_evt  : std_logic;
+
+    begin
+
+    -- Sanity Checks --------------------------------------------------------------------------
+    -- ----------------------------------------------------------------------------------------
+    assert not (TICK_PRESCALER < 1) report "peripheral_cerradura config ERROR: <TICK_PRESCALER> has to be at least 1." severity error;
+
+    -------------------------------------------------------
+    -- Concurrents Outputs                              ---
+    -------------------------------------------------------
+    State_o    <= "01" when (c_state = LK_OPEN) else
+                  "10" when (c_state = LK_FAIL) else "00";
+    Stages_o   <= c_stages;
+    Digits_o   <= c_digits;
+    Open_evt_o <= c_open_evt;
+    Fail_evt_o <= c_fail_evt;
+
+    Led_o      <= "10000" when (c_state = LK_FAIL) else '0' & c_stages;
+    Open_o     <= '1' when (c_state = LK_OPEN) else '0';
+
+    -- Same characters as the firmware: the typed digits, OP and CL
+    Text_o     <= x"504F" when (c_state = LK_OPEN) else
+                  x"4C43" when (c_state = LK_FAIL) else
+                  hex_char_f(c_digits(3 downto 0)) & hex_char_f(c_digits(7 downto 4)) when (c_typed = '1') else
+                  x"2020";
+
+    peripheral_cerradura_sinc: process(clk_i, reset_i)
+    begin
+        if (reset_i = '1') then
+            c_state     <= LK_IDLE;
+            c_digits    <= (others => '0');
+            c_typed     <= '0';
+            c_stages    <= (others => '0');
+            c_timer     <= (others => '0');
+            c_tick_cnt  <= 0;
+            c_open_evt  <= '0';
+            c_fail_evt  <= '0';
+
+        elsif ( rising_edge(clk_i)) then
+            c_state     <= n_state;
+            c_digits    <= n_digits;
+            c_typed     <= n_typed;
+            c_stages    <= n_stages;
+            c_timer     <= n_timer;
+            c_tick_cnt  <= n_tick_cnt;
+            c_open_evt  <= n_open_evt;
+            c_fail_evt  <= n_fail_evt;
+
+        end if;
+    end process;
+
+    -------------------------------------------------------
+    -- Lock sequence                                    ---
+    -------------------------------------------------------
+    -- Digits shift into a two digit code. A/B/C/D (key codes 65-68)
+    -- compare it with byte 0-3 of the password: a match lights its LED,
+    -- a mismatch locks out for fail_ms_i. When the four bytes are
+    -- accepted the door opens for open_ms_i. At the end of a window
+    -- everything is cleared, as Reset_teclado() did.
+
+    peripheral_cerradura_comb: process(
+        en_i,
+        key_valid_i,
+        key_code_i,
+        password_i,
+        open_ms_i,
+        fail_ms_i,
+        reset_code_i,
+        alarm_code_i,
+        c_state,
+        c_digits,
+        c_typed,
+        c_stages,
+        c_timer,
+        c_tick_cnt
+        )
+        variable v_byte   : integer range 0 to 3;
+        variable v_stages : std_logic_vector(3 downto 0);
+    begin
+        n_state    <= c_state;
+        n_digits   <= c_digits;
+        n_typed    <= c_typed;
+        n_stages   <= c_stages;
+        n_timer    <= c_timer;
+        n_tick_cnt <= c_tick_cnt;
+        n_open_evt <= '0';
+        n_fail_evt <= '0';
+
+        if (c_tick_cnt /= TICK_PRESCALER-1) then
+            n_tick_cnt <= c_tick_cnt + 1;
+        else
+            n_tick_cnt <= 0;
+        end if;
+
+        case c_state is
+            when LK_IDLE =>
+                if (key_valid_i = '1') then
+                    if (unsigned(key_code_i) < 10) then -- Digit
+                        n_digits <= c_digits(3 downto 0) & key_code_i(3 downto 0);
+                        n_typed  <= '1';
+
+                    elsif (unsigned(key_code_i) >= 65) and (unsigned(key_code_i) <= 68) then -- A/B/C/D
+                        v_byte   := to_integer(unsigned(key_code_i)) - 65;
+                        v_stages := c_stages;
+                        v_stages(v_byte) := '1';
+                        n_digits <= (others => '0');
+                        n_typed  <= '0';
+                        if (c_digits = password_i(8*v_byte+7 downto 8*v_byte)) then
+                            n_stages <= v_stages;
+                            if (v_stages = "1111") then
+                                n_state    <= LK_OPEN;
+                                n_timer    <= unsigned(open_ms_i);
+                                n_open_evt <= '1';
+                            end if;
+                        else
+                            n_state    <= LK_FAIL;
+                            n_stages   <= (others => '0');
+                            n_timer    <= unsigned(fail_ms_i);
+                            n_fail_evt <= '1';
+                        end if;
+
+                    elsif (key_code_i = reset_code_i) then
+                        n_digits <= (others => '0');
+                        n_typed  <= '0';
+                        n_stages <= (others => '0');
+
+                    elsif (key_code_i = alarm_code_i) then
+                        n_state    <= LK_FAIL;
+                        n_digits   <= (others => '0');
+                        n_typed    <= '0';
+                        n_stages   <= (others => '0');
+                        n_timer    <= unsigned(fail_ms_i);
+                        n_fail_evt <= '1';
+                    end if;
+                end if;
+
+            when others => -- Timed window, the keys are discarded
+                if (c_tick_cnt = TICK_PRESCALER-1) then
+                    if (c_timer = 0) then
+                        n_state  <= LK_IDLE;
+                        n_digits <= (others => '0');
+                        n_typed  <= '0';
+                        n_stages <= (others => '0');
+                    else
+                        n_timer <= c_timer - 1;
+                    end if;
+                end if;
+        end case;
+
+        -- Stopped: nothing typed and no window running
+        if (en_i = '0') then
+            n_state    <= LK_IDLE;
+            n_digits   <= (others => '0');
+            n_typed    <= '0';
+            n_stages   <= (others => '0');
+            n_timer    <= (others => '0');
+            n_open_evt <= '0';
+            n_fail_evt <= '0';
+        end if;
+
+    end process;
+
+end architecture;
@@ -1,81 +1,172 @@
-
 library ieee;
 use ieee.std_logic_1164.all;
 use ieee.numeric_std.all;
 
+library neorv32;
+use neorv32.neorv32_package.all;
+
 entity peripheral_teclado is
+  generic(
+    ROWS                 : integer := 4;    -- Rows of the key matrix (2..8)
+    COLS                 : integer := 4;    -- Columns of the key matrix (2..8)
+    SCAN_PRESCALER       : integer := 3000; -- Clock cycles each column is driven (min 4), 3000 = 1 ms per 4 column frame at 12 MHz
+    DEBOUNCE_WIDTH       : integer := 4;    -- Width of the per-key debounce counters
+    DEBOUNCE_FRAMES      : integer := 5     -- Default settle time in scan frames
+  );
   port (
     -- 12MHz Clock input
     clk_i                : in std_logic;
     reset_i              : in std_logic;
 
-    -- Rows
+    -- Rows, active low
     en_i                 : in std_logic;
-    Row_1_i              : in std_logic;
-    Row_2_i              : in std_logic;
-    Row_3_i              : in std_logic;
-    Row_4_i              : in std_logic;
-    
-    -- Cols
-    Col_1_o              : out std_logic;
-    Col_2_o              : out std_logic;
-    Col_3_o              : out std_logic;
-    Col_4_o              : out std_logic;
-
-    -- Key codificated in One Hot
-    Key_o     : out std_logic_vector(15 downto 0)
+    Row_i                : in std_logic_vector(ROWS-1 downto 0);
+
+    -- Cols, the driven one is low
+    Col_o                : out std_logic_vector(COLS-1 downto 0);
+
+    -- Debounce: frames a key has to be stable before it changes (0 = no debounce)
+    settle_i             : in std_logic_vector(DEBOUNCE_WIDTH-1 downto 0) := std_logic_vector(to_unsigned(DEBOUNCE_FRAMES, DEBOUNCE_WIDTH));
+
+    -- Key codificated in One Hot, ROWS bits per column
+    Key_o     : out std_logic_vector(ROWS*COLS-1 downto 0);
+
+    -- Key codificated as an index (highest pressed key wins)
+    Key_valid_o : out std_logic;
+    Key_index_o : out std_logic_vector(index_size_f(ROWS*COLS)-1 downto 0);
+
+    -- Last frame was ambiguous (ghost key possible) and was discarded
+    Ghost_o     : out std_logic
 
     );
 end entity;
 
 architecture peripheral_rtl of peripheral_teclado is
 
+    -- CONSTANTS
+
+    constant keys_c      : natural := ROWS*COLS;
+    constant key_abits_c : natural := index_size_f(keys_c);
+
+    -- TYPES
+
+    type debounce_t is array (0 to keys_c-1) of unsigned(DEBOUNCE_WIDTH-1 downto 0);
+
+    -- FUNCTIONS
+
+    -- Two or more bits set
+    function two_or_more_f(v : std_logic_vector(ROWS-1 downto 0)) return boolean is
+        variable v_count : natural range 0 to ROWS;
+    begin
+        v_count := 0;
+        for i in 0 to ROWS-1 loop
+            if (v(i) = '1') then
+                v_count := v_count + 1;
+            end if;
+        end loop;
+        return v_count >= 2;
+    end function;
+
+    -- Without diodes, three keys on the corners of a rectangle make the
+    -- fourth one look pressed: two columns sharing two or more rows.
+    function ghost_f(frame : std_logic_vector(keys_c-1 downto 0)) return boolean is
+    begin
+        for a in 0 to COLS-2 loop
+            for b in a+1 to COLS-1 loop
+                if two_or_more_f(frame(ROWS*a+ROWS-1 downto ROWS*a) and frame(ROWS*b+ROWS-1 downto ROWS*b)) then
+                    return true;
+                end if;
+            end loop;
+        end loop;
+        return false;
+    end function;
+
     -- SIGNALS
 
-    signal c_counter : unsigned (1 downto 0);
-    signal n_counter : unsigned (1 downto 0);
+    signal c_prescaler : integer range 0 to SCAN_PRESCALER-1;
+    signal n_prescaler : integer range 0 to SCAN_PRESCALER-1;
+
+    signal c_counter : integer range 0 to COLS-1; -- Column being driven
+    signal n_counter : integer range 0 to COLS-1;
+
+    signal c_key_value    : std_logic_vector(keys_c-1 downto 0); -- Debounced keys
+    signal n_key_value    : std_logic_vector(keys_c-1 downto 0);
+
+    signal c_key     : std_logic_vector(keys_c-1 downto 0); -- Keys of the frame being scanned
+    signal n_key     : std_logic_vector(keys_c-1 downto 0);
+
+    signal c_debounce : debounce_t;
+    signal n_debounce : debounce_t;
 
-    signal c_key_value    : std_logic_vector(15 downto 0);
-    signal n_key_value    : std_logic_vector(15 downto 0);
+    signal c_ghost   : std_logic;
+    signal n_ghost   : std_logic;
 
-    signal c_key     : std_logic_vector(15 downto 0);
-    signal n_key     : std_logic_vector(15 downto 0);
+    signal c_col     : std_logic_vector(COLS-1 downto 0);
+    signal n_col     : std_logic_vector(COLS-1 downto 0);
 
-    signal c_col     : std_logic_vector(3 downto 0);
-    signal n_col     : std_logic_vector(3 downto 0);
+    signal c_row_meta : std_logic_vector(ROWS-1 downto 0); -- Row synchronizer, first stage
+    signal c_row_sync : std_logic_vector(ROWS-1 downto 0); -- Row synchronizer, second stage
 
-    signal s_row     : std_logic_vector(3 downto 0);
+    signal s_frame   : std_logic_vector(keys_c-1 downto 0); -- Complete frame, valid at the last column
 
     begin
 
+    -- Sanity Checks --------------------------------------------------------------------------
+    -- ----------------------------------------------------------------------------------------
+    assert not ((ROWS < 2) or (ROWS > 8)) report "peripheral_teclado config ERROR: <ROWS> has to be 2 to 8." severity error;
+    assert not ((COLS < 2) or (COLS > 8)) report "peripheral_teclado config ERROR: <COLS> has to be 2 to 8." severity error;
+    assert not (SCAN_PRESCALER < 4) report "peripheral_teclado config ERROR: <SCAN_PRESCALER> has to be at least 4 to cover the row synchronizer." severity error;
+    assert not (DEBOUNCE_FRAMES > 2**DEBOUNCE_WIDTH-1) report "peripheral_teclado config ERROR: <DEBOUNCE_FRAMES> does not fit in <DEBOUNCE_WIDTH> bits." severity error;
+
     -------------------------------------------------------
     -- Concurrents Outputs                              ---
     -------------------------------------------------------
-    Col_1_o <= c_col(0);
-    Col_2_o <= c_col(1);
-    Col_3_o <= c_col(2);
-    Col_4_o <= c_col(3);
-    
-    s_row   <= Row_4_i &
-               Row_3_i &
-               Row_2_i &
-               Row_1_i;
-
-    Key_o   <= c_key_value;   
+    Col_o   <= c_col;
+
+    Key_o   <= c_key_value;
+    Ghost_o <= c_ghost;
+
+    -------------------------------------------------------
+    -- Priority encoder                                 ---
+    -------------------------------------------------------
+    -- Same result as walking the One Hot vector upwards and
+    -- keeping the last key found.
+
+    peripheral_teclado_index_comb: process(c_key_value)
+    begin
+        Key_valid_o <= '0';
+        Key_index_o <= (others => '0');
+        for i in 0 to keys_c-1 loop
+            if (c_key_value(i) = '1') then
+                Key_valid_o <= '1';
+                Key_index_o <= std_logic_vector(to_unsigned(i, key_abits_c));
+            end if;
+        end loop;
+    end process;
 
     peripheral_teclado_sinc: process(clk_i, reset_i)
     begin
         if (reset_i = '1') then
-            c_counter   <=  (others => '0');
-            c_col       <= (others => '0');   
+            c_prescaler <= 0;
+            c_counter   <= 0;
+            c_col       <= (0 => '0', others => '1');
             c_key       <= (others => '0');
-            c_key_value <= (others => '0'); 
+            c_key_value <= (others => '0');
+            c_debounce  <= (others => (others => '0'));
+            c_ghost     <= '0';
+            c_row_meta  <= (others => '1');
+            c_row_sync  <= (others => '1');
 
         elsif ( rising_edge(clk_i)) then
+            c_prescaler <= n_prescaler;
             c_counter   <= n_counter;
             c_col       <= n_col;
             c_key       <= n_key;
             c_key_value <= n_key_value;
+            c_debounce  <= n_debounce;
+            c_ghost     <= n_ghost;
+            c_row_meta  <= Row_i;
+            c_row_sync  <= c_row_meta;
 
         end if;
     end process;
@@ -83,56 +174,86 @@ architecture peripheral_rtl of peripheral_teclado is
     -------------------------------------------------------
     -- Read key processs                                ---
     -------------------------------------------------------
+    -- Each column is driven low for SCAN_PRESCALER cycles and the rows
+    -- are sampled on the last one, once the synchronizer has settled.
+    -- A frame takes COLS*SCAN_PRESCALER cycles.
+    -- The rows of column N are stored on the slot N+1 (mod COLS) of the
+    -- key vector, the One Hot order the firmware tables expect.
+
+    s_frame_comb: process(c_counter, c_key, c_row_sync)
+    begin
+        s_frame <= c_key;
+        if (c_counter = COLS-1) then
+            s_frame(ROWS-1 downto 0) <= not(c_row_sync);
+        end if;
+    end process;
 
     peripheral_teclado_decode: process(
-        c_counter, 
-        s_row, 
-        c_col, 
-        c_key, 
-        c_key_value
+        en_i,
+        settle_i,
+        c_prescaler,
+        c_counter,
+        c_row_sync,
+        c_col,
+        c_key,
+        c_key_value,
+        c_debounce,
+        c_ghost,
+        s_frame
         )
+        variable v_slot : integer range 0 to COLS-1;
     begin
+        n_prescaler <= c_prescaler;
+        n_counter   <= c_counter;
+        n_col       <= c_col;
         n_key       <= c_key;
-        n_col       <= (others => '0');
-        n_counter   <= (others => '0');
         n_key_value <= c_key_value;
-
-        -- Sampling the value each four cycles.
-        if(c_counter = "00" and c_key /= "00000000" ) then
-            n_key_value <= c_key;     
-            n_key <= (others => '0'); -- Reset de value
-        end if;
+        n_debounce  <= c_debounce;
+        n_ghost     <= c_ghost;
 
         if (en_i = '1') then
-            n_counter   <= c_counter + 1;
+            if (c_prescaler /= SCAN_PRESCALER-1) then
+                n_prescaler <= c_prescaler + 1;
+            else
+                n_prescaler <= 0;
 
-            case (c_counter) is
-                when "00" =>
-                    n_col   <=  "1110";
-                    if (s_row /= "1111") then
-                        n_key <= x"000" & not(s_row);
-                    end if;
-                    
-                when "01" =>
-                    n_col   <=  "1101";
-                    if (s_row /= "1111") then
-                        n_key <= x"00" & not(s_row) & x"0";
-                    end if;
+                -- Store the rows and drive the next column
+                v_slot := (c_counter + 1) mod COLS;
+                n_key(ROWS*v_slot+ROWS-1 downto ROWS*v_slot) <= not(c_row_sync);
 
-                when "10" =>
-                    n_col   <=  "1011";
-                    if (s_row /= "1111") then
-                        n_key <= x"0" & not(s_row) & x"00";
-                    end if;
+                -- Decoded from the counter, so a column register that powers
+                -- up with any value is right from the first scan step on
+                n_col         <= (others => '1');
+                n_col(v_slot) <= '0';
+
+                if (c_counter /= COLS-1) then
+                    n_counter <= c_counter + 1;
+                else
+                    n_counter <= 0;
+
+                    -- End of frame: an ambiguous frame is discarded, the
+                    -- keys and their debounce counters keep their values
+                    if ghost_f(s_frame) then
+                        n_ghost <= '1';
+                    else
+                        n_ghost <= '0';
 
-                when others =>
-                    n_col   <=  "0111";
-                    if (s_row /= "1111") then
-                        n_key <= not(s_row) & x"000";
+                        -- Debounce every key
+                        for i in 0 to keys_c-1 loop
+                            n_debounce(i) <= (others => '0');
+                            if (s_frame(i) /= c_key_value(i)) then
+                                if (c_debounce(i) + 1 >= unsigned(settle_i)) then
+                                    n_key_value(i) <= s_frame(i);
+                                else
+                                    n_debounce(i) <= c_debounce(i) + 1;
+                                end if;
+                            end if;
+                        end loop;
                     end if;
-            end case;
+                end if;
+            end if;
         end if;
 
     end process;
 
-end architecture;
\ No newline at end of file
+end architecture;
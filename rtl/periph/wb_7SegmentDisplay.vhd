@@ -9,8 +9,12 @@ use neorv32.neorv32_package.all;
 
 entity wb_7segmentDisplay is
   generic(
-    WB_ADDR_BASE        : std_ulogic_vector(31 downto 0) := x"90000020";
-    WB_ADDR_SIZE        : integer := 16
+    WB_ADDR_BASE        : std_ulogic_vector(31 downto 0) := x"90000100";
+    WB_ADDR_SIZE        : integer := 128;
+    DIGITS              : integer := 2;      -- Digits of the frame buffer (2..8)
+    REFRESH_PRESCALER   : integer := 65536;  -- Clock cycles each digit is shown after reset, 183 Hz per digit at 12 MHz
+    TICK_PRESCALER      : integer := 12000;  -- Clock cycles of the effects time base, 12000 = 1 ms at 12 MHz
+    WB_PIPELINED        : boolean := false   -- Wishbone B4 pipelined slave, registered ack/data
   );
       -- Top-level ports. Board pins are defined in setups/osflow/constraints/iCEBreaker.pcf
   port (
@@ -30,6 +34,7 @@ entity wb_7segmentDisplay is
     wb_lock_i            : in   std_ulogic;
     wb_ack_o             : out  std_ulogic;
     wb_err_o             : out  std_ulogic;
+    wb_stall_o           : out  std_ulogic;
 
     -- 7 Segment Dislay
     aa_o                 : out  std_logic;
@@ -39,7 +44,15 @@ entity wb_7segmentDisplay is
     ae_o                 : out  std_logic;
     af_o                 : out  std_logic;
     ag_o                 : out  std_logic;
-    ds_o                 : out  std_logic
+    ds_o                 : out  std_logic;  -- Digit select of the 2 digit PMOD, '0' = digit 0
+
+    -- One Hot digit select, for boards with more than 2 digits
+    dig_o                : out  std_logic_vector(DIGITS-1 downto 0);
+
+    -- External text, shown instead of the registers while ext_en_i is high
+    -- (lock engine of the keypad), ASCII with digit 0 on bits 7-0
+    ext_en_i             : in   std_ulogic := '0';
+    ext_text_i           : in   std_ulogic_vector(DIGITS*8-1 downto 0) := (others => '0')
 
 
     );
@@ -58,6 +71,123 @@ architecture wb_7segmentDisplay_rtl of wb_7segmentDisplay is
     constant addr_mask_c : std_ulogic_vector(31 downto 0) := std_ulogic_vector(to_unsigned(WB_ADDR_SIZE-1, 32));
     constant all_zero_c  : std_ulogic_vector(31 downto 0) := (others => '0');
 
+    -- Segments of a digit: bit 0 = a, bit 1 = b, ... bit 6 = g, bit 7 unused
+    constant seg_dash_c  : std_ulogic_vector(7 downto 0) := x"40";
+    constant seg_blank_c : std_ulogic_vector(7 downto 0) := x"00";
+    constant seg_ovf_c   : std_ulogic_vector(7 downto 0) := x"49"; -- Segments a, d and g
+
+    type frame_t is array (0 to DIGITS-1) of std_ulogic_vector(7 downto 0);
+    type message_t is array (0 to 3) of std_ulogic_vector(31 downto 0);
+
+    -- Hexadecimal character to segments
+    function hex_seg_f(hex : std_ulogic_vector(3 downto 0)) return std_ulogic_vector is
+    begin
+        case hex is
+            when x"0"   => return x"3F";
+            when x"1"   => return x"06";
+            when x"2"   => return x"5B";
+            when x"3"   => return x"4F";
+            when x"4"   => return x"66";
+            when x"5"   => return x"6D";
+            when x"6"   => return x"7D";
+            when x"7"   => return x"07";
+            when x"8"   => return x"7F";
+            when x"9"   => return x"6F";
+            when x"A"   => return x"77";
+            when x"B"   => return x"7C"; -- b
+            when x"C"   => return x"39";
+            when x"D"   => return x"5E"; -- d
+            when x"E"   => return x"79";
+            when others => return x"71"; -- F
+        end case;
+    end function;
+
+    -- Character ROM: ASCII to segments, characters that can not be shown are blank
+    function char_seg_f(char : std_ulogic_vector(7 downto 0)) return std_ulogic_vector is
+    begin
+        case char is
+            when x"2D"          => return x"40"; -- -
+            when x"5F"          => return x"08"; -- _
+            when x"3D"          => return x"48"; -- =
+            when x"30"          => return x"3F"; -- 0
+            when x"31"          => return x"06"; -- 1
+            when x"32"          => return x"5B"; -- 2
+            when x"33"          => return x"4F"; -- 3
+            when x"34"          => return x"66"; -- 4
+            when x"35"          => return x"6D"; -- 5
+            when x"36"          => return x"7D"; -- 6
+            when x"37"          => return x"07"; -- 7
+            when x"38"          => return x"7F"; -- 8
+            when x"39"          => return x"6F"; -- 9
+            when x"41" | x"61"  => return x"77"; -- A
+            when x"42" | x"62"  => return x"7C"; -- b
+            when x"43"          => return x"39"; -- C
+            when x"63"          => return x"58"; -- c
+            when x"44" | x"64"  => return x"5E"; -- d
+            when x"45" | x"65"  => return x"79"; -- E
+            when x"46" | x"66"  => return x"71"; -- F
+            when x"47" | x"67"  => return x"3D"; -- G
+            when x"48"          => return x"76"; -- H
+            when x"68"          => return x"74"; -- h
+            when x"49"          => return x"30"; -- I
+            when x"69"          => return x"10"; -- i
+            when x"4A" | x"6A"  => return x"1E"; -- J
+            when x"4C" | x"6C"  => return x"38"; -- L
+            when x"4E" | x"6E"  => return x"54"; -- n
+            when x"4F"          => return x"3F"; -- O
+            when x"6F"          => return x"5C"; -- o
+            when x"50" | x"70"  => return x"73"; -- P
+            when x"51" | x"71"  => return x"67"; -- q
+            when x"52" | x"72"  => return x"50"; -- r
+            when x"53" | x"73"  => return x"6D"; -- S
+            when x"54" | x"74"  => return x"78"; -- t
+            when x"55"          => return x"3E"; -- U
+            when x"75"          => return x"1C"; -- u
+            when x"59" | x"79"  => return x"6E"; -- y
+            when x"5A" | x"7A"  => return x"5B"; -- Z
+            when others         => return x"00"; -- blank
+        end case;
+    end function;
+
+    -- Character of the message buffer, 4 characters per register
+    function message_f(message : message_t; index : natural) return std_ulogic_vector is
+    begin
+        return message(index / 4)(8*(index mod 4)+7 downto 8*(index mod 4));
+    end function;
+
+    -- Double dabble step: add 3 to every BCD digit above 4
+    function add3_f(bcd : unsigned(39 downto 0)) return unsigned is
+        variable v_bcd : unsigned(39 downto 0);
+    begin
+        v_bcd := bcd;
+        for i in 0 to 9 loop
+            if (v_bcd(4*i+3 downto 4*i) > 4) then
+                v_bcd(4*i+3 downto 4*i) := v_bcd(4*i+3 downto 4*i) + 3;
+            end if;
+        end loop;
+        return v_bcd;
+    end function;
+
+    -- Legacy One Hot code of REG0/REG1 to segments
+    function onehot_seg_f(num : std_ulogic_vector(11 downto 0)) return std_ulogic_vector is
+    begin
+        case num is
+            when x"000" => return x"3F"; -- 0
+            when x"001" => return x"06"; -- 1
+            when x"002" => return x"5B"; -- 2
+            when x"004" => return x"4F"; -- 3
+            when x"008" => return x"66"; -- 4
+            when x"010" => return x"6D"; -- 5
+            when x"020" => return x"7D"; -- 6
+            when x"040" => return x"07"; -- 7
+            when x"080" => return x"7F"; -- 8
+            when x"100" => return x"6F"; -- 9
+            when x"200" => return x"39"; -- C
+            when x"400" => return x"38"; -- L
+            when others => return x"73"; -- P
+        end case;
+    end function;
+
     -----------------------------------------------------------    
     -- SIGNALS                                              ---
     -----------------------------------------------------------
@@ -69,15 +199,74 @@ architecture wb_7segmentDisplay_rtl of wb_7segmentDisplay is
     signal c_reg0, n_reg0   : std_ulogic_vector(31 downto 0);
     signal c_reg1, n_reg1   : std_ulogic_vector(31 downto 0);
     signal c_reg2, n_reg2   : std_ulogic_vector(31 downto 0);
-
-    signal c_ds             : std_ulogic;
-    signal n_ds             : std_ulogic;
+    signal c_reg3, n_reg3   : std_ulogic_vector(31 downto 0);
+    signal c_reg4, n_reg4   : std_ulogic_vector(31 downto 0);
+    signal c_reg7, n_reg7   : std_ulogic_vector(31 downto 0);
+    signal c_reg11, n_reg11 : std_ulogic_vector(31 downto 0);
+    signal c_reg12, n_reg12 : std_ulogic_vector(31 downto 0);
+    signal c_reg13, n_reg13 : std_ulogic_vector(31 downto 0);
+
+    -- message buffer --
+    signal c_message        : message_t;
+    signal n_message        : message_t;
+
+    -- effects --
+    signal c_eff_restart    : std_ulogic; -- REG2 was written
+    signal n_eff_restart    : std_ulogic;
+    signal c_tick_cnt       : integer range 0 to TICK_PRESCALER-1;
+    signal n_tick_cnt       : integer range 0 to TICK_PRESCALER-1;
+    signal c_blink_cnt      : unsigned(15 downto 0); -- Milliseconds of the blink phase
+    signal n_blink_cnt      : unsigned(15 downto 0);
+    signal c_blink_on       : std_ulogic;            -- Blink phase, '0' = digits off
+    signal n_blink_on       : std_ulogic;
+    signal c_scroll_cnt     : unsigned(15 downto 0); -- Milliseconds of the scroll step
+    signal n_scroll_cnt     : unsigned(15 downto 0);
+    signal c_scroll_pos     : integer range 0 to 15; -- First message character shown
+    signal n_scroll_pos     : integer range 0 to 15;
+    signal c_clear_cnt      : unsigned(15 downto 0); -- Milliseconds left before the auto-clear
+    signal n_clear_cnt      : unsigned(15 downto 0);
+    signal s_clear          : std_ulogic;            -- Timeout expired, back to dashes
+    signal s_msg_index      : integer range 0 to 15+DIGITS-1; -- Message character of the digit shown
+
+    -- binary to BCD --
+    signal c_bcd_start      : std_ulogic; -- REG7 was written
+    signal n_bcd_start      : std_ulogic;
+    signal c_bcd_busy       : std_ulogic;
+    signal n_bcd_busy       : std_ulogic;
+    signal c_bcd_count      : integer range 0 to 32; -- Bits shifted in
+    signal n_bcd_count      : integer range 0 to 32;
+    signal c_bcd_bin        : unsigned(31 downto 0); -- Magnitude, shifted out MSB first
+    signal n_bcd_bin        : unsigned(31 downto 0);
+    signal c_bcd            : unsigned(39 downto 0); -- 10 BCD digits
+    signal n_bcd            : unsigned(39 downto 0);
+    signal c_bcd_neg        : std_ulogic;
+    signal n_bcd_neg        : std_ulogic;
+    signal c_bcd_ovf        : std_ulogic;
+    signal n_bcd_ovf        : std_ulogic;
+    signal s_bcd_load       : std_ulogic; -- Conversion done, copy it to the frame buffer
+    signal s_bcd_frame      : frame_t;    -- Decimal number in segments
+    signal s_bcd_fit        : std_ulogic; -- Number and sign fit in DIGITS
+
+    -- frame buffer --
+    signal c_frame          : frame_t;
+    signal n_frame          : frame_t;
+
+    -- address decode --
+    signal s_word           : natural range 0 to WB_ADDR_SIZE/4-1;
+
+    -- bus response --
+    signal s_wb_dat         : std_ulogic_vector(31 downto 0);
+    signal s_wb_ack         : std_ulogic;
+    signal c_wb_dat         : std_ulogic_vector(31 downto 0);
+    signal c_wb_ack         : std_ulogic;
+
+    signal c_digit          : integer range 0 to DIGITS-1; -- Digit being shown
+    signal n_digit          : integer range 0 to DIGITS-1;
 
     signal c_counter        : unsigned (16 downto 0);
     signal n_counter        : unsigned (16 downto 0);
 
-    signal s_decod_num     : std_logic_vector(6 downto 0);
-    signal s_num           : std_logic_vector(11 downto 0);
+    signal s_seg            : std_ulogic_vector(7 downto 0); -- Segments of the digit being shown
 
     begin
 
@@ -86,17 +275,29 @@ architecture wb_7segmentDisplay_rtl of wb_7segmentDisplay is
     assert not (WB_ADDR_SIZE < 4) report "wb_regs config ERROR: Address space <WB_ADDR_SIZE> has to be at least 4 bytes." severity error;
     assert not (is_power_of_two_f(WB_ADDR_SIZE) = false) report "wb_regs config ERROR: Address space <WB_ADDR_SIZE> has to be a power of two." severity error;
     assert not ((WB_ADDR_BASE and addr_mask_c) /= all_zero_c) report "wb_regs config ERROR: Module base address <WB_ADDR_BASE> has to be aligned to its address space <WB_ADDR_SIZE>." severity error;
+    assert not (WB_ADDR_SIZE < 128) report "wb_regs config ERROR: Address space <WB_ADDR_SIZE> has to be at least 128 bytes." severity error;
+    assert not (TICK_PRESCALER < 1) report "wb_regs config ERROR: <TICK_PRESCALER> has to be at least 1." severity error;
+    assert not ((DIGITS < 2) or (DIGITS > 8)) report "wb_regs config ERROR: Frame buffer <DIGITS> has to be 2 to 8 digits." severity error;
+    assert not ((REFRESH_PRESCALER < 1) or (REFRESH_PRESCALER > 2**17-1)) report "wb_regs config ERROR: <REFRESH_PRESCALER> has to be 1 to 2^17-1." severity error;
 
     -- Device Access? -------------------------------------------------------------------------
     -- ----------------------------------------------------------------------------------------
     access_req <= '1' when ((wb_adr_i and (not addr_mask_c)) = (WB_ADDR_BASE and (not addr_mask_c))) else '0';
 
+    s_word     <= to_integer(unsigned(wb_adr_i(index_size_f(WB_ADDR_SIZE)-1 downto 2)));
+
 
     -------------------------------------------------------
     -- Concurrents Outputs                              ---
     -------------------------------------------------------
     
-    ds_o    <= c_ds;
+    ds_o    <= '1' when ((c_digit mod 2) = 1) else '0';
+
+    wb_7segmentDisplay_dig_comb: process(c_digit)
+    begin
+        dig_o <= (others => '0');
+        dig_o(c_digit) <= '1';
+    end process;
 
     -------------------------------------------------------
     -- Sinc processs                                    ---
@@ -108,14 +309,58 @@ architecture wb_7segmentDisplay_rtl of wb_7segmentDisplay is
             c_reg0      <= (others => '0');
             c_reg1      <= (others => '0');
             c_reg2      <= (others => '0');
-            c_ds        <= '0';
+            c_reg3      <= std_ulogic_vector(to_unsigned(REFRESH_PRESCALER, 32));
+            c_reg4      <= (others => '0');
+            c_reg7      <= (others => '0');
+            c_reg11     <= std_ulogic_vector(to_unsigned(400, 16)) & std_ulogic_vector(to_unsigned(500, 16));
+            c_reg12     <= std_ulogic_vector(to_unsigned(3000, 32));
+            c_reg13     <= std_ulogic_vector(to_unsigned(16, 32));
+            c_message   <= (others => x"20202020");
+            c_eff_restart <= '0';
+            c_tick_cnt  <= 0;
+            c_blink_cnt <= (others => '0');
+            c_blink_on  <= '1';
+            c_scroll_cnt <= (others => '0');
+            c_scroll_pos <= 0;
+            c_clear_cnt <= (others => '0');
+            c_bcd_start <= '0';
+            c_bcd_busy  <= '0';
+            c_bcd_count <= 0;
+            c_bcd_bin   <= (others => '0');
+            c_bcd       <= (others => '0');
+            c_bcd_neg   <= '0';
+            c_bcd_ovf   <= '0';
+            c_frame     <= (others => onehot_seg_f(x"000"));
+            c_digit     <= 0;
 
         elsif ( rising_edge(clk_i)) then
             c_counter   <= n_counter;
             c_reg0      <= n_reg0; -- Storage the tens
             c_reg1      <= n_reg1; -- Storage the hundreds
             c_reg2      <= n_reg2; -- Storage the controls signals
-            c_ds        <= n_ds;
+            c_reg3      <= n_reg3; -- Storage the refresh time
+            c_reg4      <= n_reg4; -- Storage the hexadecimal digits
+            c_reg7      <= n_reg7; -- Storage the binary number
+            c_reg11     <= n_reg11; -- Storage the blink and scroll periods
+            c_reg12     <= n_reg12; -- Storage the auto-clear timeout
+            c_reg13     <= n_reg13; -- Storage the message length
+            c_message   <= n_message;
+            c_eff_restart <= n_eff_restart;
+            c_tick_cnt  <= n_tick_cnt;
+            c_blink_cnt <= n_blink_cnt;
+            c_blink_on  <= n_blink_on;
+            c_scroll_cnt <= n_scroll_cnt;
+            c_scroll_pos <= n_scroll_pos;
+            c_clear_cnt <= n_clear_cnt;
+            c_bcd_start <= n_bcd_start;
+            c_bcd_busy  <= n_bcd_busy;
+            c_bcd_count <= n_bcd_count;
+            c_bcd_bin   <= n_bcd_bin;
+            c_bcd       <= n_bcd;
+            c_bcd_neg   <= n_bcd_neg;
+            c_bcd_ovf   <= n_bcd_ovf;
+            c_frame     <= n_frame;
+            c_digit     <= n_digit;
 
         end if;
     end process;
@@ -123,6 +368,30 @@ architecture wb_7segmentDisplay_rtl of wb_7segmentDisplay is
     -------------------------------------------------------
     -- WISHBONE PROCESS                                 ---
     -------------------------------------------------------
+    -- REG0 bits 11-0 : legacy One Hot code of digit 0 (tens)
+    -- REG1 bits 11-0 : legacy One Hot code of digit 1 (hundreds)
+    -- REG2 bits 1-0  : 0 = show dashes, 2 = show the message buffer,
+    --                  otherwise show the frame buffer
+    -- REG2 bit 4     : blink
+    -- REG2 bit 5     : scroll the message buffer
+    -- REG2 bit 6     : auto-clear, REG2 goes back to 0 after REG12 ms
+    -- REG3 bits 16-0 : clock cycles each digit is shown
+    -- REG4           : hexadecimal number, nibble 0 on the rightmost digit,
+    --                  the whole display is written at once
+    -- REG5 / REG6    : segments of digits 3-0 / 7-4, one byte per digit,
+    --                  bit 0 = a ... bit 6 = g, digit 0 is the leftmost one
+    -- REG7           : signed binary number, shown in decimal once converted
+    -- REG8 bit 0     : conversion in progress
+    -- REG8 bit 1     : the number is negative
+    -- REG8 bit 2     : overflow, the number does not fit in DIGITS
+    -- REG9 / REG10   : BCD magnitude, digits 7-0 / 9-8
+    -- REG11          : bits 15-0 blink half period, bits 31-16 scroll step, in ms
+    -- REG12 bits 15-0: auto-clear timeout in ms
+    -- REG13 bits 4-0 : message length (1..16), the scroll wraps at it
+    -- REG16-REG19    : message buffer in ASCII, byte i of REG(16+k) is
+    --                  character 4k+i, character 0 on the leftmost digit
+    -- Every write to REG0, REG1 or REG4-REG7 updates the frame buffer,
+    -- the last write wins. REG5/REG6 read back the frame buffer.
 
     wb_peripheral_teclado_tx_comb: process(
         wb_cyc_i, 
@@ -130,124 +399,403 @@ architecture wb_7segmentDisplay_rtl of wb_7segmentDisplay is
         wb_sel_i, 
         access_req, 
         wb_we_i,
+        wb_adr_i,
+        wb_dat_i,
+        s_word,
         c_reg0, -- Storage the tens
         c_reg1, -- Storage the hundreds
-        c_reg2  -- Storage the Control signal
+        c_reg2, -- Storage the Control signal
+        c_reg3,
+        c_reg4,
+        c_reg7,
+        c_frame,
+        c_bcd_start,
+        c_bcd_busy,
+        c_bcd_neg,
+        c_bcd_ovf,
+        c_bcd,
+        s_bcd_load,
+        s_bcd_frame,
+        c_reg11,
+        c_reg12,
+        c_reg13,
+        c_message,
+        s_clear
         )
     begin
         -- Keep values
         n_reg0 <= c_reg0;
         n_reg1 <= c_reg1;
         n_reg2 <= c_reg2;
+        n_reg3 <= c_reg3;
+        n_reg4 <= c_reg4;
+        n_reg7 <= c_reg7;
+        n_reg11 <= c_reg11;
+        n_reg12 <= c_reg12;
+        n_reg13 <= c_reg13;
+        n_message <= c_message;
+        n_frame <= c_frame;
+        n_bcd_start <= '0';
+        n_eff_restart <= '0';
+
+        -- Timeout expired: dashes and no effects, a bus write in the same cycle wins
+        if (s_clear = '1') then
+            n_reg2 <= (others => '0');
+        end if;
 
-        wb_dat_o <= c_reg0;
+        -- Finished conversion, a bus write in the same cycle wins
+        if (s_bcd_load = '1') then
+            n_frame <= s_bcd_frame;
+        end if;
+
+        -- Not addressed: drive zeros so the slaves can share an OR bus
+        s_wb_dat <= (others => '0');
         -- Default ack is inactive
-        wb_ack_o <= '0';
+        s_wb_ack <= '0';
 
         -- Is the peripheral selected?
         if (wb_cyc_i = '1') and (wb_stb_i = '1') and (access_req = '1') then
 
             -- Write access, only full-word accesses
             if (wb_we_i = '1' and wb_sel_i = "1111") then
-                case to_integer(unsigned(wb_adr_i(index_size_f(WB_ADDR_SIZE)-1 downto 2))) is
+                case s_word is
                     when 0 =>
                         n_reg0 <= wb_dat_i; 
+                        n_frame(0) <= onehot_seg_f(wb_dat_i(11 downto 0));
                     when 1 =>
                         n_reg1 <= wb_dat_i;
+                        n_frame(1) <= onehot_seg_f(wb_dat_i(11 downto 0));
                     when 2 =>
                         n_reg2 <= wb_dat_i;
+                        n_eff_restart <= '1';
+                    when 3 =>
+                        n_reg3 <= x"000" & "000" & wb_dat_i(16 downto 0);
+                    when 4 =>
+                        n_reg4 <= wb_dat_i;
+                        for i in 0 to DIGITS-1 loop
+                            n_frame(DIGITS-1-i) <= hex_seg_f(wb_dat_i(4*i+3 downto 4*i));
+                        end loop;
+                    when 5 | 6 =>
+                        for i in 0 to 3 loop
+                            if (4*(s_word-5)+i < DIGITS) then
+                                n_frame(4*(s_word-5)+i) <= wb_dat_i(8*i+7 downto 8*i);
+                            end if;
+                        end loop;
+                    when 7 =>
+                        n_reg7      <= wb_dat_i;
+                        n_bcd_start <= '1';
+                    when 11 =>
+                        n_reg11 <= wb_dat_i;
+                    when 12 =>
+                        n_reg12 <= x"0000" & wb_dat_i(15 downto 0);
+                    when 13 =>
+                        n_reg13 <= (others => '0');
+                        n_reg13(4 downto 0) <= wb_dat_i(4 downto 0);
+                        if (unsigned(wb_dat_i(4 downto 0)) = 0) or (unsigned(wb_dat_i(4 downto 0)) > 16) then
+                            n_reg13(4 downto 0) <= "10000";
+                        end if;
+                    when 16 to 19 =>
+                        n_message(s_word - 16) <= wb_dat_i;
                     when others =>
                         null;
                 end case;
-                wb_ack_o <= '1';
+                s_wb_ack <= '1';
             else
             -- Read access
-                case to_integer(unsigned(wb_adr_i(index_size_f(WB_ADDR_SIZE)-1 downto 2))) is
+                case s_word is
                     when 0 =>
-                        wb_dat_o <= c_reg0;
+                        s_wb_dat <= c_reg0;
                     when 1 =>
-                        wb_dat_o <= c_reg1;
+                        s_wb_dat <= c_reg1;
                     when 2 =>
-                        wb_dat_o <= c_reg2;
+                        s_wb_dat <= c_reg2;
+                    when 3 =>
+                        s_wb_dat <= c_reg3;
+                    when 4 =>
+                        s_wb_dat <= c_reg4;
+                    when 5 | 6 =>
+                        for i in 0 to 3 loop
+                            if (4*(s_word-5)+i < DIGITS) then
+                                s_wb_dat(8*i+7 downto 8*i) <= c_frame(4*(s_word-5)+i);
+                            end if;
+                        end loop;
+                    when 7 =>
+                        s_wb_dat <= c_reg7;
+                    when 8 =>
+                        s_wb_dat(0) <= c_bcd_start or c_bcd_busy;
+                        s_wb_dat(1) <= c_bcd_neg;
+                        s_wb_dat(2) <= c_bcd_ovf;
+                    when 9 =>
+                        s_wb_dat <= std_ulogic_vector(c_bcd(31 downto 0));
+                    when 10 =>
+                        s_wb_dat(7 downto 0) <= std_ulogic_vector(c_bcd(39 downto 32));
+                    when 11 =>
+                        s_wb_dat <= c_reg11;
+                    when 12 =>
+                        s_wb_dat <= c_reg12;
+                    when 13 =>
+                        s_wb_dat <= c_reg13;
+                    when 16 to 19 =>
+                        s_wb_dat <= c_message(s_word - 16);
                     when others =>
                         null;
                 end case;
-                wb_ack_o <= '1';
+                s_wb_ack <= '1';
+            end if;
+
+        end if;
+
+    end process;
+
+    -------------------------------------------------------
+    -- Binary to BCD                                    ---
+    -------------------------------------------------------
+    -- Double dabble (shift and add 3), one bit per cycle: the result
+    -- is in the frame buffer 35 cycles after the REG7 write. Leading
+    -- zeros are blank and a negative number gets a dash on its left.
+    -- A number that does not fit shows segments a, d and g on every digit.
+
+    wb_7segmentDisplay_bcd_comb: process(
+        c_reg7,
+        c_bcd_start,
+        c_bcd_busy,
+        c_bcd_count,
+        c_bcd_bin,
+        c_bcd,
+        c_bcd_neg,
+        c_bcd_ovf,
+        s_bcd_fit
+        )
+        variable v_bcd : unsigned(39 downto 0);
+    begin
+        n_bcd_busy  <= c_bcd_busy;
+        n_bcd_count <= c_bcd_count;
+        n_bcd_bin   <= c_bcd_bin;
+        n_bcd       <= c_bcd;
+        n_bcd_neg   <= c_bcd_neg;
+        n_bcd_ovf   <= c_bcd_ovf;
+        s_bcd_load  <= '0';
+
+        if (c_bcd_start = '1') then -- A new number restarts the conversion
+            n_bcd_busy  <= '1';
+            n_bcd_count <= 0;
+            n_bcd       <= (others => '0');
+            n_bcd_neg   <= c_reg7(31);
+            if (c_reg7(31) = '1') then
+                n_bcd_bin <= unsigned(not c_reg7) + 1;
+            else
+                n_bcd_bin <= unsigned(c_reg7);
+            end if;
+        elsif (c_bcd_busy = '1') then
+            if (c_bcd_count /= 32) then
+                v_bcd       := add3_f(c_bcd);
+                n_bcd       <= v_bcd(38 downto 0) & c_bcd_bin(31);
+                n_bcd_bin   <= c_bcd_bin(30 downto 0) & '0';
+                n_bcd_count <= c_bcd_count + 1;
+            else
+                n_bcd_busy  <= '0';
+                n_bcd_ovf   <= not s_bcd_fit;
+                s_bcd_load  <= '1';
+            end if;
+        end if;
+    end process;
+
+    wb_7segmentDisplay_bcd_frame: process(c_bcd, c_bcd_neg)
+        variable v_msd : integer range 0 to 9; -- Most significant digit that is not zero
+    begin
+        v_msd := 0;
+        for i in 0 to 9 loop
+            if (c_bcd(4*i+3 downto 4*i) /= 0) then
+                v_msd := i;
             end if;
+        end loop;
 
+        s_bcd_fit <= '1';
+        if (v_msd > DIGITS-1) or ((c_bcd_neg = '1') and (v_msd = DIGITS-1)) then
+            s_bcd_fit <= '0';
         end if;
 
+        -- Digit i of the number goes to the frame buffer digit DIGITS-1-i
+        for i in 0 to DIGITS-1 loop
+            s_bcd_frame(DIGITS-1-i) <= seg_blank_c;
+            if (i <= v_msd) then
+                s_bcd_frame(DIGITS-1-i) <= hex_seg_f(std_ulogic_vector(c_bcd(4*i+3 downto 4*i)));
+            elsif (i = v_msd+1) and (c_bcd_neg = '1') then
+                s_bcd_frame(DIGITS-1-i) <= seg_dash_c;
+            end if;
+            if (v_msd > DIGITS-1) or ((c_bcd_neg = '1') and (v_msd = DIGITS-1)) then
+                s_bcd_frame(DIGITS-1-i) <= seg_ovf_c;
+            end if;
+        end loop;
     end process;
 
+    -------------------------------------------------------
+    -- Bus response                                     ---
+    -------------------------------------------------------
+    -- Pipelined: the request is taken in the cycle stb is seen and
+    -- ack/data come out of registers one cycle later. The slave never
+    -- stalls, so a new request can be issued every cycle.
+
+    wb_pipelined_resp: if WB_PIPELINED generate
+        wb_7segmentDisplay_resp_sinc: process(clk_i, reset_i)
+        begin
+            if (reset_i = '1') then
+                c_wb_dat <= (others => '0');
+                c_wb_ack <= '0';
+            elsif (rising_edge(clk_i)) then
+                c_wb_dat <= s_wb_dat;
+                c_wb_ack <= s_wb_ack;
+            end if;
+        end process;
+
+        wb_dat_o <= c_wb_dat;
+        wb_ack_o <= c_wb_ack;
+    end generate;
+
+    wb_classic_resp: if not WB_PIPELINED generate
+        c_wb_dat <= (others => '0');
+        c_wb_ack <= '0';
+
+        wb_dat_o <= s_wb_dat;
+        wb_ack_o <= s_wb_ack;
+    end generate;
+
+    wb_stall_o <= '0';
+
     -------------------------------------------------------
     -- 7 segment display                                ---
     -------------------------------------------------------
+    -- The digits are shown round robin, each one for REG3
+    -- clock cycles: DIGITS*REG3 cycles per refresh.
 
-    wb_7segmentDisplay_comb: process(c_counter)
+    wb_7segmentDisplay_comb: process(c_counter, c_digit, c_reg3)
     begin
         -- Counter
         n_counter   <= c_counter + 1;
 
         -- Digit Select
-        n_ds        <= c_ds;
-        if (c_counter = x"10000") then
-            n_ds        <= not(c_ds); -- 183 Hz 
-            n_counter   <= (others => '0'); 
-            -- 12 MHz / 0x10000 = 12MHz / 65.536 = 183 Hz
+        n_digit     <= c_digit;
+        if (c_counter >= unsigned(c_reg3(16 downto 0))) then
+            n_counter   <= (others => '0');
+            if (c_digit = DIGITS-1) then
+                n_digit <= 0;
+            else
+                n_digit <= c_digit + 1;
+            end if;
         end if;
 
-        -- Display
-        aa_o        <= '0';
-        ab_o        <= '0';
-        ac_o        <= '0';
-        ad_o        <= '0';
-        ae_o        <= '0';
-        af_o        <= '0';
-        ag_o        <= '0';
+    end process;
+
+    -------------------------------------------------------
+    -- Effects                                          ---
+    -------------------------------------------------------
+    -- Blink, scroll and auto-clear run on a 1 ms tick (TICK_PRESCALER
+    -- cycles). Writing REG2 restarts them: digits on, message from its
+    -- first character and the full timeout.
+
+    wb_7segmentDisplay_eff_comb: process(
+        c_reg2,
+        c_reg11,
+        c_reg12,
+        c_reg13,
+        c_eff_restart,
+        c_tick_cnt,
+        c_blink_cnt,
+        c_blink_on,
+        c_scroll_cnt,
+        c_scroll_pos,
+        c_clear_cnt
+        )
+    begin
+        n_tick_cnt   <= c_tick_cnt;
+        n_blink_cnt  <= c_blink_cnt;
+        n_blink_on   <= c_blink_on;
+        n_scroll_cnt <= c_scroll_cnt;
+        n_scroll_pos <= c_scroll_pos;
+        n_clear_cnt  <= c_clear_cnt;
+        s_clear      <= '0';
+
+        if (c_eff_restart = '1') then
+            n_tick_cnt   <= 0;
+            n_blink_cnt  <= (others => '0');
+            n_blink_on   <= '1';
+            n_scroll_cnt <= (others => '0');
+            n_scroll_pos <= 0;
+            n_clear_cnt  <= unsigned(c_reg12(15 downto 0));
+        elsif (c_tick_cnt /= TICK_PRESCALER-1) then
+            n_tick_cnt <= c_tick_cnt + 1;
+        else
+            n_tick_cnt <= 0;
+
+            -- Blink
+            n_blink_cnt <= c_blink_cnt + 1;
+            if (c_blink_cnt + 1 >= unsigned(c_reg11(15 downto 0))) then
+                n_blink_cnt <= (others => '0');
+                n_blink_on  <= not(c_blink_on);
+            end if;
 
+            -- Scroll
+            if (c_reg2(5) = '1') then
+                n_scroll_cnt <= c_scroll_cnt + 1;
+                if (c_scroll_cnt + 1 >= unsigned(c_reg11(31 downto 16))) then
+                    n_scroll_cnt <= (others => '0');
+                    if (c_scroll_pos + 1 >= to_integer(unsigned(c_reg13(4 downto 0)))) then
+                        n_scroll_pos <= 0;
+                    else
+                        n_scroll_pos <= c_scroll_pos + 1;
+                    end if;
+                end if;
+            end if;
 
-        case(to_integer(unsigned(c_reg2(1 downto 0)))) is
-            when 0 => -- Represent:  --
-                ag_o    <= '1';
+            -- Auto-clear
+            if (c_reg2(6) = '1') then
+                if (c_clear_cnt <= 1) then
+                    s_clear <= '1';
+                else
+                    n_clear_cnt <= c_clear_cnt - 1;
+                end if;
+            end if;
+        end if;
+    end process;
 
-            when others => -- Represent the number
+    -------------------------------------------------------
+    -- Segments                                         ---
+    -------------------------------------------------------
+    -- Pin order of the PMOD: aa = d, ab = e, ac = f, ad = a, ae = b,
+    -- af = c, ag = g.
 
-                aa_o        <= s_decod_num(6);
-                ab_o        <= s_decod_num(5);
-                ac_o        <= s_decod_num(4);
-                ad_o        <= s_decod_num(3);
-                ae_o        <= s_decod_num(2);
-                af_o        <= s_decod_num(1);
-                ag_o        <= s_decod_num(0);
+    s_msg_index <= c_scroll_pos + c_digit;
 
+    wb_7segmentDisplay_seg_comb: process(c_reg2, c_reg13, c_frame, c_digit, c_message, c_blink_on, s_msg_index, ext_en_i, ext_text_i)
+    begin
+        case c_reg2(1 downto 0) is
+            when "00" => -- Represent:  --
+                s_seg <= seg_dash_c;
+            when "10" => -- Represent the message, blank past its end
+                s_seg <= seg_blank_c;
+                if (s_msg_index < to_integer(unsigned(c_reg13(4 downto 0)))) then
+                    s_seg <= char_seg_f(message_f(c_message, s_msg_index));
+                end if;
+            when others => -- Represent the frame buffer
+                s_seg <= c_frame(c_digit);
         end case;
 
-    end process;
- 
-    -------------------------------------------------------
-    -- Decode number                                    ---
-    -------------------------------------------------------
+        if (c_reg2(4) = '1') and (c_blink_on = '0') then
+            s_seg <= seg_blank_c;
+        end if;
 
-    WITH (c_ds) SELECT
-    s_num           <= std_logic_vector(c_reg0(11 downto 0)) when '0',
-                       std_logic_vector(c_reg1(11 downto 0)) when others;
-
-
-    WITH (s_num) SELECT
-    s_decod_num    <=   "1111110" when x"000", -- 0
-                        "0000110" when x"001", -- 1
-                        "1101101" when x"002", -- 2
-                        "1001111" when x"004", -- 3
-                        "0010111" when x"008", -- 4
-                        "1011011" when x"010", -- 5
-                        "1111011" when x"020", -- 6
-                        "0001110" when x"040", -- 7
-                        "1111111" when x"080", -- 8
-                        "0011111" when x"100", -- 9
-                        "1111000" when x"200", -- C
-                        "1110000" when x"400", -- L
-                        "0111101" when others; -- P
+        if (ext_en_i = '1') then
+            s_seg <= char_seg_f(ext_text_i(8*c_digit+7 downto 8*c_digit));
+        end if;
+    end process;
 
+    aa_o        <= s_seg(3);
+    ab_o        <= s_seg(4);
+    ac_o        <= s_seg(5);
+    ad_o        <= s_seg(0);
+    ae_o        <= s_seg(1);
+    af_o        <= s_seg(2);
+    ag_o        <= s_seg(6);
 
 
   -------------------------------------------------------
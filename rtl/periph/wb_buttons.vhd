@@ -0,0 +1,347 @@
+
+library ieee;
+use ieee.std_logic_1164.all;
+use ieee.numeric_std.all;
+
+library neorv32;
+use neorv32.neorv32_package.all;
+
+
+entity wb_buttons is
+  generic(
+    WB_ADDR_BASE        : std_ulogic_vector(31 downto 0) := x"90000300";
+    WB_ADDR_SIZE        : integer := 32;
+    NUM_BUTTONS         : integer := 3;      -- Button inputs (1..8)
+    TICK_PRESCALER      : integer := 12000;  -- Clock cycles of the debounce time base, 12000 = 1 ms at 12 MHz
+    DEBOUNCE_MS         : integer := 20;     -- Default lockout after an edge, in ticks
+    WB_PIPELINED        : boolean := false   -- Wishbone B4 pipelined slave, registered ack/data
+  );
+      -- Top-level ports. Board pins are defined in setups/osflow/constraints/iCEBreaker.pcf
+  port (
+    -- 12MHz Clock input
+    clk_i                : in std_ulogic;
+    reset_i              : in std_ulogic;
+
+    -- Wishbone Comunication
+    wb_tag_i             : in   std_ulogic_vector(02 downto 0);
+    wb_adr_i             : in   std_ulogic_vector(31 downto 0);
+    wb_dat_i             : in   std_ulogic_vector(31 downto 0);
+    wb_dat_o             : out  std_ulogic_vector(31 downto 0);
+    wb_we_i              : in   std_ulogic;
+    wb_sel_i             : in   std_ulogic_vector(03 downto 0);
+    wb_stb_i             : in   std_ulogic;
+    wb_cyc_i             : in   std_ulogic;
+    wb_lock_i            : in   std_ulogic;
+    wb_ack_o             : out  std_ulogic;
+    wb_err_o             : out  std_ulogic;
+    wb_stall_o           : out  std_ulogic;
+
+    -- Button interrupt, level: high while an enabled edge is pending
+    irq_o                : out  std_ulogic;
+
+    -- Buttons, active high, asynchronous
+    buttons_i            : in   std_ulogic_vector(NUM_BUTTONS-1 downto 0);
+
+    -- Code of the last pressed button (1..NUM_BUTTONS, 0 = none), as the old GPIO latch
+    last_o               : out  std_ulogic_vector(3 downto 0)
+
+    );
+end entity;
+
+architecture wb_buttons_rtl of wb_buttons is
+
+    -- internal constants --
+    constant addr_mask_c : std_ulogic_vector(31 downto 0) := std_ulogic_vector(to_unsigned(WB_ADDR_SIZE-1, 32));
+    constant all_zero_c  : std_ulogic_vector(31 downto 0) := (others => '0');
+
+    type lock_t is array (0 to NUM_BUTTONS-1) of unsigned(7 downto 0);
+    type count_t is array (0 to NUM_BUTTONS-1) of unsigned(7 downto 0);
+
+    -----------------------------------------------------------
+    -- SIGNALS                                              ---
+    -----------------------------------------------------------
+
+    -- address match --
+    signal access_req       : std_ulogic;
+    signal s_word           : natural range 0 to WB_ADDR_SIZE/4-1;
+
+    -- registers --
+    signal c_rise, n_rise   : std_ulogic_vector(NUM_BUTTONS-1 downto 0); -- REG1: press pending
+    signal c_fall, n_fall   : std_ulogic_vector(NUM_BUTTONS-1 downto 0); -- REG2: release pending
+    signal c_reg3, n_reg3   : std_ulogic_vector(31 downto 0);            -- REG3: interrupt enables
+    signal c_count          : count_t;                                   -- REG4: presses of each button
+    signal n_count          : count_t;
+    signal c_last, n_last   : std_ulogic_vector(3 downto 0);             -- REG5: last pressed button
+    signal c_reg6, n_reg6   : std_ulogic_vector(31 downto 0);            -- REG6: lockout time
+
+    -- bus response --
+    signal s_wb_dat         : std_ulogic_vector(31 downto 0);
+    signal s_wb_ack         : std_ulogic;
+    signal c_wb_dat         : std_ulogic_vector(31 downto 0);
+    signal c_wb_ack         : std_ulogic;
+
+    -- input conditioning --
+    signal c_meta           : std_ulogic_vector(NUM_BUTTONS-1 downto 0); -- Synchronizer, first stage
+    signal c_sync           : std_ulogic_vector(NUM_BUTTONS-1 downto 0); -- Synchronizer, second stage
+    signal c_stable         : std_ulogic_vector(NUM_BUTTONS-1 downto 0); -- Debounced level
+    signal n_stable         : std_ulogic_vector(NUM_BUTTONS-1 downto 0);
+    signal c_lock           : lock_t;                                    -- Ticks left before the next edge
+    signal n_lock           : lock_t;
+    signal c_tick_cnt       : integer range 0 to TICK_PRESCALER-1;
+    signal n_tick_cnt       : integer range 0 to TICK_PRESCALER-1;
+    signal s_press          : std_ulogic_vector(NUM_BUTTONS-1 downto 0); -- Pressed in this cycle
+    signal s_release        : std_ulogic_vector(NUM_BUTTONS-1 downto 0); -- Released in this cycle
+
+    signal c_irq            : std_ulogic;
+    signal n_irq            : std_ulogic;
+
+    begin
+
+    -- Sanity Checks --------------------------------------------------------------------------
+    -- ----------------------------------------------------------------------------------------
+    assert not (WB_ADDR_SIZE < 32) report "wb_regs config ERROR: Address space <WB_ADDR_SIZE> has to be at least 32 bytes." severity error;
+    assert not (is_power_of_two_f(WB_ADDR_SIZE) = false) report "wb_regs config ERROR: Address space <WB_ADDR_SIZE> has to be a power of two." severity error;
+    assert not ((WB_ADDR_BASE and addr_mask_c) /= all_zero_c) report "wb_regs config ERROR: Module base address <WB_ADDR_BASE> has to be aligned to its address space <WB_ADDR_SIZE>." severity error;
+    assert not ((NUM_BUTTONS < 1) or (NUM_BUTTONS > 8)) report "wb_regs config ERROR: <NUM_BUTTONS> has to be 1 to 8." severity error;
+    assert not (TICK_PRESCALER < 1) report "wb_regs config ERROR: <TICK_PRESCALER> has to be at least 1." severity error;
+    assert not ((DEBOUNCE_MS < 0) or (DEBOUNCE_MS > 255)) report "wb_regs config ERROR: <DEBOUNCE_MS> has to be 0 to 255." severity error;
+
+    -- Device Access? -------------------------------------------------------------------------
+    -- ----------------------------------------------------------------------------------------
+    access_req <= '1' when ((wb_adr_i and (not addr_mask_c)) = (WB_ADDR_BASE and (not addr_mask_c))) else '0';
+
+    s_word     <= to_integer(unsigned(wb_adr_i(index_size_f(WB_ADDR_SIZE)-1 downto 2)));
+
+
+    -------------------------------------------------------
+    -- Concurrents Outputs                              ---
+    -------------------------------------------------------
+
+    irq_o   <= c_irq;
+    last_o  <= c_last;
+
+    -------------------------------------------------------
+    -- Sinc processs                                    ---
+    -------------------------------------------------------
+    wb_buttons_sinc: process(clk_i, reset_i)
+    begin
+        if (reset_i = '1') then
+            c_rise      <= (others => '0');
+            c_fall      <= (others => '0');
+            c_reg3      <= (others => '0');
+            c_count     <= (others => (others => '0'));
+            c_last      <= (others => '0');
+            c_reg6      <= std_ulogic_vector(to_unsigned(DEBOUNCE_MS, 32));
+            c_meta      <= (others => '0');
+            c_sync      <= (others => '0');
+            c_stable    <= (others => '0');
+            c_lock      <= (others => (others => '0'));
+            c_tick_cnt  <= 0;
+            c_irq       <= '0';
+
+        elsif ( rising_edge(clk_i)) then
+            c_rise      <= n_rise;
+            c_fall      <= n_fall;
+            c_reg3      <= n_reg3; -- Storage the interrupt enables
+            c_count     <= n_count;
+            c_last      <= n_last;
+            c_reg6      <= n_reg6; -- Storage the lockout time
+            c_meta      <= buttons_i;
+            c_sync      <= c_meta;
+            c_stable    <= n_stable;
+            c_lock      <= n_lock;
+            c_tick_cnt  <= n_tick_cnt;
+            c_irq       <= n_irq;
+
+        end if;
+    end process;
+
+    -------------------------------------------------------
+    -- Debounce                                         ---
+    -------------------------------------------------------
+    -- The first edge after a quiet period is taken at once (two
+    -- synchronizer cycles), then the button is ignored for REG6 ticks
+    -- so its bounces do not count as new presses.
+
+    wb_buttons_debounce_comb: process(c_sync, c_stable, c_lock, c_tick_cnt, c_reg6)
+    begin
+        n_stable    <= c_stable;
+        n_lock      <= c_lock;
+        n_tick_cnt  <= c_tick_cnt;
+
+        if (c_tick_cnt /= TICK_PRESCALER-1) then
+            n_tick_cnt <= c_tick_cnt + 1;
+        else
+            n_tick_cnt <= 0;
+        end if;
+
+        for i in 0 to NUM_BUTTONS-1 loop
+            if (c_lock(i) = 0) then
+                if (c_sync(i) /= c_stable(i)) then
+                    n_stable(i) <= c_sync(i);
+                    n_lock(i)   <= unsigned(c_reg6(7 downto 0));
+                end if;
+            elsif (c_tick_cnt = TICK_PRESCALER-1) then
+                n_lock(i) <= c_lock(i) - 1;
+            end if;
+        end loop;
+    end process;
+
+    s_press   <= n_stable and not(c_stable);
+    s_release <= c_stable and not(n_stable);
+
+    -------------------------------------------------------
+    -- WISHBONE PROCESS                                 ---
+    -------------------------------------------------------
+    -- REG0 bits N-1..0  : debounced level of the buttons
+    -- REG1 bits N-1..0  : press pending, write '1' to clear
+    -- REG2 bits N-1..0  : release pending, write '1' to clear
+    -- REG3 bits N-1..0  : press interrupt enables
+    -- REG3 bits 8+N-1..8: release interrupt enables
+    -- REG4              : press counters of buttons 0-3, 8 bits each (button i
+    --                     on bits 8i+7..8i), any write clears all counters
+    -- REG5 bits 3-0     : last pressed button (1..N, 0 = none), any write clears it
+    -- REG6 bits 7-0     : lockout after an edge, in ms
+    -- REG7              : press counters of buttons 4-7, read only
+
+    wb_buttons_tx_comb: process(
+        wb_cyc_i,
+        wb_stb_i,
+        wb_sel_i,
+        access_req,
+        wb_we_i,
+        wb_dat_i,
+        s_word,
+        s_press,
+        s_release,
+        c_stable,
+        c_rise,
+        c_fall,
+        c_reg3,
+        c_count,
+        c_last,
+        c_reg6
+        )
+    begin
+        -- Keep values
+        n_rise  <= c_rise or s_press;
+        n_fall  <= c_fall or s_release;
+        n_reg3  <= c_reg3;
+        n_count <= c_count;
+        n_last  <= c_last;
+        n_reg6  <= c_reg6;
+
+        for i in 0 to NUM_BUTTONS-1 loop
+            if (s_press(i) = '1') then
+                n_count(i) <= c_count(i) + 1;
+                n_last     <= std_ulogic_vector(to_unsigned(i+1, 4));
+            end if;
+        end loop;
+
+        -- Not addressed: drive zeros so the slaves can share an OR bus
+        s_wb_dat <= (others => '0');
+        -- Default ack is inactive
+        s_wb_ack <= '0';
+
+        -- Is the peripheral selected?
+        if (wb_cyc_i = '1') and (wb_stb_i = '1') and (access_req = '1') then
+
+            -- Write access, only full-word accesses
+            if (wb_we_i = '1' and wb_sel_i = "1111") then
+                case s_word is
+                    when 1 => -- An edge in this same cycle stays pending
+                        n_rise <= (c_rise and not(wb_dat_i(NUM_BUTTONS-1 downto 0))) or s_press;
+                    when 2 =>
+                        n_fall <= (c_fall and not(wb_dat_i(NUM_BUTTONS-1 downto 0))) or s_release;
+                    when 3 =>
+                        n_reg3 <= (others => '0');
+                        n_reg3(NUM_BUTTONS-1 downto 0)     <= wb_dat_i(NUM_BUTTONS-1 downto 0);
+                        n_reg3(8+NUM_BUTTONS-1 downto 8)   <= wb_dat_i(8+NUM_BUTTONS-1 downto 8);
+                    when 4 =>
+                        n_count <= (others => (others => '0'));
+                    when 5 =>
+                        n_last  <= (others => '0');
+                    when 6 =>
+                        n_reg6  <= x"000000" & wb_dat_i(7 downto 0);
+                    when others =>
+                        null;
+                end case;
+                s_wb_ack <= '1';
+            else
+            -- Read access
+                case s_word is
+                    when 0 =>
+                        s_wb_dat(NUM_BUTTONS-1 downto 0) <= c_stable;
+                    when 1 =>
+                        s_wb_dat(NUM_BUTTONS-1 downto 0) <= c_rise;
+                    when 2 =>
+                        s_wb_dat(NUM_BUTTONS-1 downto 0) <= c_fall;
+                    when 3 =>
+                        s_wb_dat <= c_reg3;
+                    when 4 =>
+                        for i in 0 to NUM_BUTTONS-1 loop
+                            if (i < 4) then
+                                s_wb_dat(8*i+7 downto 8*i) <= std_ulogic_vector(c_count(i));
+                            end if;
+                        end loop;
+                    when 7 =>
+                        for i in 4 to NUM_BUTTONS-1 loop
+                            s_wb_dat(8*(i-4)+7 downto 8*(i-4)) <= std_ulogic_vector(c_count(i));
+                        end loop;
+                    when 5 =>
+                        s_wb_dat(3 downto 0) <= c_last;
+                    when 6 =>
+                        s_wb_dat <= c_reg6;
+                    when others =>
+                        null;
+                end case;
+                s_wb_ack <= '1';
+            end if;
+
+        end if;
+
+    end process;
+
+    n_irq <= '1' when ((c_rise and c_reg3(NUM_BUTTONS-1 downto 0)) /= all_zero_c(NUM_BUTTONS-1 downto 0)) or
+                      ((c_fall and c_reg3(8+NUM_BUTTONS-1 downto 8)) /= all_zero_c(NUM_BUTTONS-1 downto 0)) else '0';
+
+    -------------------------------------------------------
+    -- Bus response                                     ---
+    -------------------------------------------------------
+    -- Pipelined: the request is taken in the cycle stb is seen and
+    -- ack/data come out of registers one cycle later. The slave never
+    -- stalls, so a new request can be issued every cycle.
+
+    wb_pipelined_resp: if WB_PIPELINED generate
+        wb_buttons_resp_sinc: process(clk_i, reset_i)
+        begin
+            if (reset_i = '1') then
+                c_wb_dat <= (others => '0');
+                c_wb_ack <= '0';
+            elsif (rising_edge(clk_i)) then
+                c_wb_dat <= s_wb_dat;
+                c_wb_ack <= s_wb_ack;
+            end if;
+        end process;
+
+        wb_dat_o <= c_wb_dat;
+        wb_ack_o <= c_wb_ack;
+    end generate;
+
+    wb_classic_resp: if not WB_PIPELINED generate
+        c_wb_dat <= (others => '0');
+        c_wb_ack <= '0';
+
+        wb_dat_o <= s_wb_dat;
+        wb_ack_o <= s_wb_ack;
+    end generate;
+
+    wb_stall_o <= '0';
+
+
+  -------------------------------------------------------
+  -- Errors can not happen in this module             ---
+  -------------------------------------------------------
+  wb_err_o <= '0';
+
+end architecture;
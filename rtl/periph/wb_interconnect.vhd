@@ -0,0 +1,162 @@
+library ieee;
+use ieee.std_logic_1164.all;
+use ieee.numeric_std.all;
+
+library neorv32;
+use neorv32.neorv32_package.all;
+
+
+entity wb_interconnect is
+  generic(
+    NUM_SLAVES          : integer := 2;
+    -- Slave i uses bits 32*i+31 downto 32*i, the first one on the right
+    SLAVE_BASE          : std_ulogic_vector := x"90000100" & x"90000000"; -- Base address of each slave
+    SLAVE_SIZE          : std_ulogic_vector := x"00000010" & x"00000080"; -- Address space of each slave in bytes
+    REGISTERED_RESP     : boolean := false  -- Register ack/err/data to cut the path back to the CPU
+  );
+  port (
+    -- 12MHz Clock input
+    clk_i                : in std_ulogic;
+    reset_i              : in std_ulogic;
+
+    -- Wishbone master (CPU)
+    wb_adr_i             : in   std_ulogic_vector(31 downto 0);
+    wb_stb_i             : in   std_ulogic;
+    wb_cyc_i             : in   std_ulogic;
+    wb_dat_o             : out  std_ulogic_vector(31 downto 0);
+    wb_ack_o             : out  std_ulogic;
+    wb_err_o             : out  std_ulogic;
+
+    -- Wishbone slaves, address/write data/we/sel are shared
+    wb_stb_o             : out  std_ulogic_vector(NUM_SLAVES-1 downto 0);
+    wb_cyc_o             : out  std_ulogic_vector(NUM_SLAVES-1 downto 0);
+    wb_dat_i             : in   std_ulogic_vector(NUM_SLAVES*32-1 downto 0);
+    wb_ack_i             : in   std_ulogic_vector(NUM_SLAVES-1 downto 0);
+    wb_err_i             : in   std_ulogic_vector(NUM_SLAVES-1 downto 0)
+
+    );
+end entity;
+
+architecture wb_interconnect_rtl of wb_interconnect is
+
+    -- internal constants --
+    constant base_c      : std_ulogic_vector(NUM_SLAVES*32-1 downto 0) := SLAVE_BASE;
+    constant size_c      : std_ulogic_vector(NUM_SLAVES*32-1 downto 0) := SLAVE_SIZE;
+    constant all_zero_c  : std_ulogic_vector(31 downto 0) := (others => '0');
+    constant no_slave_c  : std_ulogic_vector(NUM_SLAVES-1 downto 0) := (others => '0');
+
+    function base_f(i : natural) return std_ulogic_vector is
+    begin
+        return base_c(32*i+31 downto 32*i);
+    end function;
+
+    function mask_f(i : natural) return std_ulogic_vector is
+    begin
+        return std_ulogic_vector(unsigned(size_c(32*i+31 downto 32*i)) - 1);
+    end function;
+
+    -----------------------------------------------------------
+    -- SIGNALS                                              ---
+    -----------------------------------------------------------
+
+    signal s_sel            : std_ulogic_vector(NUM_SLAVES-1 downto 0); -- Address decode, one hot
+    signal s_stb            : std_ulogic;
+
+    signal s_dat            : std_ulogic_vector(31 downto 0);
+    signal s_ack            : std_ulogic;
+    signal s_err            : std_ulogic;
+
+    signal c_dat            : std_ulogic_vector(31 downto 0);
+    signal c_ack            : std_ulogic;
+    signal c_err            : std_ulogic;
+
+    begin
+
+    -- Sanity Checks --------------------------------------------------------------------------
+    -- ----------------------------------------------------------------------------------------
+    assert not (SLAVE_BASE'length /= NUM_SLAVES*32) report "wb_interconnect config ERROR: <SLAVE_BASE> needs one 32-bit address per slave." severity error;
+    assert not (SLAVE_SIZE'length /= NUM_SLAVES*32) report "wb_interconnect config ERROR: <SLAVE_SIZE> needs one 32-bit size per slave." severity error;
+
+    sanity_check: for i in 0 to NUM_SLAVES-1 generate
+        assert not (to_integer(unsigned(size_c(32*i+31 downto 32*i))) < 4) report "wb_interconnect config ERROR: Slave address space has to be at least 4 bytes." severity error;
+        assert not (is_power_of_two_f(to_integer(unsigned(size_c(32*i+31 downto 32*i)))) = false) report "wb_interconnect config ERROR: Slave address space has to be a power of two." severity error;
+        assert not ((base_f(i) and mask_f(i)) /= all_zero_c) report "wb_interconnect config ERROR: Slave base address has to be aligned to its address space." severity error;
+    end generate;
+
+    -------------------------------------------------------
+    -- Address decode                                   ---
+    -------------------------------------------------------
+
+    address_decode: for i in 0 to NUM_SLAVES-1 generate
+        s_sel(i) <= '1' when ((wb_adr_i and (not mask_f(i))) = (base_f(i) and (not mask_f(i)))) else '0';
+    end generate;
+
+    -- With a registered response the CPU keeps stb high one more cycle,
+    -- mask it so the slave does not see the access twice.
+    s_stb    <= wb_stb_i and not(c_ack or c_err) when REGISTERED_RESP else wb_stb_i;
+
+    wb_stb_o <= s_sel when (s_stb = '1') else (others => '0');
+    wb_cyc_o <= s_sel when (wb_cyc_i = '1') else (others => '0');
+
+    -------------------------------------------------------
+    -- Response mux                                     ---
+    -------------------------------------------------------
+
+    wb_interconnect_mux_comb: process(s_sel, s_stb, wb_cyc_i, wb_dat_i, wb_ack_i, wb_err_i)
+        variable v_dat : std_ulogic_vector(31 downto 0);
+        variable v_ack : std_ulogic;
+        variable v_err : std_ulogic;
+    begin
+        v_dat := (others => '0');
+        v_ack := '0';
+        v_err := '0';
+
+        -- Only the addressed slave reaches the CPU
+        for i in 0 to NUM_SLAVES-1 loop
+            if (s_sel(i) = '1') then
+                v_dat := v_dat or wb_dat_i(32*i+31 downto 32*i);
+                v_ack := v_ack or wb_ack_i(i);
+                v_err := v_err or wb_err_i(i);
+            end if;
+        end loop;
+
+        -- Nobody answers an unmapped address: terminate it with an error
+        if (wb_cyc_i = '1') and (s_stb = '1') and (s_sel = no_slave_c) then
+            v_err := '1';
+        end if;
+
+        s_dat <= v_dat;
+        s_ack <= v_ack;
+        s_err <= v_err;
+    end process;
+
+    registered_response: if REGISTERED_RESP generate
+        wb_interconnect_sinc: process(clk_i, reset_i)
+        begin
+            if (reset_i = '1') then
+                c_dat <= (others => '0');
+                c_ack <= '0';
+                c_err <= '0';
+            elsif (rising_edge(clk_i)) then
+                c_dat <= s_dat;
+                c_ack <= s_ack;
+                c_err <= s_err;
+            end if;
+        end process;
+
+        wb_dat_o <= c_dat;
+        wb_ack_o <= c_ack;
+        wb_err_o <= c_err;
+    end generate;
+
+    combinational_response: if not REGISTERED_RESP generate
+        c_dat <= (others => '0');
+        c_ack <= '0';
+        c_err <= '0';
+
+        wb_dat_o <= s_dat;
+        wb_ack_o <= s_ack;
+        wb_err_o <= s_err;
+    end generate;
+
+end architecture;
@@ -0,0 +1,387 @@
+
+library ieee;
+use ieee.std_logic_1164.all;
+use ieee.numeric_std.all;
+
+library neorv32;
+use neorv32.neorv32_package.all;
+
+
+entity wb_led_sequencer is
+  generic(
+    WB_ADDR_BASE        : std_ulogic_vector(31 downto 0) := x"90000200";
+    WB_ADDR_SIZE        : integer := 512;
+    STEPS               : integer := 64;     -- Steps of the pattern RAM, has to be a power of two
+    LED_WIDTH           : integer := 8;      -- Driven outputs (1..16)
+    TICK_PRESCALER      : integer := 12000;  -- Clock cycles of the step time base, 12000 = 1 ms at 12 MHz
+    WB_PIPELINED        : boolean := false   -- Wishbone B4 pipelined slave, registered ack/data
+  );
+      -- Top-level ports. Board pins are defined in setups/osflow/constraints/iCEBreaker.pcf
+  port (
+    -- 12MHz Clock input
+    clk_i                : in std_ulogic;
+    reset_i              : in std_ulogic;
+
+    -- Wishbone Comunication
+    wb_tag_i             : in   std_ulogic_vector(02 downto 0);
+    wb_adr_i             : in   std_ulogic_vector(31 downto 0);
+    wb_dat_i             : in   std_ulogic_vector(31 downto 0);
+    wb_dat_o             : out  std_ulogic_vector(31 downto 0);
+    wb_we_i              : in   std_ulogic;
+    wb_sel_i             : in   std_ulogic_vector(03 downto 0);
+    wb_stb_i             : in   std_ulogic;
+    wb_cyc_i             : in   std_ulogic;
+    wb_lock_i            : in   std_ulogic;
+    wb_ack_o             : out  std_ulogic;
+    wb_err_o             : out  std_ulogic;
+    wb_stall_o           : out  std_ulogic;
+
+    -- End of sequence interrupt, level: high while pending and enabled
+    irq_o                : out  std_ulogic;
+
+    -- LEDs
+    led_o                : out  std_ulogic_vector(LED_WIDTH-1 downto 0)
+
+    );
+end entity;
+
+architecture wb_led_sequencer_rtl of wb_led_sequencer is
+
+    -- internal constants --
+    constant addr_mask_c : std_ulogic_vector(31 downto 0) := std_ulogic_vector(to_unsigned(WB_ADDR_SIZE-1, 32));
+    constant all_zero_c  : std_ulogic_vector(31 downto 0) := (others => '0');
+    constant step_abits_c : natural := index_size_f(STEPS);
+
+    type pattern_mem_t is array (0 to STEPS-1) of std_ulogic_vector(31 downto 0);
+
+    -----------------------------------------------------------
+    -- SIGNALS                                              ---
+    -----------------------------------------------------------
+
+    -- address match --
+    signal access_req       : std_ulogic;
+    signal s_word           : natural range 0 to WB_ADDR_SIZE/4-1;
+
+    -- registers --
+    signal c_reg0, n_reg0   : std_ulogic_vector(31 downto 0);
+    signal c_reg1, n_reg1   : std_ulogic_vector(31 downto 0);
+    signal c_reg2, n_reg2   : std_ulogic_vector(31 downto 0);
+
+    -- bus response --
+    signal s_wb_dat         : std_ulogic_vector(31 downto 0);
+    signal s_wb_ack         : std_ulogic;
+    signal c_wb_dat         : std_ulogic_vector(31 downto 0);
+    signal c_wb_ack         : std_ulogic;
+
+    -- pattern RAM --
+    signal pattern_mem      : pattern_mem_t;
+    signal s_mem_we         : std_ulogic; -- Store a step
+    signal c_mem_rd         : std_ulogic_vector(31 downto 0); -- Step being played, one cycle after c_step
+
+    -- sequencer --
+    signal c_start          : std_ulogic; -- REG0 run bit was written with '1'
+    signal n_start          : std_ulogic;
+    signal c_stop           : std_ulogic; -- REG0 run bit was written with '0'
+    signal n_stop           : std_ulogic;
+    signal c_run            : std_ulogic;
+    signal n_run            : std_ulogic;
+    signal c_step           : unsigned(step_abits_c-1 downto 0);
+    signal n_step           : unsigned(step_abits_c-1 downto 0);
+    signal c_loops          : unsigned(15 downto 0); -- Passes left, 0 = forever
+    signal n_loops          : unsigned(15 downto 0);
+    signal c_ms             : unsigned(15 downto 0); -- Milliseconds in the current step
+    signal n_ms             : unsigned(15 downto 0);
+    signal c_tick_cnt       : integer range 0 to TICK_PRESCALER-1;
+    signal n_tick_cnt       : integer range 0 to TICK_PRESCALER-1;
+    signal s_end            : std_ulogic; -- Last pass of the last step finished
+
+    signal c_led            : std_ulogic_vector(LED_WIDTH-1 downto 0);
+    signal n_led            : std_ulogic_vector(LED_WIDTH-1 downto 0);
+
+    begin
+
+    -- Sanity Checks --------------------------------------------------------------------------
+    -- ----------------------------------------------------------------------------------------
+    assert not (WB_ADDR_SIZE < 4) report "wb_regs config ERROR: Address space <WB_ADDR_SIZE> has to be at least 4 bytes." severity error;
+    assert not (is_power_of_two_f(WB_ADDR_SIZE) = false) report "wb_regs config ERROR: Address space <WB_ADDR_SIZE> has to be a power of two." severity error;
+    assert not ((WB_ADDR_BASE and addr_mask_c) /= all_zero_c) report "wb_regs config ERROR: Module base address <WB_ADDR_BASE> has to be aligned to its address space <WB_ADDR_SIZE>." severity error;
+    assert not ((STEPS < 8) or (STEPS > 256)) report "wb_regs config ERROR: Pattern RAM <STEPS> has to be 8 to 256 steps." severity error;
+    assert not (is_power_of_two_f(STEPS) = false) report "wb_regs config ERROR: Pattern RAM <STEPS> has to be a power of two." severity error;
+    assert not (WB_ADDR_SIZE/4 < 2*STEPS) report "wb_regs config ERROR: Address space <WB_ADDR_SIZE> too small for the pattern RAM, it needs 8*<STEPS> bytes." severity error;
+    assert not ((LED_WIDTH < 1) or (LED_WIDTH > 16)) report "wb_regs config ERROR: <LED_WIDTH> has to be 1 to 16." severity error;
+    assert not (TICK_PRESCALER < 1) report "wb_regs config ERROR: <TICK_PRESCALER> has to be at least 1." severity error;
+
+    -- Device Access? -------------------------------------------------------------------------
+    -- ----------------------------------------------------------------------------------------
+    access_req <= '1' when ((wb_adr_i and (not addr_mask_c)) = (WB_ADDR_BASE and (not addr_mask_c))) else '0';
+
+    s_word     <= to_integer(unsigned(wb_adr_i(index_size_f(WB_ADDR_SIZE)-1 downto 2)));
+
+
+    -------------------------------------------------------
+    -- Concurrents Outputs                              ---
+    -------------------------------------------------------
+
+    led_o   <= c_led;
+    irq_o   <= c_reg0(8) and c_reg0(1);
+
+    -------------------------------------------------------
+    -- Sinc processs                                    ---
+    -------------------------------------------------------
+    wb_led_sequencer_sinc: process(clk_i, reset_i)
+    begin
+        if (reset_i = '1') then
+            c_reg0      <= (others => '0');
+            c_reg1      <= (others => '0');
+            c_reg2      <= (others => '0');
+            c_start     <= '0';
+            c_stop      <= '0';
+            c_run       <= '0';
+            c_step      <= (others => '0');
+            c_loops     <= (others => '0');
+            c_ms        <= (others => '0');
+            c_tick_cnt  <= 0;
+            c_led       <= (others => '0');
+
+        elsif ( rising_edge(clk_i)) then
+            c_reg0      <= n_reg0; -- Storage the control signals
+            c_reg1      <= n_reg1; -- Storage the sequence limits
+            c_reg2      <= n_reg2; -- Storage the idle value
+            c_start     <= n_start;
+            c_stop      <= n_stop;
+            c_run       <= n_run;
+            c_step      <= n_step;
+            c_loops     <= n_loops;
+            c_ms        <= n_ms;
+            c_tick_cnt  <= n_tick_cnt;
+            c_led       <= n_led;
+
+        end if;
+    end process;
+
+    -------------------------------------------------------
+    -- Pattern RAM                                      ---
+    -------------------------------------------------------
+    -- Step word: bits 31-16 duration in ms (0 = 1 ms), bits 15-0 LED
+    -- value. Write-only from the bus and read synchronously by the
+    -- sequencer, so it maps to block RAM.
+
+    wb_led_sequencer_mem: process(clk_i)
+    begin
+        if (rising_edge(clk_i)) then
+            if (s_mem_we = '1') then
+                pattern_mem(s_word - STEPS) <= wb_dat_i;
+            end if;
+            c_mem_rd <= pattern_mem(to_integer(c_step));
+        end if;
+    end process;
+
+    -------------------------------------------------------
+    -- WISHBONE PROCESS                                 ---
+    -------------------------------------------------------
+    -- REG0 bit 0     : write '1' to play the sequence, '0' to stop it;
+    --                  reads '1' while playing
+    -- REG0 bit 1     : end of sequence interrupt enable
+    -- REG0 bit 2     : keep the last step value on the LEDs at the end
+    -- REG0 bit 8     : end of sequence pending, write '1' to clear
+    -- REG1 bits 7-0  : first step, bits 15-8 : last step
+    -- REG1 bits 31-16: passes from the first to the last step (0 = forever)
+    -- REG2 bits 15-0 : LED value while stopped
+    -- REG3 bits 7-0  : step being played, bits 31-16 : passes left
+    -- REG(STEPS+k)   : step k of the pattern RAM (write-only)
+
+    wb_led_sequencer_tx_comb: process(
+        wb_cyc_i,
+        wb_stb_i,
+        wb_sel_i,
+        access_req,
+        wb_we_i,
+        wb_dat_i,
+        s_word,
+        s_end,
+        c_reg0,
+        c_reg1,
+        c_reg2,
+        c_run,
+        c_step,
+        c_loops,
+        c_mem_rd
+        )
+    begin
+        -- Keep values
+        n_reg0 <= c_reg0;
+        n_reg1 <= c_reg1;
+        n_reg2 <= c_reg2;
+        n_start <= '0';
+        n_stop  <= '0';
+        s_mem_we <= '0';
+
+        -- End of sequence: pending, and the last value stays if asked
+        if (s_end = '1') then
+            n_reg0(8) <= '1';
+            if (c_reg0(2) = '1') then
+                n_reg2 <= (others => '0');
+                n_reg2(LED_WIDTH-1 downto 0) <= c_mem_rd(LED_WIDTH-1 downto 0);
+            end if;
+        end if;
+
+        -- Not addressed: drive zeros so the slaves can share an OR bus
+        s_wb_dat <= (others => '0');
+        -- Default ack is inactive
+        s_wb_ack <= '0';
+
+        -- Is the peripheral selected?
+        if (wb_cyc_i = '1') and (wb_stb_i = '1') and (access_req = '1') then
+
+            -- Write access, only full-word accesses
+            if (wb_we_i = '1' and wb_sel_i = "1111") then
+                case s_word is
+                    when 0 =>
+                        n_reg0(2 downto 0) <= wb_dat_i(2 downto 0);
+                        if (wb_dat_i(8) = '1') then -- Clear the pending end
+                            n_reg0(8) <= '0';
+                        end if;
+                        n_start <= wb_dat_i(0);
+                        n_stop  <= not(wb_dat_i(0));
+                    when 1 =>
+                        n_reg1 <= wb_dat_i;
+                    when 2 =>
+                        n_reg2 <= (others => '0');
+                        n_reg2(LED_WIDTH-1 downto 0) <= wb_dat_i(LED_WIDTH-1 downto 0);
+                    when others =>
+                        if (s_word >= STEPS) and (s_word < 2*STEPS) then
+                            s_mem_we <= '1';
+                        end if;
+                end case;
+                s_wb_ack <= '1';
+            else
+            -- Read access
+                case s_word is
+                    when 0 =>
+                        s_wb_dat <= c_reg0;
+                        s_wb_dat(0) <= c_run;
+                    when 1 =>
+                        s_wb_dat <= c_reg1;
+                    when 2 =>
+                        s_wb_dat <= c_reg2;
+                    when 3 =>
+                        s_wb_dat(step_abits_c-1 downto 0) <= std_ulogic_vector(c_step);
+                        s_wb_dat(31 downto 16) <= std_ulogic_vector(c_loops);
+                    when others =>
+                        null;
+                end case;
+                s_wb_ack <= '1';
+            end if;
+
+        end if;
+
+    end process;
+
+    -------------------------------------------------------
+    -- Bus response                                     ---
+    -------------------------------------------------------
+    -- Pipelined: the request is taken in the cycle stb is seen and
+    -- ack/data come out of registers one cycle later. The slave never
+    -- stalls, so a new request can be issued every cycle.
+
+    wb_pipelined_resp: if WB_PIPELINED generate
+        wb_led_sequencer_resp_sinc: process(clk_i, reset_i)
+        begin
+            if (reset_i = '1') then
+                c_wb_dat <= (others => '0');
+                c_wb_ack <= '0';
+            elsif (rising_edge(clk_i)) then
+                c_wb_dat <= s_wb_dat;
+                c_wb_ack <= s_wb_ack;
+            end if;
+        end process;
+
+        wb_dat_o <= c_wb_dat;
+        wb_ack_o <= c_wb_ack;
+    end generate;
+
+    wb_classic_resp: if not WB_PIPELINED generate
+        c_wb_dat <= (others => '0');
+        c_wb_ack <= '0';
+
+        wb_dat_o <= s_wb_dat;
+        wb_ack_o <= s_wb_ack;
+    end generate;
+
+    wb_stall_o <= '0';
+
+    -------------------------------------------------------
+    -- Sequencer                                        ---
+    -------------------------------------------------------
+    -- Plays the steps from the first to the last one, each for its
+    -- duration, REG1 passes. The RAM answers one cycle after a step
+    -- change, well inside the 1 ms time base.
+
+    wb_led_sequencer_comb: process(
+        c_reg1,
+        c_reg2,
+        c_start,
+        c_stop,
+        c_run,
+        c_step,
+        c_loops,
+        c_ms,
+        c_tick_cnt,
+        c_mem_rd
+        )
+    begin
+        n_run       <= c_run;
+        n_step      <= c_step;
+        n_loops     <= c_loops;
+        n_ms        <= c_ms;
+        n_tick_cnt  <= c_tick_cnt;
+        s_end       <= '0';
+
+        if (c_start = '1') then
+            n_run       <= '1';
+            n_step      <= unsigned(c_reg1(step_abits_c-1 downto 0));
+            n_loops     <= unsigned(c_reg1(31 downto 16));
+            n_ms        <= (others => '0');
+            n_tick_cnt  <= 0;
+        elsif (c_stop = '1') then
+            n_run       <= '0';
+        elsif (c_run = '1') then
+            if (c_tick_cnt /= TICK_PRESCALER-1) then
+                n_tick_cnt <= c_tick_cnt + 1;
+            else
+                n_tick_cnt <= 0;
+                n_ms       <= c_ms + 1;
+
+                -- Step done
+                if (c_ms + 1 >= unsigned(c_mem_rd(31 downto 16))) then
+                    n_ms <= (others => '0');
+                    if (c_step /= unsigned(c_reg1(8+step_abits_c-1 downto 8))) then
+                        n_step <= c_step + 1;
+                    elsif (c_loops = 1) then -- Last pass
+                        n_run  <= '0';
+                        s_end  <= '1';
+                    else
+                        n_step <= unsigned(c_reg1(step_abits_c-1 downto 0));
+                        if (c_loops /= 0) then
+                            n_loops <= c_loops - 1;
+                        end if;
+                    end if;
+                end if;
+            end if;
+        end if;
+
+        -- LEDs
+        if (c_run = '1') then
+            n_led <= c_mem_rd(LED_WIDTH-1 downto 0);
+        else
+            n_led <= c_reg2(LED_WIDTH-1 downto 0);
+        end if;
+    end process;
+
+
+  -------------------------------------------------------
+  -- Errors can not happen in this module             ---
+  -------------------------------------------------------
+  wb_err_o <= '0';
+
+end architecture;
@@ -10,7 +10,19 @@ use neorv32.neorv32_package.all;
 entity wb_peripheral_teclado is
   generic(
     WB_ADDR_BASE        : std_ulogic_vector(31 downto 0) := x"90000000";
-    WB_ADDR_SIZE        : integer := 32
+    WB_ADDR_SIZE        : integer := 128;
+    ROWS                : integer := 4;    -- Rows of the key matrix (2..8)
+    COLS                : integer := 4;    -- Columns of the key matrix (2..8)
+    FIFO_DEPTH          : integer := 8;    -- Key events stored, has to be a power of two
+    SCAN_PRESCALER      : integer := 3000; -- Clock cycles each column is driven, 3000 = 1 ms per 4 column frame at 12 MHz
+    DEBOUNCE_WIDTH      : integer := 4;    -- Width of the debounce settle time
+    DEBOUNCE_FRAMES     : integer := 5;    -- Settle time after reset, in scan frames
+    CAM_SLOTS           : integer := 16;   -- Stored user codes (2..64), has to be a power of two
+    CHORD_NUM           : integer := 4;    -- Key combinations reported as a single event (1..8)
+    CHORD_WINDOW        : integer := 50;   -- Scan frames the first keys of a chord wait for the rest of it
+    LOCK_EN             : boolean := false;-- Implement the lock engine (REG48-REG52), needs WB_ADDR_SIZE >= 256
+    LOCK_TICK_PRESCALER : integer := 12000;-- Clock cycles of the lock window timer, 12000 = 1 ms at 12 MHz
+    WB_PIPELINED        : boolean := false -- Wishbone B4 pipelined slave, registered ack/data
   );
       -- Top-level ports. Board pins are defined in setups/osflow/constraints/iCEBreaker.pcf
   port (
@@ -30,19 +42,23 @@ entity wb_peripheral_teclado is
     wb_lock_i            : in std_ulogic;
     wb_ack_o             : out  std_ulogic;
     wb_err_o             : out  std_ulogic;
+    wb_stall_o           : out  std_ulogic;
 
-    -- Rows
+    -- Interrupt request, one clock pulse per enabled event
+    irq_o                : out std_ulogic;
+
+    -- Rows, active low
     en_i                 : in std_ulogic;
-    Row_1_i              : in std_ulogic;
-    Row_2_i              : in std_ulogic;
-    Row_3_i              : in std_ulogic;
-    Row_4_i              : in std_ulogic;
+    Row_i                : in std_ulogic_vector(ROWS-1 downto 0);
     
-    -- Cols
-    Col_1_o              : out std_logic;
-    Col_2_o              : out std_logic;
-    Col_3_o              : out std_logic;
-    Col_4_o              : out std_logic
+    -- Cols, the driven one is low
+    Col_o                : out std_logic_vector(COLS-1 downto 0);
+
+    -- Lock engine, Lock_active_o is high while it runs (REG48 bit 0)
+    Lock_active_o        : out std_ulogic;
+    Lock_led_o           : out std_ulogic_vector(4 downto 0);  -- Bits 3-0 bytes A/B/C/D accepted, bit 4 locked out
+    Lock_open_o          : out std_ulogic;                     -- Door open window
+    Lock_text_o          : out std_ulogic_vector(15 downto 0)  -- Display characters in ASCII, digit 0 on bits 7-0
 
     );
 end entity;
@@ -59,6 +75,58 @@ architecture wb_peripheral_rtl of wb_peripheral_teclado is
     -- internal constants --
     constant addr_mask_c : std_ulogic_vector(31 downto 0) := std_ulogic_vector(to_unsigned(WB_ADDR_SIZE-1, 32));
     constant all_zero_c  : std_ulogic_vector(31 downto 0) := (others => '0');
+    constant fifo_abits_c : natural := index_size_f(FIFO_DEPTH);
+
+    constant cam_abits_c  : natural := index_size_f(CAM_SLOTS);
+
+    constant keys_c          : natural := ROWS*COLS;
+    constant key_abits_c     : natural := index_size_f(keys_c);
+    constant keymap_words_c  : natural := maximum(4, (keys_c+3)/4); -- 4 key codes per register
+    constant no_key_c        : std_ulogic_vector(keys_c-1 downto 0) := (others => '0');
+    constant chord_window_c  : natural := CHORD_WINDOW*COLS*SCAN_PRESCALER; -- In clock cycles
+
+    type fifo_mem_t is array (0 to FIFO_DEPTH-1) of std_ulogic_vector(30 downto 0);
+    type chord_t is array (0 to CHORD_NUM-1) of std_ulogic_vector(31 downto 0);
+    type cam_mem_t is array (0 to CAM_SLOTS-1) of std_ulogic_vector(31 downto 0);
+    type keymap_t is array (0 to keymap_words_c-1) of std_ulogic_vector(31 downto 0);
+
+    -- Key codes of the firmware for the 4x4 keypad: digits 0-9, 65-68 = A-D, 69 = E, 70 = F
+    function keymap_default_f return keymap_t is
+        variable v_keymap : keymap_t;
+    begin
+        v_keymap := (others => (others => '0'));
+        v_keymap(0 to 3) := (x"01040700", x"41424344", x"03060945", x"02050846");
+        return v_keymap;
+    end function;
+
+    -- Highest pressed key of a One Hot vector, 0 if none
+    function key_index_f(key : std_ulogic_vector(keys_c-1 downto 0)) return natural is
+        variable v_index : natural range 0 to keys_c-1;
+    begin
+        v_index := 0;
+        for i in 0 to keys_c-1 loop
+            if (key(i) = '1') then
+                v_index := i;
+            end if;
+        end loop;
+        return v_index;
+    end function;
+
+    -- Code of a key index, 4 codes per keymap register
+    function keymap_f(keymap : keymap_t; index : natural) return std_ulogic_vector is
+    begin
+        return keymap(index / 4)(8*(index mod 4)+7 downto 8*(index mod 4));
+    end function;
+
+    -- Bits written by a bus access, wb_sel_i(i) enables byte i
+    function sel_mask_f(sel : std_ulogic_vector(3 downto 0)) return std_ulogic_vector is
+        variable v_mask : std_ulogic_vector(31 downto 0);
+    begin
+        for i in 0 to 3 loop
+            v_mask(8*i+7 downto 8*i) := (others => sel(i));
+        end loop;
+        return v_mask;
+    end function;
 
     -----------------------------------------------------------    
     -- SIGNALS                                              ---
@@ -73,24 +141,98 @@ architecture wb_peripheral_rtl of wb_peripheral_teclado is
     signal c_reg2, n_reg2   : std_ulogic_vector(31 downto 0);
     signal c_reg3, n_reg3   : std_ulogic_vector(31 downto 0);
     signal c_reg4, n_reg4   : std_ulogic_vector(31 downto 0);
+    signal c_reg5, n_reg5   : std_ulogic_vector(31 downto 0);
+    signal c_reg8, n_reg8   : std_ulogic_vector(31 downto 0);
+    signal c_reg9, n_reg9   : std_ulogic_vector(31 downto 0);
+    signal c_reg31, n_reg31 : std_ulogic_vector(31 downto 0);
+    signal c_reg48, n_reg48 : std_ulogic_vector(31 downto 0);
+    signal c_reg50, n_reg50 : std_ulogic_vector(31 downto 0);
+    signal c_reg51, n_reg51 : std_ulogic_vector(31 downto 0);
+    signal c_reg52, n_reg52 : std_ulogic_vector(31 downto 0);
 
+    -- bus response --
+    signal s_wb_dat         : std_ulogic_vector(31 downto 0);
+    signal s_wb_ack         : std_ulogic;
+    signal c_wb_dat         : std_ulogic_vector(31 downto 0);
+    signal c_wb_ack         : std_ulogic;
 
-    signal c_counter        : unsigned (1 downto 0);
-    signal n_counter        : unsigned (1 downto 0);
 
-    signal c_key            : std_ulogic_vector(15 downto 0); -- Update each cycle
-    signal n_key            : std_ulogic_vector(15 downto 0);
+    signal s_key            : std_logic_vector(keys_c-1 downto 0);
+    signal s_key_valid      : std_logic;
+    signal s_key_index      : std_logic_vector(key_abits_c-1 downto 0);
+    signal s_ghost          : std_logic; -- The scanner discarded an ambiguous frame
+    signal c_keymap         : keymap_t;
+    signal n_keymap         : keymap_t;
+    signal s_key_value      : std_ulogic_vector(keys_c-1 downto 0); -- Debounced keys from the scanner
+    signal s_key_wide       : std_ulogic_vector(63 downto 0);       -- Debounced keys, REG0 and REG26
 
-    signal c_col            : std_ulogic_vector(3 downto 0);
-    signal n_col            : std_ulogic_vector(3 downto 0);
+    signal c_Password_result  : std_logic_vector(3 downto 0);
+    signal n_Password_result  : std_logic_vector(3 downto 0);
 
-    signal s_row            : std_ulogic_vector(3 downto 0);
+    -- compare status --
+    signal s_cmp_start      : std_ulogic; -- A compare command is written to REG2
+    signal c_cmp_start      : std_ulogic; -- The commanded bytes are compared in this cycle
+    signal c_cmp_done       : std_ulogic; -- Sticky, cleared by the next compare command
+    signal n_cmp_done       : std_ulogic;
+    signal c_cmp_match      : std_ulogic; -- Every commanded byte matched
+    signal n_cmp_match      : std_ulogic;
 
-    signal c_key_value      : std_ulogic_vector(15 downto 0); -- Update each four cycles
-    signal n_key_value      : std_ulogic_vector(15 downto 0);
+    -- key press detection --
+    signal c_key_prev       : std_ulogic_vector(keys_c-1 downto 0); -- Key value of the previous cycle
+    signal s_key_press      : std_ulogic_vector(keys_c-1 downto 0); -- Keys pressed in this cycle
+    signal c_press_pend     : std_ulogic_vector(keys_c-1 downto 0); -- Presses not stored yet
+    signal n_press_pend     : std_ulogic_vector(keys_c-1 downto 0);
+    signal s_evt_valid      : std_ulogic;                           -- A key or chord event is stored in this cycle
+    signal s_evt_key        : std_ulogic_vector(keys_c-1 downto 0); -- Key of the event in One Hot
+    signal s_evt_index      : natural range 0 to keys_c-1;          -- Key of the event
+    signal s_press_low      : std_ulogic_vector(15 downto 0);       -- Key of the event, first 16 keys
 
-    signal c_Password_result  : std_logic_vector(3 downto 0);
-    signal n_Password_result  : std_logic_vector(3 downto 0);
+    signal c_irq            : std_ulogic;
+    signal n_irq            : std_ulogic;
+
+    -- key event fifo --
+    signal fifo_mem         : fifo_mem_t;
+    signal c_fifo_wp        : unsigned(fifo_abits_c downto 0); -- Write pointer, MSB flags the wrap
+    signal n_fifo_wp        : unsigned(fifo_abits_c downto 0);
+    signal c_fifo_rp        : unsigned(fifo_abits_c downto 0); -- Read pointer, MSB flags the wrap
+    signal n_fifo_rp        : unsigned(fifo_abits_c downto 0);
+    signal c_fifo_ovf       : std_ulogic;                      -- A key was lost because the fifo was full
+    signal n_fifo_ovf       : std_ulogic;
+    signal s_fifo_we        : std_ulogic;
+    signal s_fifo_level     : unsigned(fifo_abits_c downto 0);
+    signal s_fifo_empty     : std_ulogic;
+    signal s_fifo_full      : std_ulogic;
+    signal s_fifo_head      : std_ulogic_vector(30 downto 0); -- Oldest stored key
+    signal s_fifo_din       : std_ulogic_vector(30 downto 0); -- Key event to store
+
+    -- chord table --
+    signal c_chord          : chord_t;
+    signal n_chord          : chord_t;
+    signal s_chord_hit      : std_ulogic; -- The pressed keys complete a chord
+    signal s_chord_part     : std_ulogic; -- The pressed keys are part of a chord
+    signal c_chord_wait     : natural range 0 to chord_window_c; -- Cycles the presses have been held
+    signal n_chord_wait     : natural range 0 to chord_window_c;
+    signal s_chord_index    : natural range 0 to CHORD_NUM-1;
+    signal s_word           : natural range 0 to WB_ADDR_SIZE/4-1; -- Accessed register
+
+    -- user code bank --
+    signal cam_mem          : cam_mem_t;
+    signal cam_en           : std_ulogic_vector(CAM_SLOTS-1 downto 0) := (others => '0'); -- Slot holds a valid code
+    signal s_cam_slot       : natural range 0 to CAM_SLOTS-1; -- Slot selected by REG9
+    signal s_cam_we         : std_ulogic; -- Store a code in the selected slot
+    signal s_cam_en_we      : std_ulogic; -- Change the enable of the selected slot
+    signal c_cam_hit        : std_ulogic; -- REG1 matches an enabled slot
+    signal n_cam_hit        : std_ulogic;
+    signal c_cam_index      : unsigned(cam_abits_c-1 downto 0); -- Lowest matching slot
+    signal n_cam_index      : unsigned(cam_abits_c-1 downto 0);
+
+    -- lock engine --
+    signal s_lock_state     : std_logic_vector(1 downto 0);
+    signal s_lock_stages    : std_logic_vector(3 downto 0);
+    signal s_lock_digits    : std_logic_vector(7 downto 0);
+    signal s_lock_open_evt  : std_ulogic; -- The door opens in this cycle
+    signal s_lock_fail_evt  : std_ulogic; -- A lockout starts in this cycle
+    signal s_key_press_any  : std_ulogic; -- A key or chord was pressed in this cycle
 
     begin
 
@@ -99,107 +241,375 @@ architecture wb_peripheral_rtl of wb_peripheral_teclado is
     assert not (WB_ADDR_SIZE < 4) report "wb_regs config ERROR: Address space <WB_ADDR_SIZE> has to be at least 4 bytes." severity error;
     assert not (is_power_of_two_f(WB_ADDR_SIZE) = false) report "wb_regs config ERROR: Address space <WB_ADDR_SIZE> has to be a power of two." severity error;
     assert not ((WB_ADDR_BASE and addr_mask_c) /= all_zero_c) report "wb_regs config ERROR: Module base address <WB_ADDR_BASE> has to be aligned to its address space <WB_ADDR_SIZE>." severity error;
+    assert not (FIFO_DEPTH < 2) report "wb_regs config ERROR: Key fifo <FIFO_DEPTH> has to be at least 2 entries." severity error;
+    assert not (is_power_of_two_f(FIFO_DEPTH) = false) report "wb_regs config ERROR: Key fifo <FIFO_DEPTH> has to be a power of two." severity error;
+    assert not ((CAM_SLOTS < 2) or (CAM_SLOTS > 64)) report "wb_regs config ERROR: Code bank <CAM_SLOTS> has to be 2 to 64 entries." severity error;
+    assert not (is_power_of_two_f(CAM_SLOTS) = false) report "wb_regs config ERROR: Code bank <CAM_SLOTS> has to be a power of two." severity error;
+    assert not ((CHORD_NUM < 1) or (CHORD_NUM > 8)) report "wb_regs config ERROR: Chord table <CHORD_NUM> has to be 1 to 8 entries." severity error;
+    assert not (CHORD_WINDOW < 0) report "wb_regs config ERROR: Chord window <CHORD_WINDOW> can not be negative." severity error;
+    assert not (WB_ADDR_SIZE < 128) report "wb_regs config ERROR: Address space <WB_ADDR_SIZE> has to be at least 128 bytes." severity error;
+    assert not (28+keymap_words_c > WB_ADDR_SIZE/4) report "wb_regs config ERROR: Address space <WB_ADDR_SIZE> too small for the keymap, use 256 bytes for more than 16 keys." severity error;
+    assert not (LOCK_EN and (WB_ADDR_SIZE < 256)) report "wb_regs config ERROR: Address space <WB_ADDR_SIZE> has to be at least 256 bytes for the lock engine." severity error;
 
     -- Device Access? -------------------------------------------------------------------------
     -- ----------------------------------------------------------------------------------------
+    s_word     <= to_integer(unsigned(wb_adr_i(index_size_f(WB_ADDR_SIZE)-1 downto 2)));
     access_req <= '1' when ((wb_adr_i and (not addr_mask_c)) = (WB_ADDR_BASE and (not addr_mask_c))) else '0';
 
 
     -------------------------------------------------------
-    -- Concurrents Outputs                              ---
+    -- Keypad scanner                                   ---
     -------------------------------------------------------
-    Col_1_o <= std_logic(c_col(0));
-    Col_2_o <= std_logic(c_col(1));
-    Col_3_o <= std_logic(c_col(2));
-    Col_4_o <= std_logic(c_col(3));
-    
-    s_row   <= Row_4_i &
-               Row_3_i &
-               Row_2_i &
-               Row_1_i;
-           
+    -- REG8 bits DEBOUNCE_WIDTH-1..0 : settle time in scan frames
+
+    peripheral_teclado_scan: entity neorv32.peripheral_teclado
+    generic map(ROWS            => ROWS,
+                COLS            => COLS,
+                SCAN_PRESCALER  => SCAN_PRESCALER,
+                DEBOUNCE_WIDTH  => DEBOUNCE_WIDTH,
+                DEBOUNCE_FRAMES => DEBOUNCE_FRAMES )
+    port map(
+      clk_i     => clk_i,
+      reset_i   => reset_i,
+      en_i      => en_i,
+      Row_i     => std_logic_vector(Row_i),
+      Col_o     => Col_o,
+      settle_i  => std_logic_vector(c_reg8(DEBOUNCE_WIDTH-1 downto 0)),
+      Key_o     => s_key,
+      Key_valid_o => s_key_valid,
+      Key_index_o => s_key_index,
+      Ghost_o   => s_ghost
+      );
+
+    s_key_value <= std_ulogic_vector(s_key);
+    s_key_wide  <= std_ulogic_vector(resize(unsigned(s_key_value), 64));
+
     -------------------------------------------------------
     -- Sinc processs                                    ---
     -------------------------------------------------------
     peripheral_teclado_sinc: process(clk_i, reset_i)
     begin
         if (reset_i = '1') then
-            c_counter   <= (others => '0');
-            c_col       <= (others => '0');   
-            c_key       <= (others => '0');
-            c_key_value <= (others => '0');
             c_reg0      <= (others => '0');
             c_reg1      <= (others => '0');
             c_reg2      <= (others => '0');
             c_reg3      <= (others => '0');
             c_reg4      <= (others => '0');
+            c_reg5      <= (others => '0');
+            c_reg8      <= std_ulogic_vector(to_unsigned(DEBOUNCE_FRAMES, 32));
+            c_reg9      <= (others => '0');
+            c_reg31     <= (others => '0');
+            c_reg48     <= (others => '0');
+            c_reg50     <= std_ulogic_vector(to_unsigned(3000, 16)) & std_ulogic_vector(to_unsigned(5000, 16));
+            c_reg51     <= x"0000" & std_ulogic_vector(to_unsigned(71, 8)) & std_ulogic_vector(to_unsigned(69, 8));
+            c_reg52     <= (others => '0');
+            c_cam_hit   <= '0';
+            c_cam_index <= (others => '0');
+            c_keymap    <= keymap_default_f;
+            c_chord     <= (others => (others => '0'));
             c_Password_result <= (others => '0');
+            c_cmp_start <= '0';
+            c_cmp_done  <= '0';
+            c_cmp_match <= '0';
+            c_key_prev  <= (others => '0');
+            c_press_pend <= (others => '0');
+            c_chord_wait <= 0;
+            c_irq       <= '0';
+            c_fifo_wp   <= (others => '0');
+            c_fifo_rp   <= (others => '0');
+            c_fifo_ovf  <= '0';
 
         elsif ( rising_edge(clk_i)) then
-            c_counter   <= n_counter;
-            c_col       <= n_col;
-            c_key       <= n_key;
-            c_key_value <= n_key_value;
             c_reg0      <= n_reg0; -- Storage the Key_value
             c_reg1      <= n_reg1; -- Storage the user password
             c_reg2      <= n_reg2; -- Storage the controls signals
             c_reg3      <= n_reg3; -- Storage the real password
             c_reg4      <= n_reg4; -- Storage the AND result between the user and the real password
+            c_reg5      <= n_reg5; -- Storage the interrupt enable and pending flags
+            c_reg8      <= n_reg8; -- Storage the debounce settle time
+            c_reg9      <= n_reg9; -- Storage the selected code slot
+            c_reg31     <= n_reg31; -- Storage the status read-to-clear mask
+            c_reg48     <= n_reg48; -- Storage the lock engine control
+            c_reg50     <= n_reg50; -- Storage the lock windows
+            c_reg51     <= n_reg51; -- Storage the lock reset and alarm codes
+            c_reg52     <= n_reg52; -- Storage the lock counters
+            c_cam_hit   <= n_cam_hit;
+            c_cam_index <= n_cam_index;
+            c_keymap    <= n_keymap; -- Storage the key codes
+            c_chord     <= n_chord;  -- Storage the chord table
             c_Password_result <= n_Password_result;
+            c_cmp_start <= s_cmp_start;
+            c_cmp_done  <= n_cmp_done;
+            c_cmp_match <= n_cmp_match;
+            c_key_prev  <= s_key_value;
+            c_press_pend <= n_press_pend;
+            c_chord_wait <= n_chord_wait;
+            c_irq       <= n_irq;
+            c_fifo_wp   <= n_fifo_wp;
+            c_fifo_rp   <= n_fifo_rp;
+            c_fifo_ovf  <= n_fifo_ovf;
 
         end if;
     end process;
 
     -------------------------------------------------------
-    -- Read key processs                                ---
+    -- Key pressed interrupt                            ---
+    -------------------------------------------------------
+    -- REG5 bit 0 : key pressed interrupt enable
+    -- REG5 bit 1 : compare done interrupt enable
+    -- REG5 bit 8 : key pressed pending, write '1' to clear
+    -- REG5 bit 9 : compare done pending, write '1' to clear
+
+    s_key_press <= s_key_value and not(c_key_prev);
+
+    n_irq       <= '1' when (s_evt_valid = '1' and c_reg5(0) = '1') or
+                            (c_cmp_start = '1' and c_reg5(1) = '1') or
+                            ((s_lock_open_evt = '1' or s_lock_fail_evt = '1') and c_reg48(1) = '1') else '0';
+
+    irq_o       <= c_irq;
+
+
+    -------------------------------------------------------
+    -- Key event fifo                                   ---
     -------------------------------------------------------
+    -- Each pressed key is pushed, reading REG6 pops the oldest one.
+    -- Keys pressed in the same scan frame are pushed one per cycle,
+    -- highest index first, so none of them is lost.
+    -- REG6 bit 31     : entry valid (fifo was not empty)
+    -- REG6 bit 30     : the entry is a chord
+    -- REG6 bits 29-24 : key index, or chord number
+    -- REG6 bits 23-16 : key code from the keymap, or chord code
+    -- REG6 bits 15-0  : the key in One Hot, only the first 16 keys
+    -- REG7 bits 7-0  : number of stored keys
+    -- REG7 bit 16    : overflow, a key was lost; write '1' to clear
+    -- REG7 bit 0     : write '1' to flush the fifo
 
-    peripheral_teclado_decode: process(c_counter, s_row, c_col, c_key, c_key_value)
+    s_fifo_level <= c_fifo_wp - c_fifo_rp;
+    s_fifo_empty <= '1' when (c_fifo_wp = c_fifo_rp) else '0';
+    s_fifo_full  <= '1' when (s_fifo_level = FIFO_DEPTH) else '0';
+    s_fifo_we    <= '1' when (s_evt_valid = '1' and s_fifo_full = '0') else '0';
+    s_fifo_head  <= fifo_mem(to_integer(c_fifo_rp(fifo_abits_c-1 downto 0)));
+
+    s_press_low  <= std_ulogic_vector(resize(unsigned(s_evt_key), 16));
+
+    -- A completed chord replaces the events of its keys
+    s_fifo_din   <= '1' & std_ulogic_vector(to_unsigned(s_chord_index, 6)) &
+                    c_chord(s_chord_index)(23 downto 0) when (s_chord_hit = '1') else
+                    '0' & std_ulogic_vector(to_unsigned(s_evt_index, 6)) &
+                    keymap_f(c_keymap, s_evt_index) & s_press_low;
+
+    -- One event per cycle: the chord, or the highest pending press. While
+    -- the pressed keys are part of a chord, the presses are held up to
+    -- CHORD_WINDOW frames, so a chord whose first key has its own action
+    -- is not taken for that key when the keys settle in different frames.
+    wb_peripheral_teclado_press_comb: process(c_press_pend, c_chord_wait, s_key_press, s_chord_hit, s_chord_part)
+        variable v_pend  : std_ulogic_vector(keys_c-1 downto 0);
+        variable v_index : natural range 0 to keys_c-1;
     begin
-        n_key       <= c_key;
-        n_col       <= (others => '0');
-        n_counter   <= (others => '0');
-        n_key_value <= c_key_value;
-
-        -- Sampling the value each four cycles.
-        if(c_counter = "00" and c_key /= "00000000" ) then
-            n_key_value <= c_key;     
-            n_key <= (others => '0'); -- Reset de value
+        v_pend  := c_press_pend or s_key_press;
+        v_index := key_index_f(v_pend);
+
+        s_evt_valid  <= '0';
+        s_evt_key    <= (others => '0');
+        s_evt_index  <= v_index;
+        n_press_pend <= v_pend;
+        n_chord_wait <= 0;
+
+        if (s_chord_part = '1') then
+            n_chord_wait <= c_chord_wait;
+        end if;
+
+        if (s_chord_hit = '1') then
+            s_evt_valid  <= '1';
+            n_press_pend <= (others => '0');
+        elsif (s_chord_part = '1') and (c_chord_wait /= chord_window_c) then
+            n_chord_wait <= c_chord_wait + 1; -- Wait for the rest of the chord
+        elsif (v_pend /= no_key_c) then
+            s_evt_valid           <= '1';
+            s_evt_key(v_index)    <= '1';
+            n_press_pend(v_index) <= '0';
         end if;
+    end process;
+
+    -- No reset, so the storage can be mapped to memory
+    wb_peripheral_teclado_fifo_mem: process(clk_i)
+    begin
+        if (rising_edge(clk_i)) then
+            if (s_fifo_we = '1') then
+                fifo_mem(to_integer(c_fifo_wp(fifo_abits_c-1 downto 0))) <= s_fifo_din;
+            end if;
+        end if;
+    end process;
+
+
+    -------------------------------------------------------
+    -- Lock engine                                      ---
+    -------------------------------------------------------
+    -- Runs the A/B/C/D sequence of the lock firmware on the key events,
+    -- with REG3 as the password. The CPU only configures it and gets
+    -- the door open / lockout interrupts.
+    -- REG48 bit 0      : engine running, the LEDs and the display follow it
+    -- REG48 bit 1      : door open / lockout interrupt enable
+    -- REG48 bit 8      : door opened pending, write '1' to clear
+    -- REG48 bit 9      : lockout pending, write '1' to clear
+    -- REG49 bits 1-0   : state, "00" idle, "01" door open, "10" locked out (read only)
+    -- REG49 bits 7-4   : bytes A/B/C/D accepted
+    -- REG49 bits 15-8  : last two digits typed
+    -- REG50 bits 15-0  : door open window in ms (5000 after reset)
+    -- REG50 bits 31-16 : lockout window in ms (3000 after reset)
+    -- REG51 bits 7-0   : key code that clears the typed code (69 = E after reset)
+    -- REG51 bits 15-8  : key code that locks out at once (71 = emergency chord after reset)
+    -- REG52 bits 15-0  : doors opened, bits 31-16 : lockouts, any write clears them
+
+    lock_engine: if LOCK_EN generate
+        peripheral_cerradura_0: entity neorv32.peripheral_cerradura
+        generic map(TICK_PRESCALER => LOCK_TICK_PRESCALER )
+        port map(
+          clk_i        => clk_i,
+          reset_i      => reset_i,
+          en_i         => c_reg48(0),
+          key_valid_i  => s_key_press_any,
+          key_code_i   => std_logic_vector(s_fifo_din(23 downto 16)),
+          password_i   => std_logic_vector(c_reg3),
+          open_ms_i    => std_logic_vector(c_reg50(15 downto 0)),
+          fail_ms_i    => std_logic_vector(c_reg50(31 downto 16)),
+          reset_code_i => std_logic_vector(c_reg51(7 downto 0)),
+          alarm_code_i => std_logic_vector(c_reg51(15 downto 8)),
+          State_o      => s_lock_state,
+          Stages_o     => s_lock_stages,
+          Digits_o     => s_lock_digits,
+          Open_evt_o   => s_lock_open_evt,
+          Fail_evt_o   => s_lock_fail_evt,
+          Led_o        => Lock_led_o,
+          Open_o       => Lock_open_o,
+          Text_o       => Lock_text_o
+          );
+
+        Lock_active_o <= c_reg48(0);
+    end generate;
+
+    no_lock_engine: if not LOCK_EN generate
+        s_lock_state    <= (others => '0');
+        s_lock_stages   <= (others => '0');
+        s_lock_digits   <= (others => '0');
+        s_lock_open_evt <= '0';
+        s_lock_fail_evt <= '0';
+
+        Lock_active_o   <= '0';
+        Lock_led_o      <= (others => '0');
+        Lock_open_o     <= '0';
+        Lock_text_o     <= (others => '0');
+    end generate;
+
+    s_key_press_any <= s_evt_valid;
+
+
+    -------------------------------------------------------
+    -- Chord table                                      ---
+    -------------------------------------------------------
+    -- REG18+i bit 31     : chord i enabled
+    -- REG18+i bits 23-16 : code of the chord event
+    -- REG18+i bits 15-0  : keys of the chord in One Hot, only the first 16 keys
+    -- When a new press leaves exactly the keys of an enabled chord
+    -- pressed, one chord event is stored instead of the key events.
+    -- While only some keys of an enabled chord are pressed, their events
+    -- wait up to CHORD_WINDOW frames for the rest of the chord.
+
+    wb_peripheral_teclado_chord_comb: process(c_chord, s_key_value, s_key_wide, s_key_press)
+    begin
+        s_chord_hit   <= '0';
+        s_chord_part  <= '0';
+        s_chord_index <= 0;
+
+        -- Downwards, so the lowest matching chord wins
+        for i in CHORD_NUM-1 downto 0 loop
+            if (c_chord(i)(31) = '1') and (x"000000000000" & c_chord(i)(15 downto 0) = s_key_wide) and (s_key_press /= no_key_c) then
+                s_chord_hit   <= '1';
+                s_chord_index <= i;
+            end if;
+            if (c_chord(i)(31) = '1') and (s_key_wide(63 downto 16) = x"000000000000") and (s_key_value /= no_key_c) and
+               ((s_key_wide(15 downto 0) and not c_chord(i)(15 downto 0)) = x"0000") and
+               (s_key_wide(15 downto 0) /= c_chord(i)(15 downto 0)) then
+                s_chord_part  <= '1';
+            end if;
+        end loop;
+    end process;
+
 
-        if (en_i = '1') then
-            n_counter   <= c_counter + 1;
-
-            case (c_counter) is
-                when "00" =>
-                    n_col   <=  "1110";
-                    if (s_row /= "1111") then
-                        n_key <= x"000" & not(s_row);
-                    end if;
-                    
-                when "01" =>
-                    n_col   <=  "1101";
-                    if (s_row /= "1111") then
-                        n_key <= x"00" & not(s_row) & x"0";
-                    end if;
-
-                when "10" =>
-                    n_col   <=  "1011";
-                    if (s_row /= "1111") then
-                        n_key <= x"0" & not(s_row) & x"00";
-                    end if;
-
-                when others =>
-                    n_col   <=  "0111";
-                    if (s_row /= "1111") then
-                        n_key <= not(s_row) & x"000";
-                    end if;
-            end case;
+    -------------------------------------------------------
+    -- User code bank                                   ---
+    -------------------------------------------------------
+    -- Every enabled slot is compared with REG1 in parallel, the
+    -- result is registered and ready the cycle after REG1 changes.
+    -- REG9 bits 5-0  : selected slot
+    -- REG10          : write a code to the selected slot and enable it (write only)
+    -- REG11 bit 0    : enable of the selected slot
+    -- REG12 bit 31   : REG1 matches an enabled slot
+    -- REG12 bits 5-0 : lowest matching slot
+
+    s_cam_slot <= to_integer(unsigned(c_reg9(cam_abits_c-1 downto 0)));
+
+    -- No reset, the codes survive the soft reset of the peripherals
+    wb_peripheral_teclado_cam_mem: process(clk_i)
+    begin
+        if (rising_edge(clk_i)) then
+            if (s_cam_we = '1') then
+                cam_mem(s_cam_slot) <= wb_dat_i;
+                cam_en(s_cam_slot)  <= '1';
+            elsif (s_cam_en_we = '1') then
+                cam_en(s_cam_slot)  <= wb_dat_i(0);
+            end if;
         end if;
+    end process;
 
+    wb_peripheral_teclado_cam_match_comb: process(cam_mem, cam_en, c_reg1)
+        variable v_hit   : std_ulogic;
+        variable v_index : unsigned(cam_abits_c-1 downto 0);
+    begin
+        v_hit   := '0';
+        v_index := (others => '0');
+
+        -- Downwards, so the lowest matching slot wins
+        for i in CAM_SLOTS-1 downto 0 loop
+            if (cam_en(i) = '1') and (cam_mem(i) = c_reg1) then
+                v_hit   := '1';
+                v_index := to_unsigned(i, cam_abits_c);
+            end if;
+        end loop;
+
+        n_cam_hit   <= v_hit;
+        n_cam_index <= v_index;
     end process;
 
 
+    -------------------------------------------------------
+    -- Key code                                         ---
+    -------------------------------------------------------
+    -- REG13 bit 31      : a key is pressed
+    -- REG13 bit 30      : ghosting, the last scan frame was ambiguous and discarded
+    -- REG13 bits 13-8   : index of the pressed key (highest one)
+    -- REG13 bits 7-0    : key code from the keymap
+    -- REG14-REG17       : keymap, byte i of REG(14+k) is the code of index 4k+i
+    -- REG32+            : rest of the keymap for more than 16 keys, REG(28+k) holds word k
+    -- REG0 / REG26      : debounced keys 31-0 / 63-32 in One Hot, ROWS bits per column
+    -- REG27             : REG2 write '1' to set, starts a compare if a command bit is set
+    -- REG28             : REG2 write '1' to clear
+    -- REG29             : byte i is written to byte i of REG1 and sets command bit i
+    --                     of REG2, a byte store is a full A/B/C/D command
+    -- REG30             : status snapshot, read only
+    --   bit 31      : fifo not empty          bit 30      : fifo overflow
+    --   bit 29      : a key is pressed        bit 28      : ghosting
+    --   bits 27-24  : REG2 command bits       bits 23-20  : REG4 bytes A/B/C/D matched
+    --   bit 19      : compare done            bit 18      : every commanded byte matched
+    --   bit 17      : REG5 compare pending    bit 16      : REG5 key pressed pending
+    --   bits 15-8   : number of stored keys   bits 7-0    : code of the pressed key
+    -- REG31 bits 17-16  : read-to-clear mask, reading REG30 clears these REG5 pending bits
+    --                     (an event in the same cycle stays pending)
+    -- REG48-REG52       : lock engine (LOCK_EN = true), see above
+    -- Writes honor wb_sel_i: data registers only change the enabled bytes,
+    -- the rest act on the enabled bytes of the written value.
+
+
     -------------------------------------------------------
     -- WISHBONE PROCESS                                 ---
     -------------------------------------------------------
@@ -210,111 +620,422 @@ architecture wb_peripheral_rtl of wb_peripheral_teclado is
         wb_sel_i, 
         access_req, 
         wb_we_i,
-        c_key_value,
+        wb_adr_i,
+        wb_dat_i,
+        s_key_value,
+        s_key_wide,
+        s_evt_valid,
+        c_Password_result,
+        c_cmp_start,
+        c_cmp_done,
+        c_cmp_match,
         c_reg0, -- Storage the Key_value
         c_reg1, -- Storage the User password
         c_reg2, -- Storage the Control signal
         c_reg3, -- Storage the Real Password
-        c_reg4  -- Storage the Comparation result
+        c_reg4, -- Storage the Comparation result
+        c_reg5, -- Storage the Interrupt control
+        c_reg8, -- Storage the Debounce settle time
+        c_reg9, -- Storage the selected code slot
+        c_reg31, -- Storage the status read-to-clear mask
+        c_reg48, -- Storage the lock engine control
+        c_reg50, -- Storage the lock windows
+        c_reg51, -- Storage the lock reset and alarm codes
+        c_reg52, -- Storage the lock counters
+        s_lock_state,
+        s_lock_stages,
+        s_lock_digits,
+        s_lock_open_evt,
+        s_lock_fail_evt,
+        cam_en,
+        s_cam_slot,
+        s_key_valid,
+        s_key_index,
+        s_ghost,
+        c_keymap,
+        c_chord,
+        s_word,
+        c_cam_hit,
+        c_cam_index,
+        fifo_mem,
+        s_fifo_head,
+        c_fifo_wp,
+        c_fifo_rp,
+        c_fifo_ovf,
+        s_fifo_we,
+        s_fifo_level,
+        s_fifo_empty,
+        s_fifo_full
         )
+        variable v_mask : std_ulogic_vector(31 downto 0); -- Enabled byte lanes
+        variable v_dat  : std_ulogic_vector(31 downto 0); -- Written bits, zero on disabled lanes
+        variable v_reg2 : std_ulogic_vector(31 downto 0); -- Value of REG2 after the write
+        variable v_word : std_ulogic_vector(31 downto 0); -- Value of REG8/REG9 after the write
     begin
+        v_mask := sel_mask_f(wb_sel_i);
+        v_dat  := wb_dat_i and v_mask;
+        v_reg2 := c_reg2;
+        v_word := (others => '0');
+
         -- Keep values
-        n_reg0 <=  x"0000" & c_key_value;
+        n_reg0 <= s_key_wide(31 downto 0);
         n_reg1 <= c_reg1;
         n_reg2 <= c_reg2;
         n_reg3 <= c_reg3;
-        n_reg4 <= x"0000000" & c_Password_result;
+        n_reg4 <= x"00000" & "0" & (c_cmp_done and not c_cmp_match) & c_cmp_match & c_cmp_done & x"0" & c_Password_result;
+        n_reg5 <= c_reg5;
+        n_reg8 <= c_reg8;
+        n_reg9 <= c_reg9;
+        n_reg31 <= c_reg31;
+        n_reg48 <= c_reg48;
+        n_reg50 <= c_reg50;
+        n_reg51 <= c_reg51;
+        n_reg52 <= c_reg52;
+
+        n_keymap <= c_keymap;
+        n_chord  <= c_chord;
+
+        s_cam_we    <= '0';
+        s_cam_en_we <= '0';
+
+        n_fifo_wp  <= c_fifo_wp;
+        n_fifo_rp  <= c_fifo_rp;
+        n_fifo_ovf <= c_fifo_ovf;
+
+        s_cmp_start <= '0';
+
+        if (c_cmp_start = '1') then -- Compare finished
+            n_reg5(9) <= '1';
+        end if;
+
+        if (s_evt_valid = '1') then -- New key pressed
+            n_reg5(8) <= '1';
+            if (s_fifo_full = '1') then
+                n_fifo_ovf <= '1';
+            end if;
+        end if;
+
+        if (s_fifo_we = '1') then
+            n_fifo_wp <= c_fifo_wp + 1;
+        end if;
+
+        if (s_lock_open_evt = '1') then -- Door opened by the lock engine
+            n_reg48(8) <= '1';
+            n_reg52(15 downto 0) <= std_ulogic_vector(unsigned(c_reg52(15 downto 0)) + 1);
+        end if;
+
+        if (s_lock_fail_evt = '1') then -- Lockout started by the lock engine
+            n_reg48(9) <= '1';
+            n_reg52(31 downto 16) <= std_ulogic_vector(unsigned(c_reg52(31 downto 16)) + 1);
+        end if;
 
         if (c_reg2(7 downto 0) = x"10") then -- New Password
             n_reg2 <= (others => '0');
             n_reg3 <= c_reg1; 
         end if;
 
-        wb_dat_o <= c_reg0;
+        -- Not addressed: drive zeros so the slaves can share an OR bus
+        s_wb_dat <= (others => '0');
         -- Default ack is inactive
-        wb_ack_o <= '0';
+        s_wb_ack <= '0';
 
         -- Is the peripheral selected?
         if (wb_cyc_i = '1') and (wb_stb_i = '1') and (access_req = '1') then
 
-            -- Write access, only full-word accesses
-            if (wb_we_i = '1' and wb_sel_i = "1111") then
+            -- Write access, only the enabled bytes
+            if (wb_we_i = '1') then
                 case to_integer(unsigned(wb_adr_i(index_size_f(WB_ADDR_SIZE)-1 downto 2))) is
                     when 0 =>
-                        n_reg0 <= wb_dat_i; 
+                        n_reg0 <= (c_reg0 and not v_mask) or v_dat;
                     when 1 =>
-                        n_reg1 <= wb_dat_i;
+                        n_reg1 <= (c_reg1 and not v_mask) or v_dat;
                     when 2 =>
-                        n_reg2 <= wb_dat_i;
+                        v_reg2 := (c_reg2 and not v_mask) or v_dat;
+                        n_reg2 <= v_reg2;
+                        if (v_reg2(3 downto 0) /= "0000") then
+                            s_cmp_start <= '1';
+                        end if;
                     when 3 =>
-                        n_reg3 <= wb_dat_i;
+                        n_reg3 <= (c_reg3 and not v_mask) or v_dat;
                     when 4 =>
-                        n_reg4 <= wb_dat_i;
+                        n_reg4 <= (c_reg4 and not v_mask) or v_dat;
+                    when 5 =>
+                        if (wb_sel_i(0) = '1') then
+                            n_reg5(1 downto 0) <= wb_dat_i(1 downto 0);
+                        end if;
+                        if (v_dat(8) = '1') then
+                            n_reg5(8) <= '0';
+                        end if;
+                        if (v_dat(9) = '1') then
+                            n_reg5(9) <= '0';
+                        end if;
+                    when 7 =>
+                        if (v_dat(0) = '1') then -- Flush
+                            n_fifo_rp <= c_fifo_wp;
+                        end if;
+                        if (v_dat(16) = '1') then
+                            n_fifo_ovf <= '0';
+                        end if;
+                    when 8 =>
+                        v_word := (c_reg8 and not v_mask) or v_dat;
+                        n_reg8 <= (others => '0');
+                        n_reg8(DEBOUNCE_WIDTH-1 downto 0) <= v_word(DEBOUNCE_WIDTH-1 downto 0);
+                    when 9 =>
+                        v_word := (c_reg9 and not v_mask) or v_dat;
+                        n_reg9 <= (others => '0');
+                        n_reg9(cam_abits_c-1 downto 0) <= v_word(cam_abits_c-1 downto 0);
+                    when 10 => -- The code bank stores whole words
+                        if (wb_sel_i = "1111") then
+                            s_cam_we <= '1';
+                        end if;
+                    when 11 =>
+                        if (wb_sel_i(0) = '1') then
+                            s_cam_en_we <= '1';
+                        end if;
+                    when 14 to 17 =>
+                        n_keymap(to_integer(unsigned(wb_adr_i(index_size_f(WB_ADDR_SIZE)-1 downto 2))) - 14) <=
+                            (c_keymap(to_integer(unsigned(wb_adr_i(index_size_f(WB_ADDR_SIZE)-1 downto 2))) - 14) and not v_mask) or v_dat;
+                    when 27 => -- REG2 set
+                        n_reg2 <= c_reg2 or v_dat;
+                        if (v_dat(3 downto 0) /= "0000") then
+                            s_cmp_start <= '1';
+                        end if;
+                    when 28 => -- REG2 clear
+                        n_reg2 <= c_reg2 and not v_dat;
+                    when 29 => -- User password byte and its command
+                        n_reg1 <= (c_reg1 and not v_mask) or v_dat;
+                        n_reg2 <= c_reg2 or (x"0000000" & wb_sel_i);
+                        s_cmp_start <= '1';
+                    when 31 =>
+                        if (wb_sel_i(2) = '1') then
+                            n_reg31(17 downto 16) <= wb_dat_i(17 downto 16);
+                        end if;
                     when others =>
-                        null;
+                        if (s_word >= 18) and (s_word < 18+CHORD_NUM) then
+                            n_chord(s_word - 18) <= (c_chord(s_word - 18) and not v_mask) or v_dat;
+                        end if;
+                        if (s_word >= 32) and (s_word < 28+keymap_words_c) then
+                            n_keymap(s_word - 28) <= (c_keymap(s_word - 28) and not v_mask) or v_dat;
+                        end if;
+                        if LOCK_EN and (s_word = 48) then
+                            if (wb_sel_i(0) = '1') then
+                                n_reg48(1 downto 0) <= wb_dat_i(1 downto 0);
+                            end if;
+                            if (v_dat(8) = '1') and (s_lock_open_evt = '0') then
+                                n_reg48(8) <= '0';
+                            end if;
+                            if (v_dat(9) = '1') and (s_lock_fail_evt = '0') then
+                                n_reg48(9) <= '0';
+                            end if;
+                        end if;
+                        if LOCK_EN and (s_word = 50) then
+                            n_reg50 <= (c_reg50 and not v_mask) or v_dat;
+                        end if;
+                        if LOCK_EN and (s_word = 51) then
+                            n_reg51 <= x"0000" & ((c_reg51(15 downto 0) and not v_mask(15 downto 0)) or v_dat(15 downto 0));
+                        end if;
+                        if LOCK_EN and (s_word = 52) then
+                            n_reg52 <= (others => '0');
+                        end if;
                 end case;
-                wb_ack_o <= '1';
+                s_wb_ack <= '1';
             else
             -- Read access
                 case to_integer(unsigned(wb_adr_i(index_size_f(WB_ADDR_SIZE)-1 downto 2))) is
                     when 0 =>
-                        wb_dat_o <= c_reg0;
+                        s_wb_dat <= c_reg0;
                     when 1 =>
-                        wb_dat_o <= c_reg1;
+                        s_wb_dat <= c_reg1;
                     when 2 =>
-                        wb_dat_o <= c_reg2;
+                        s_wb_dat <= c_reg2;
                     when 3 =>
-                        wb_dat_o <= c_reg3;
+                        s_wb_dat <= c_reg3;
                     when 4 =>
-                        wb_dat_o <= c_reg4;
+                        s_wb_dat <= c_reg4;
+                    when 5 =>
+                        s_wb_dat <= c_reg5;
+                    when 6 =>
+                        s_wb_dat <= (others => '0');
+                        if (s_fifo_empty = '0') then -- Pop
+                            s_wb_dat  <= '1' & s_fifo_head;
+                            n_fifo_rp <= c_fifo_rp + 1;
+                        end if;
+                    when 7 =>
+                        s_wb_dat <= (others => '0');
+                        s_wb_dat(7 downto 0) <= std_ulogic_vector(resize(s_fifo_level, 8));
+                        s_wb_dat(16)         <= c_fifo_ovf;
+                    when 8 =>
+                        s_wb_dat <= c_reg8;
+                    when 9 =>
+                        s_wb_dat <= c_reg9;
+                    when 11 =>
+                        s_wb_dat <= (others => '0');
+                        s_wb_dat(0) <= cam_en(s_cam_slot);
+                    when 12 =>
+                        s_wb_dat <= (others => '0');
+                        s_wb_dat(31) <= c_cam_hit;
+                        s_wb_dat(cam_abits_c-1 downto 0) <= std_ulogic_vector(c_cam_index);
+                    when 13 =>
+                        s_wb_dat <= (others => '0');
+                        s_wb_dat(30) <= s_ghost;
+                        if (s_key_valid = '1') then
+                            s_wb_dat(31)          <= '1';
+                            s_wb_dat(8+key_abits_c-1 downto 8) <= s_key_index;
+                            s_wb_dat(7 downto 0)  <= keymap_f(c_keymap, to_integer(unsigned(s_key_index)));
+                        end if;
+                    when 14 to 17 =>
+                        s_wb_dat <= c_keymap(to_integer(unsigned(wb_adr_i(index_size_f(WB_ADDR_SIZE)-1 downto 2))) - 14);
                     when others =>
-                        null;
+                        if (s_word >= 18) and (s_word < 18+CHORD_NUM) then
+                            s_wb_dat <= c_chord(s_word - 18);
+                        end if;
+                        if (s_word = 26) then
+                            s_wb_dat <= s_key_wide(63 downto 32);
+                        end if;
+                        if (s_word = 27) or (s_word = 28) then
+                            s_wb_dat <= c_reg2;
+                        end if;
+                        if (s_word = 29) then
+                            s_wb_dat <= c_reg1;
+                        end if;
+                        if (s_word = 30) then -- Status snapshot
+                            s_wb_dat(31)           <= not s_fifo_empty;
+                            s_wb_dat(30)           <= c_fifo_ovf;
+                            s_wb_dat(29)           <= s_key_valid;
+                            s_wb_dat(28)           <= s_ghost;
+                            s_wb_dat(27 downto 24) <= c_reg2(3 downto 0);
+                            s_wb_dat(23 downto 20) <= c_Password_result;
+                            s_wb_dat(19)           <= c_cmp_done;
+                            s_wb_dat(18)           <= c_cmp_match;
+                            s_wb_dat(17 downto 16) <= c_reg5(9 downto 8);
+                            s_wb_dat(15 downto 8)  <= std_ulogic_vector(resize(s_fifo_level, 8));
+                            if (s_key_valid = '1') then
+                                s_wb_dat(7 downto 0) <= keymap_f(c_keymap, to_integer(unsigned(s_key_index)));
+                            end if;
+                            if (c_reg31(16) = '1') and (s_evt_valid = '0') then
+                                n_reg5(8) <= '0';
+                            end if;
+                            if (c_reg31(17) = '1') and (c_cmp_start = '0') then
+                                n_reg5(9) <= '0';
+                            end if;
+                        end if;
+                        if (s_word = 31) then
+                            s_wb_dat <= c_reg31;
+                        end if;
+                        if LOCK_EN and (s_word = 48) then
+                            s_wb_dat <= c_reg48;
+                        end if;
+                        if LOCK_EN and (s_word = 49) then
+                            s_wb_dat(1 downto 0)  <= std_ulogic_vector(s_lock_state);
+                            s_wb_dat(7 downto 4)  <= std_ulogic_vector(s_lock_stages);
+                            s_wb_dat(15 downto 8) <= std_ulogic_vector(s_lock_digits);
+                        end if;
+                        if LOCK_EN and (s_word = 50) then
+                            s_wb_dat <= c_reg50;
+                        end if;
+                        if LOCK_EN and (s_word = 51) then
+                            s_wb_dat <= c_reg51;
+                        end if;
+                        if LOCK_EN and (s_word = 52) then
+                            s_wb_dat <= c_reg52;
+                        end if;
+                        if (s_word >= 32) and (s_word < 28+keymap_words_c) then
+                            s_wb_dat <= c_keymap(s_word - 28);
+                        end if;
                 end case;
-                wb_ack_o <= '1';
+                s_wb_ack <= '1';
             end if;
 
         end if;
 
     end process;
 
+    -------------------------------------------------------
+    -- Bus response                                     ---
+    -------------------------------------------------------
+    -- Pipelined: registers and FIFO pointers are updated in the cycle
+    -- the request is seen, ack/data come out of registers one cycle
+    -- later. The slave never stalls.
+
+    wb_pipelined_resp: if WB_PIPELINED generate
+        wb_peripheral_teclado_resp_sinc: process(clk_i, reset_i)
+        begin
+            if (reset_i = '1') then
+                c_wb_dat <= (others => '0');
+                c_wb_ack <= '0';
+            elsif (rising_edge(clk_i)) then
+                c_wb_dat <= s_wb_dat;
+                c_wb_ack <= s_wb_ack;
+            end if;
+        end process;
+
+        wb_dat_o <= c_wb_dat;
+        wb_ack_o <= c_wb_ack;
+    end generate;
+
+    wb_classic_resp: if not WB_PIPELINED generate
+        c_wb_dat <= (others => '0');
+        c_wb_ack <= '0';
+
+        wb_dat_o <= s_wb_dat;
+        wb_ack_o <= s_wb_ack;
+    end generate;
+
+    wb_stall_o <= '0';
+
     
     -------------------------------------------------------
     -- COMPARE THE PASSWORD                             ---
     -------------------------------------------------------
+    -- REG4 bits 3-0 : byte A/B/C/D matched (sticky until reset)
+    -- REG4 bit 8    : compare done, cleared by the next compare command
+    -- REG4 bit 9    : every commanded byte matched
+    -- REG4 bit 10   : some commanded byte did not match
+
     wb_peripheral_teclado_Compare_password_comb: process(
+        s_cmp_start,
+        c_cmp_start,
+        c_cmp_done,
+        c_cmp_match,
         c_reg1, 
         c_reg2,
         c_reg3, 
         c_Password_result
         )
-    begin   
+        variable v_match  : std_ulogic;
+        variable v_result : std_logic_vector(3 downto 0);
+    begin
 
-        n_Password_result <= c_Password_result;
-                        
-            if (c_reg2(0) = '1') then  -- Command "A"
-                if ((c_reg1(7 downto 0) xnor c_reg3(7 downto 0)) = "11111111") then
-                    n_Password_result <= c_Password_result(3 downto 1) & "1";
-                end if;
-            end if;
+        n_cmp_done        <= c_cmp_done;
+        n_cmp_match       <= c_cmp_match;
+        v_match           := '1';
+        v_result          := c_Password_result;
 
-            if (c_reg2(1) = '1') then -- Command "B"
-                if ((c_reg1(15 downto 8) xnor c_reg3(15 downto 8)) = "11111111") then
-                    n_Password_result <= c_Password_result(3 downto 2) & "1" & c_Password_result(0);
+        -- Commands "A" to "D": every commanded byte that matches sets its own
+        -- result bit, the bits already set stay until Reset_teclado()
+        for k in 0 to 3 loop
+            if (c_reg2(k) = '1') then
+                if (c_reg1(8*k+7 downto 8*k) = c_reg3(8*k+7 downto 8*k)) then
+                    v_result(k) := '1';
+                else
+                    v_match := '0';
                 end if;
             end if;
+        end loop;
 
-            if (c_reg2(2) = '1') then  -- Command "C"
-                if ((c_reg1(23 downto 16) xnor c_reg3(23 downto 16)) = "11111111") then
-                    n_Password_result <= c_Password_result(3) & "1" & c_Password_result(1 downto 0);
-                end if;
-            end if;
+        n_Password_result <= v_result;
 
-           if (c_reg2(3) = '1') then -- Command "D"
-                if ((c_reg1(31 downto 24) xnor c_reg3(31 downto 24)) = "11111111") then
-                    n_Password_result <= "1" & c_Password_result(2 downto 0);
-                end if;
-            end if;
+        -- New command: the status of the previous one is not valid anymore
+        if (s_cmp_start = '1') then
+            n_cmp_done  <= '0';
+            n_cmp_match <= '0';
+        end if;
 
+        -- The command is in REG2, the result is ready in this cycle
+        if (c_cmp_start = '1') then
+            n_cmp_done  <= '1';
+            n_cmp_match <= v_match;
+        end if;
 
     end process;
 
@@ -0,0 +1,96 @@
+library ieee;
+use ieee.std_logic_1164.all;
+use ieee.numeric_std.all;
+
+-- Behavioral ROWS x COLS key matrix: a pressed key shorts its row to its column.
+-- The rows have pull-ups, the scanner drives one column low at a time.
+
+entity keypad_model is
+  generic(
+    ROWS                 : integer := 4;
+    COLS                 : integer := 4;
+    BOUNCE_CYCLES        : integer := 0     -- Contact chatter after every change, in clock cycles
+  );
+  port (
+    clk_i                : in  std_ulogic;
+
+    -- Keys held, One Hot with ROWS bits per column as Key_o of the scanner
+    keys_i               : in  std_ulogic_vector(ROWS*COLS-1 downto 0);
+
+    -- Matrix lines, the driven column is low, the rows are active low
+    Col_i                : in  std_logic_vector(COLS-1 downto 0);
+    Row_o                : out std_logic_vector(ROWS-1 downto 0)
+  );
+end entity;
+
+architecture keypad_model_sim of keypad_model is
+
+    signal s_contact : std_ulogic_vector(ROWS*COLS-1 downto 0) := (others => '0');
+
+begin
+
+    -- Contacts: after a change the keys go back and forth between the old and the
+    -- new value, 7 cycles each, during BOUNCE_CYCLES
+    keypad_model_bounce: process(clk_i)
+        variable v_age  : natural := 0;
+        variable v_old  : std_ulogic_vector(ROWS*COLS-1 downto 0) := (others => '0');
+        variable v_from : std_ulogic_vector(ROWS*COLS-1 downto 0) := (others => '0');
+    begin
+        if rising_edge(clk_i) then
+            if (keys_i /= v_old) then
+                v_age  := 0;
+                v_from := v_old;
+                v_old  := keys_i;
+            elsif (v_age < BOUNCE_CYCLES) then
+                v_age  := v_age + 1;
+            end if;
+
+            if (v_age < BOUNCE_CYCLES) and ((v_age / 7) mod 2 = 1) then
+                s_contact <= v_from;
+            else
+                s_contact <= keys_i;
+            end if;
+        end if;
+    end process;
+
+    -- Without bounce the keys reach the rows in the same cycle. There are no diodes:
+    -- the driven column also pulls the rows reached through other pressed keys
+    -- (three corners of a rectangle show the fourth one, the ghost key).
+    keypad_model_matrix: process(s_contact, keys_i, Col_i)
+        variable v_keys : std_ulogic_vector(ROWS*COLS-1 downto 0);
+        variable v_row  : std_ulogic_vector(ROWS-1 downto 0);
+        variable v_col  : std_ulogic_vector(COLS-1 downto 0);
+    begin
+        v_keys := s_contact;
+        if (BOUNCE_CYCLES = 0) then
+            v_keys := keys_i;
+        end if;
+
+        v_col := (others => '0');
+        for c in 0 to COLS-1 loop
+            if (Col_i(c) = '0') then
+                v_col(c) := '1';
+            end if;
+        end loop;
+
+        v_row := (others => '0');
+        for n in 0 to ROWS+COLS loop
+            for c in 0 to COLS-1 loop
+                for r in 0 to ROWS-1 loop
+                    if (v_keys(ROWS*c+r) = '1') and ((v_col(c) = '1') or (v_row(r) = '1')) then
+                        v_col(c) := '1';
+                        v_row(r) := '1';
+                    end if;
+                end loop;
+            end loop;
+        end loop;
+
+        Row_o <= (others => '1');
+        for r in 0 to ROWS-1 loop
+            if (v_row(r) = '1') then
+                Row_o(r) <= '0';
+            end if;
+        end loop;
+    end process;
+
+end architecture;
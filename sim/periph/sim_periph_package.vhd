@@ -0,0 +1,179 @@
+library ieee;
+use ieee.std_logic_1164.all;
+use ieee.numeric_std.all;
+
+library std;
+use std.textio.all;
+
+-- Helpers of the peripheral benchmarks: Wishbone master BFM and results file.
+
+package sim_periph_package is
+
+    constant clk_hz_c  : natural := 12000000;            -- iCEBreaker clock
+    constant t_clk_c   : time    := 1 sec / clk_hz_c;    -- 83.333 ns
+    constant wb_tmo_c  : natural := 64;                  -- Cycles without ack before the bench fails
+
+    -- Signals driven by the Wishbone master
+    type wb_master_t is record
+        cyc : std_ulogic;
+        stb : std_ulogic;
+        we  : std_ulogic;
+        adr : std_ulogic_vector(31 downto 0);
+        dat : std_ulogic_vector(31 downto 0);
+        sel : std_ulogic_vector(03 downto 0);
+    end record;
+
+    constant wb_idle_c : wb_master_t := (cyc => '0', stb => '0', we => '0', adr => (others => '0'),
+                                         dat => (others => '0'), sel => (others => '0'));
+
+    -- One Wishbone transaction, called right after a rising edge. Classic mode holds
+    -- stb until ack, pipelined mode drops it after the first edge (the slaves never
+    -- stall). Back to back calls keep cyc high, one request after the other.
+    -- cycles: edges from the request to the ack, both included
+    procedure wb_access(
+        signal   clk_i  : in  std_ulogic;
+        signal   wb_o   : out wb_master_t;
+        signal   ack_i  : in  std_ulogic;
+        signal   dat_i  : in  std_ulogic_vector(31 downto 0);
+        constant we     : in  std_ulogic;
+        constant addr   : in  std_ulogic_vector(31 downto 0);
+        constant data   : in  std_ulogic_vector(31 downto 0);
+        constant sel    : in  std_ulogic_vector(03 downto 0);
+        constant pipe   : in  boolean;
+        variable rdata  : out std_ulogic_vector(31 downto 0);
+        variable cycles : out natural
+    );
+
+    -- Pipelined burst to one register: stb stays high for count cycles, one request
+    -- per edge (data, data+1, ...), then waits for the count acks. Only for B4
+    -- pipelined slaves, a classic slave would take a held stb as one request.
+    -- rdata: data of the last ack, cycles: edges from the first request to the last ack
+    procedure wb_burst(
+        signal   clk_i  : in  std_ulogic;
+        signal   wb_o   : out wb_master_t;
+        signal   ack_i  : in  std_ulogic;
+        signal   dat_i  : in  std_ulogic_vector(31 downto 0);
+        constant we     : in  std_ulogic;
+        constant addr   : in  std_ulogic_vector(31 downto 0);
+        constant data   : in  std_ulogic_vector(31 downto 0);
+        constant count  : in  positive;
+        variable rdata  : out std_ulogic_vector(31 downto 0);
+        variable cycles : out natural
+    );
+
+    -- Bus idle until the next rising edge
+    procedure wb_release(signal clk_i : in std_ulogic; signal wb_o : out wb_master_t);
+
+    -- Clock cycles between two instants
+    function cycles_f(t0, t1 : time) return natural;
+
+    -- Results: one "bench,metric,value,unit" line appended to the file
+    procedure result(file_name, bench, metric : string; value : integer; unit : string);
+    procedure result(file_name, bench, metric : string; value : real; unit : string);
+
+end package;
+
+package body sim_periph_package is
+
+    procedure wb_access(
+        signal   clk_i  : in  std_ulogic;
+        signal   wb_o   : out wb_master_t;
+        signal   ack_i  : in  std_ulogic;
+        signal   dat_i  : in  std_ulogic_vector(31 downto 0);
+        constant we     : in  std_ulogic;
+        constant addr   : in  std_ulogic_vector(31 downto 0);
+        constant data   : in  std_ulogic_vector(31 downto 0);
+        constant sel    : in  std_ulogic_vector(03 downto 0);
+        constant pipe   : in  boolean;
+        variable rdata  : out std_ulogic_vector(31 downto 0);
+        variable cycles : out natural
+    ) is
+        variable v_n : natural := 0;
+    begin
+        wb_o <= (cyc => '1', stb => '1', we => we, adr => addr, dat => data, sel => sel);
+        loop
+            wait until rising_edge(clk_i);
+            v_n := v_n + 1;
+            -- The values read here are the ones before the edge
+            exit when (ack_i = '1');
+            if pipe then
+                wb_o.stb <= '0';
+            end if;
+            assert (v_n < wb_tmo_c) report "wb_access: no ack at 0x" & to_hstring(addr) severity failure;
+        end loop;
+        rdata  := dat_i;
+        cycles := v_n;
+        wb_o   <= wb_idle_c;
+    end procedure;
+
+    procedure wb_burst(
+        signal   clk_i  : in  std_ulogic;
+        signal   wb_o   : out wb_master_t;
+        signal   ack_i  : in  std_ulogic;
+        signal   dat_i  : in  std_ulogic_vector(31 downto 0);
+        constant we     : in  std_ulogic;
+        constant addr   : in  std_ulogic_vector(31 downto 0);
+        constant data   : in  std_ulogic_vector(31 downto 0);
+        constant count  : in  positive;
+        variable rdata  : out std_ulogic_vector(31 downto 0);
+        variable cycles : out natural
+    ) is
+        variable v_n   : natural := 0;
+        variable v_req : natural := 0;
+        variable v_ack : natural := 0;
+    begin
+        wb_o <= (cyc => '1', stb => '1', we => we, adr => addr, dat => data, sel => "1111");
+        loop
+            wait until rising_edge(clk_i);
+            v_n := v_n + 1;
+            if (v_req < count) then
+                v_req := v_req + 1;
+            end if;
+            if (ack_i = '1') then
+                v_ack := v_ack + 1;
+                rdata := dat_i;
+            end if;
+            exit when (v_ack = count);
+            if (v_req < count) then
+                wb_o.dat <= std_ulogic_vector(unsigned(data) + v_req);
+            else
+                wb_o.stb <= '0';
+            end if;
+            assert (v_n < count + wb_tmo_c) report "wb_burst: " & integer'image(v_ack) & " of " &
+                integer'image(count) & " acks at 0x" & to_hstring(addr) severity failure;
+        end loop;
+        cycles := v_n;
+        wb_o   <= wb_idle_c;
+    end procedure;
+
+    procedure wb_release(signal clk_i : in std_ulogic; signal wb_o : out wb_master_t) is
+    begin
+        wb_o <= wb_idle_c;
+        wait until rising_edge(clk_i);
+    end procedure;
+
+    function cycles_f(t0, t1 : time) return natural is
+    begin
+        -- Rounded, the half period of the clock is truncated to the time resolution
+        return (t1 - t0 + t_clk_c/2) / t_clk_c;
+    end function;
+
+    procedure result(file_name, bench, metric : string; value : integer; unit : string) is
+        file     f   : text open append_mode is file_name;
+        variable v_l : line;
+    begin
+        write(v_l, bench & "," & metric & "," & integer'image(value) & "," & unit);
+        writeline(f, v_l);
+        report bench & " " & metric & " = " & integer'image(value) & " " & unit severity note;
+    end procedure;
+
+    procedure result(file_name, bench, metric : string; value : real; unit : string) is
+        file     f   : text open append_mode is file_name;
+        variable v_l : line;
+    begin
+        write(v_l, bench & "," & metric & "," & to_string(value, 3) & "," & unit);
+        writeline(f, v_l);
+        report bench & " " & metric & " = " & to_string(value, 3) & " " & unit severity note;
+    end procedure;
+
+end package body;
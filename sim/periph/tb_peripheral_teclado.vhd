@@ -0,0 +1,158 @@
+library ieee;
+use ieee.std_logic_1164.all;
+use ieee.numeric_std.all;
+
+library neorv32;
+use neorv32.neorv32_package.all;
+use neorv32.sim_periph_package.all;
+
+-- Benchmark of the keypad scanner: press and release latency of every key up to
+-- Key_o, with the press moved across the scan frame, and the ghost detection.
+
+entity tb_peripheral_teclado is
+  generic(
+    BENCH                : string  := "peripheral_teclado";
+    RESULTS              : string  := "bench.csv";
+    ROWS                 : integer := 4;
+    COLS                 : integer := 4;
+    SCAN_PRESCALER       : integer := 3000;
+    DEBOUNCE_FRAMES      : integer := 5;
+    BOUNCE_CYCLES        : integer := 0
+  );
+end entity;
+
+architecture tb_peripheral_teclado_sim of tb_peripheral_teclado is
+
+    constant keys_c  : natural := ROWS*COLS;
+    constant frame_c : natural := COLS*SCAN_PRESCALER;
+
+    -- Physical key (ROWS*column+row) to its One Hot slot, the rows of
+    -- column N are stored on slot N+1 (mod COLS)
+    function slot_f(key : natural) return natural is
+    begin
+        return ROWS*(((key / ROWS) + 1) mod COLS) + (key mod ROWS);
+    end function;
+
+    signal clk      : std_ulogic := '0';
+    signal reset    : std_ulogic := '1';
+    signal keys     : std_ulogic_vector(keys_c-1 downto 0) := (others => '0');
+    signal col      : std_logic_vector(COLS-1 downto 0);
+    signal row      : std_logic_vector(ROWS-1 downto 0);
+    signal key      : std_logic_vector(keys_c-1 downto 0);
+    signal valid    : std_logic;
+    signal index    : std_logic_vector(index_size_f(keys_c)-1 downto 0);
+    signal ghost    : std_logic;
+    signal done     : boolean := false;
+
+begin
+
+    clk <= not clk after t_clk_c/2 when not done;
+
+    keypad_model_0: entity neorv32.keypad_model
+    generic map (
+        ROWS          => ROWS,
+        COLS          => COLS,
+        BOUNCE_CYCLES => BOUNCE_CYCLES
+    )
+    port map (
+        clk_i  => clk,
+        keys_i => keys,
+        Col_i  => col,
+        Row_o  => row
+    );
+
+    peripheral_teclado_0: entity neorv32.peripheral_teclado
+    generic map (
+        ROWS            => ROWS,
+        COLS            => COLS,
+        SCAN_PRESCALER  => SCAN_PRESCALER,
+        DEBOUNCE_FRAMES => DEBOUNCE_FRAMES
+    )
+    port map (
+        clk_i       => clk,
+        reset_i     => reset,
+        en_i        => '1',
+        Row_i       => row,
+        Col_o       => col,
+        Key_o       => key,
+        Key_valid_o => valid,
+        Key_index_o => index,
+        Ghost_o     => ghost
+    );
+
+    tb_peripheral_teclado_stim: process
+        variable v_t0       : time;
+        variable v_lat      : natural;
+        variable v_ghost    : natural;
+        variable v_min_p, v_max_p, v_sum_p : natural;
+        variable v_min_r, v_max_r, v_sum_r : natural;
+        variable v_errors   : natural := 0;
+        variable v_slot     : natural;
+    begin
+        v_min_p := natural'high; v_max_p := 0; v_sum_p := 0;
+        v_min_r := natural'high; v_max_r := 0; v_sum_r := 0;
+
+        wait for 10*t_clk_c;
+        wait until rising_edge(clk);
+        reset <= '0';
+        wait for 2*frame_c*t_clk_c;
+
+        for k in 0 to keys_c-1 loop
+            -- Press at a different point of the scan frame each time
+            v_slot := slot_f(k);
+            for i in 1 to (k*7919) mod frame_c loop
+                wait until rising_edge(clk);
+            end loop;
+
+            keys(k) <= '1';
+            v_t0 := now;
+            wait until (key(v_slot) = '1') for 4*(DEBOUNCE_FRAMES+2)*frame_c*t_clk_c;
+            v_lat := cycles_f(v_t0, now);
+            if (key(v_slot) /= '1') or (valid /= '1') or
+               (to_integer(unsigned(index)) /= v_slot) then
+                v_errors := v_errors + 1;
+                report "key " & integer'image(k) & " not decoded" severity error;
+            end if;
+            v_min_p := minimum(v_min_p, v_lat); v_max_p := maximum(v_max_p, v_lat); v_sum_p := v_sum_p + v_lat;
+
+            wait for 3*frame_c*t_clk_c;
+            keys(k) <= '0';
+            v_t0 := now;
+            wait until (key(v_slot) = '0') for 4*(DEBOUNCE_FRAMES+2)*frame_c*t_clk_c;
+            v_lat := cycles_f(v_t0, now);
+            if (key /= (key'range => '0')) or (valid /= '0') then
+                v_errors := v_errors + 1;
+                report "key " & integer'image(k) & " not released" severity error;
+            end if;
+            v_min_r := minimum(v_min_r, v_lat); v_max_r := maximum(v_max_r, v_lat); v_sum_r := v_sum_r + v_lat;
+        end loop;
+
+        -- Three corners of a rectangle: the matrix also shorts the fourth one, the frame is discarded
+        keys(0) <= '1';
+        keys(1) <= '1';
+        keys(ROWS) <= '1';
+        v_t0 := now;
+        wait until (ghost = '1') for 3*frame_c*t_clk_c;
+        v_ghost := cycles_f(v_t0, now);
+        if (ghost /= '1') or (key /= (key'range => '0')) then
+            v_errors := v_errors + 1;
+            report "ghost frame not discarded" severity error;
+        end if;
+        keys <= (others => '0');
+        wait for 2*frame_c*t_clk_c;
+
+        result(RESULTS, BENCH, "press_to_key_min",   v_min_p, "cycles");
+        result(RESULTS, BENCH, "press_to_key_avg",   v_sum_p / keys_c, "cycles");
+        result(RESULTS, BENCH, "press_to_key_max",   v_max_p, "cycles");
+        result(RESULTS, BENCH, "press_to_key_avg_us", real(v_sum_p) / real(keys_c) * 1.0e6 / real(clk_hz_c), "us");
+        result(RESULTS, BENCH, "release_to_key_min", v_min_r, "cycles");
+        result(RESULTS, BENCH, "release_to_key_avg", v_sum_r / keys_c, "cycles");
+        result(RESULTS, BENCH, "release_to_key_max", v_max_r, "cycles");
+        result(RESULTS, BENCH, "ghost_flag_latency", v_ghost, "cycles");
+        result(RESULTS, BENCH, "errors",             v_errors, "count");
+
+        done <= true;
+        wait;
+    end process;
+
+end architecture;
@@ -0,0 +1,221 @@
+library ieee;
+use ieee.std_logic_1164.all;
+use ieee.numeric_std.all;
+
+library neorv32;
+use neorv32.sim_periph_package.all;
+
+-- Benchmark of the 7 segment display Wishbone slave: refresh rate after reset
+-- and with REG3 written, binary to BCD conversion, back to back transactions and,
+-- for the pipelined slave, bursts of one request per cycle.
+
+entity tb_wb_7SegmentDisplay is
+  generic(
+    BENCH                : string  := "wb_7SegmentDisplay";
+    RESULTS              : string  := "bench.csv";
+    PIPELINED            : boolean := false;
+    DIGITS               : integer := 2;
+    DIGIT_CYCLES         : integer := 3000;    -- Written to REG3 for the second refresh measure
+    BUS_ACCESSES         : integer := 1000
+  );
+end entity;
+
+architecture tb_wb_7SegmentDisplay_sim of tb_wb_7SegmentDisplay is
+
+    constant base_c    : unsigned(31 downto 0) := x"90000100";
+    constant bin_c     : integer := -12345;
+    constant refresh_c : integer := 65536;  -- REG3 after reset, REFRESH_PRESCALER of the display
+
+    function reg_f(n : natural) return std_ulogic_vector is
+    begin
+        return std_ulogic_vector(base_c + 4*n);
+    end function;
+
+    signal clk      : std_ulogic := '0';
+    signal reset    : std_ulogic := '1';
+    signal wb       : wb_master_t := wb_idle_c;
+    signal wb_dat   : std_ulogic_vector(31 downto 0);
+    signal wb_ack   : std_ulogic;
+    signal dig      : std_logic_vector(DIGITS-1 downto 0);
+    signal done     : boolean := false;
+
+begin
+
+    clk <= not clk after t_clk_c/2 when not done;
+
+    wb_7segmentDisplay_0: entity neorv32.wb_7segmentDisplay
+    generic map (
+        WB_ADDR_BASE => std_ulogic_vector(base_c),
+        DIGITS       => DIGITS,
+        WB_PIPELINED => PIPELINED
+    )
+    port map (
+        clk_i      => clk,
+        reset_i    => reset,
+        wb_tag_i   => (others => '0'),
+        wb_adr_i   => wb.adr,
+        wb_dat_i   => wb.dat,
+        wb_dat_o   => wb_dat,
+        wb_we_i    => wb.we,
+        wb_sel_i   => wb.sel,
+        wb_stb_i   => wb.stb,
+        wb_cyc_i   => wb.cyc,
+        wb_lock_i  => '0',
+        wb_ack_o   => wb_ack,
+        wb_err_o   => open,
+        wb_stall_o => open,
+        aa_o       => open,
+        ab_o       => open,
+        ac_o       => open,
+        ad_o       => open,
+        ae_o       => open,
+        af_o       => open,
+        ag_o       => open,
+        ds_o       => open,
+        dig_o      => dig
+    );
+
+    tb_wb_7SegmentDisplay_stim: process
+        variable v_t0       : time;
+        variable v_lat      : natural;
+        variable v_n        : natural;
+        variable v_data     : std_ulogic_vector(31 downto 0);
+        variable v_errors   : natural := 0;
+
+        procedure rd(n : natural) is
+        begin
+            wb_access(clk, wb, wb_ack, wb_dat, '0', reg_f(n), x"00000000", "1111", PIPELINED, v_data, v_n);
+        end procedure;
+
+        procedure wr(n : natural; data : std_ulogic_vector(31 downto 0)) is
+        begin
+            wb_access(clk, wb, wb_ack, wb_dat, '1', reg_f(n), data, "1111", PIPELINED, v_data, v_n);
+        end procedure;
+
+        -- Cycles between two turns of digit 0, the frame of the whole display
+        procedure frame(variable cycles : out natural) is
+            variable v_t : time;
+        begin
+            wait until rising_edge(dig(0));
+            v_t := now;
+            wait until rising_edge(dig(0));
+            cycles := cycles_f(v_t, now);
+        end procedure;
+    begin
+        wait for 10*t_clk_c;
+        wait until rising_edge(clk);
+        reset <= '0';
+
+        -------------------------------------------------------
+        -- Refresh rate                                      ---
+        -------------------------------------------------------
+        -- Nothing written yet, REG3 has to hold the reset value
+        frame(v_lat);
+        result(RESULTS, BENCH, "reset_frame_cycles", v_lat, "cycles");
+        result(RESULTS, BENCH, "reset_refresh_hz",   real(clk_hz_c) / real(v_lat), "Hz");
+        if (v_lat /= DIGITS*(refresh_c+1)) then
+            v_errors := v_errors + 1;
+            report "frame of " & integer'image(v_lat) & " cycles after reset, expected " &
+                   integer'image(DIGITS*(refresh_c+1)) severity error;
+        end if;
+        wait until rising_edge(clk);
+        rd(3);
+        if (unsigned(v_data) /= refresh_c) then
+            v_errors := v_errors + 1;
+            report "REG3 is 0x" & to_hstring(v_data) & " after reset" severity error;
+        end if;
+        wb_release(clk, wb);
+
+        wait until rising_edge(clk);
+        wr(3, std_ulogic_vector(to_unsigned(DIGIT_CYCLES-1, 32)));
+        wb_release(clk, wb);
+        frame(v_lat); -- The digit shown while REG3 was written can still use the old value
+        frame(v_lat);
+        result(RESULTS, BENCH, "frame_cycles", v_lat, "cycles");
+        result(RESULTS, BENCH, "refresh_hz",   real(clk_hz_c) / real(v_lat), "Hz");
+        if (v_lat /= DIGITS*DIGIT_CYCLES) then
+            v_errors := v_errors + 1;
+            report "frame of " & integer'image(v_lat) & " cycles, expected " &
+                   integer'image(DIGITS*DIGIT_CYCLES) severity error;
+        end if;
+
+        -------------------------------------------------------
+        -- Binary to BCD                                     ---
+        -------------------------------------------------------
+        wait until rising_edge(clk);
+        v_t0 := now;
+        wr(7, std_ulogic_vector(to_signed(bin_c, 32)));
+        loop
+            rd(8);
+            exit when (v_data(0) = '0') or (cycles_f(v_t0, now) > wb_tmo_c);
+        end loop;
+        v_lat := cycles_f(v_t0, now);
+        result(RESULTS, BENCH, "bcd_latency", v_lat, "cycles");
+        rd(9);
+        if (v_data /= x"00012345") then
+            v_errors := v_errors + 1;
+            report "BCD of " & integer'image(bin_c) & " is 0x" & to_hstring(v_data) severity error;
+        end if;
+        rd(8);
+        if (v_data(1) /= '1') then
+            v_errors := v_errors + 1;
+            report "BCD sign not set" severity error;
+        end if;
+        wb_release(clk, wb);
+
+        -------------------------------------------------------
+        -- Back to back transactions                         ---
+        -------------------------------------------------------
+        v_t0 := now;
+        for i in 1 to BUS_ACCESSES loop
+            rd(8);
+        end loop;
+        v_lat := cycles_f(v_t0, now);
+        result(RESULTS, BENCH, "read_cycles",  real(v_lat) / real(BUS_ACCESSES), "cycles");
+        result(RESULTS, BENCH, "read_tps",     real(BUS_ACCESSES) * real(clk_hz_c) / real(v_lat), "1/s");
+        wb_release(clk, wb);
+
+        v_t0 := now;
+        for i in 1 to BUS_ACCESSES loop
+            wr(4, std_ulogic_vector(to_unsigned(i, 32)));
+        end loop;
+        v_lat := cycles_f(v_t0, now);
+        result(RESULTS, BENCH, "write_cycles", real(v_lat) / real(BUS_ACCESSES), "cycles");
+        result(RESULTS, BENCH, "write_tps",    real(BUS_ACCESSES) * real(clk_hz_c) / real(v_lat), "1/s");
+        wb_release(clk, wb);
+
+        -- Pipelined bursts, a new request every cycle: BUS_ACCESSES+1 cycles in all
+        if PIPELINED then
+            wb_burst(clk, wb, wb_ack, wb_dat, '0', reg_f(8), x"00000000", BUS_ACCESSES, v_data, v_lat);
+            result(RESULTS, BENCH, "burst_read_cycles",  real(v_lat) / real(BUS_ACCESSES), "cycles");
+            result(RESULTS, BENCH, "burst_read_tps",     real(BUS_ACCESSES) * real(clk_hz_c) / real(v_lat), "1/s");
+            if (v_lat /= BUS_ACCESSES+1) then
+                v_errors := v_errors + 1;
+                report "read burst of " & integer'image(BUS_ACCESSES) & " in " & integer'image(v_lat) & " cycles" severity error;
+            end if;
+            wb_release(clk, wb);
+
+            wb_burst(clk, wb, wb_ack, wb_dat, '1', reg_f(4), x"00001000", BUS_ACCESSES, v_data, v_lat);
+            result(RESULTS, BENCH, "burst_write_cycles", real(v_lat) / real(BUS_ACCESSES), "cycles");
+            result(RESULTS, BENCH, "burst_write_tps",    real(BUS_ACCESSES) * real(clk_hz_c) / real(v_lat), "1/s");
+            if (v_lat /= BUS_ACCESSES+1) then
+                v_errors := v_errors + 1;
+                report "write burst of " & integer'image(BUS_ACCESSES) & " in " & integer'image(v_lat) & " cycles" severity error;
+            end if;
+            wb_release(clk, wb);
+
+            rd(4);
+            if (unsigned(v_data) /= 16#1000# + BUS_ACCESSES - 1) then
+                v_errors := v_errors + 1;
+                report "REG4 is 0x" & to_hstring(v_data) & " after the write burst" severity error;
+            end if;
+            wb_release(clk, wb);
+        end if;
+
+        result(RESULTS, BENCH, "errors", v_errors, "count");
+
+        done <= true;
+        wait;
+    end process;
+
+end architecture;
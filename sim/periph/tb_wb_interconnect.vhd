@@ -0,0 +1,240 @@
+library ieee;
+use ieee.std_logic_1164.all;
+use ieee.numeric_std.all;
+
+library neorv32;
+use neorv32.sim_periph_package.all;
+
+-- Benchmark of the Wishbone interconnect with the address map of Proyecto:
+-- back to back accesses that change slave every transaction, read data of the
+-- addressed slave only, one strobe per access (also with REGISTERED_RESP), an
+-- error answered by a slave and unmapped addresses terminated with err.
+-- The slaves are classic register files that ack in the same cycle, like the
+-- peripherals of rtl/periph with WB_PIPELINED = false.
+
+entity tb_wb_interconnect is
+  generic(
+    BENCH                : string  := "wb_interconnect";
+    RESULTS              : string  := "bench.csv";
+    REGISTERED_RESP      : boolean := false;
+    BUS_ACCESSES         : integer := 999    -- Multiple of the slaves, every one gets the same share
+  );
+end entity;
+
+architecture tb_wb_interconnect_sim of tb_wb_interconnect is
+
+    constant slaves_c   : natural := 3;
+    constant words_c    : natural := 8;   -- Registers of every slave, the 32 bytes of the smallest one
+    constant err_word_c : natural := 7;   -- Slave 2 answers err instead of ack here
+
+    type addr_t is array (0 to slaves_c-1) of unsigned(31 downto 0);
+    constant base_c     : addr_t := (x"90000000", x"90000100", x"90000300");   -- teclado, display, buttons
+    constant unmapped_c : addr_t := (x"90000200", x"90000320", x"8FFFFFFC");   -- gap, past buttons, below
+
+    -- Cycles from the request to ack/err, both included
+    function resp_cycles_f return natural is
+    begin
+        if REGISTERED_RESP then
+            return 2;
+        end if;
+        return 1;
+    end function;
+
+    constant resp_c     : natural := resp_cycles_f;
+
+    function addr_f(slave, word : natural) return std_ulogic_vector is
+    begin
+        return std_ulogic_vector(base_c(slave) + 4*word);
+    end function;
+
+    signal clk      : std_ulogic := '0';
+    signal reset    : std_ulogic := '1';
+    signal wb       : wb_master_t := wb_idle_c;
+    signal wb_dat   : std_ulogic_vector(31 downto 0);
+    signal wb_ack   : std_ulogic;
+    signal wb_err   : std_ulogic;
+    signal slv_stb  : std_ulogic_vector(slaves_c-1 downto 0);
+    signal slv_cyc  : std_ulogic_vector(slaves_c-1 downto 0);
+    signal slv_dat  : std_ulogic_vector(slaves_c*32-1 downto 0);
+    signal slv_ack  : std_ulogic_vector(slaves_c-1 downto 0);
+    signal slv_err  : std_ulogic_vector(slaves_c-1 downto 0);
+    signal strobes  : integer_vector(0 to slaves_c-1) := (others => 0);   -- Accesses seen by every slave
+    signal done     : boolean := false;
+
+begin
+
+    clk <= not clk after t_clk_c/2 when not done;
+
+    wb_interconnect_0: entity neorv32.wb_interconnect
+    generic map (
+        NUM_SLAVES      => slaves_c,
+        SLAVE_BASE      => std_ulogic_vector(base_c(2)) & std_ulogic_vector(base_c(1)) & std_ulogic_vector(base_c(0)),
+        SLAVE_SIZE      => x"00000020" & x"00000080" & x"00000100",
+        REGISTERED_RESP => REGISTERED_RESP
+    )
+    port map (
+        clk_i    => clk,
+        reset_i  => reset,
+        wb_adr_i => wb.adr,
+        wb_stb_i => wb.stb,
+        wb_cyc_i => wb.cyc,
+        wb_dat_o => wb_dat,
+        wb_ack_o => wb_ack,
+        wb_err_o => wb_err,
+        wb_stb_o => slv_stb,
+        wb_cyc_o => slv_cyc,
+        wb_dat_i => slv_dat,
+        wb_ack_i => slv_ack,
+        wb_err_i => slv_err
+    );
+
+    -- Register file slaves. The read data is driven all the time, whether the
+    -- slave is addressed or not, so a wrong response mux shows up in the data.
+    slaves: for i in 0 to slaves_c-1 generate
+        type regs_t is array (0 to words_c-1) of std_ulogic_vector(31 downto 0);
+        signal regs   : regs_t := (others => (others => '0'));
+        signal s_word : natural range 0 to words_c-1;
+        signal s_err  : std_ulogic;
+    begin
+        s_word <= to_integer(unsigned(wb.adr(4 downto 2)));
+        s_err  <= '1' when (i = 2) and (s_word = err_word_c) else '0';
+
+        slv_dat(32*i+31 downto 32*i) <= regs(s_word);
+        slv_ack(i) <= slv_stb(i) and slv_cyc(i) and not s_err;
+        slv_err(i) <= slv_stb(i) and slv_cyc(i) and s_err;
+
+        tb_wb_interconnect_slave: process(clk)
+        begin
+            if rising_edge(clk) then
+                if (slv_stb(i) = '1') and (slv_cyc(i) = '1') then
+                    strobes(i) <= strobes(i) + 1;
+                    if (wb.we = '1') and (s_err = '0') then
+                        regs(s_word) <= wb.dat;
+                    end if;
+                end if;
+            end if;
+        end process;
+    end generate;
+
+    tb_wb_interconnect_stim: process
+        variable v_t0       : time;
+        variable v_lat      : natural;
+        variable v_n        : natural;
+        variable v_max      : natural := 0;
+        variable v_last     : natural;
+        variable v_data     : std_ulogic_vector(31 downto 0);
+        variable v_ack      : std_ulogic;
+        variable v_err      : std_ulogic;
+        variable v_errors   : natural := 0;
+        variable v_strobes  : integer_vector(0 to slaves_c-1);
+
+        -- Classic access that also ends on err, the BFM of the package waits for ack only
+        procedure acc(we : std_ulogic; addr, data : std_ulogic_vector(31 downto 0)) is
+        begin
+            wb <= (cyc => '1', stb => '1', we => we, adr => addr, dat => data, sel => "1111");
+            v_n := 0;
+            loop
+                wait until rising_edge(clk);
+                v_n := v_n + 1;
+                exit when (wb_ack = '1') or (wb_err = '1');
+                assert (v_n < wb_tmo_c) report "no ack/err at 0x" & to_hstring(addr) severity failure;
+            end loop;
+            v_data := wb_dat;
+            v_ack  := wb_ack;
+            v_err  := wb_err;
+            wb     <= wb_idle_c;
+            if (v_n > v_max) then
+                v_max := v_n;
+            end if;
+        end procedure;
+
+        procedure check(cond : boolean; msg : string) is
+        begin
+            if not cond then
+                v_errors := v_errors + 1;
+                report msg severity error;
+            end if;
+        end procedure;
+
+        -- Data written by the back to back transaction i
+        function data_f(i : natural) return std_ulogic_vector is
+        begin
+            return std_ulogic_vector(to_unsigned(16#5A000000# + i, 32));
+        end function;
+    begin
+        wait for 10*t_clk_c;
+        wait until rising_edge(clk);
+        reset <= '0';
+        wait until rising_edge(clk);
+
+        -------------------------------------------------------
+        -- Back to back, a different slave every access      ---
+        -------------------------------------------------------
+        -- Writes first, one word of every slave per round, then the same
+        -- order of reads. err_word_c of slave 2 is left for later.
+        v_t0 := now;
+        for i in 0 to BUS_ACCESSES-1 loop
+            acc('1', addr_f(i mod slaves_c, (i / slaves_c) mod err_word_c), data_f(i));
+            check(v_ack = '1', "write " & integer'image(i) & " not acked");
+            check(v_n = resp_c, "write " & integer'image(i) & " in " & integer'image(v_n) & " cycles");
+        end loop;
+        v_lat := cycles_f(v_t0, now);
+        result(RESULTS, BENCH, "write_cycles", real(v_lat) / real(BUS_ACCESSES), "cycles");
+        result(RESULTS, BENCH, "write_tps",    real(BUS_ACCESSES) * real(clk_hz_c) / real(v_lat), "1/s");
+
+        v_t0 := now;
+        for i in 0 to BUS_ACCESSES-1 loop
+            acc('0', addr_f(i mod slaves_c, (i / slaves_c) mod err_word_c), x"00000000");
+            check(v_ack = '1', "read " & integer'image(i) & " not acked");
+            check(v_n = resp_c, "read " & integer'image(i) & " in " & integer'image(v_n) & " cycles");
+            -- The last write to the same slave and word
+            v_last := i + slaves_c*err_word_c*((BUS_ACCESSES-1-i) / (slaves_c*err_word_c));
+            check(v_data = data_f(v_last), "read " & integer'image(i) & " is 0x" & to_hstring(v_data) &
+                  ", expected 0x" & to_hstring(data_f(v_last)));
+        end loop;
+        v_lat := cycles_f(v_t0, now);
+        result(RESULTS, BENCH, "read_cycles",  real(v_lat) / real(BUS_ACCESSES), "cycles");
+        result(RESULTS, BENCH, "read_tps",     real(BUS_ACCESSES) * real(clk_hz_c) / real(v_lat), "1/s");
+        wb_release(clk, wb);
+
+        -- One strobe per access, REGISTERED_RESP must not repeat it
+        for i in 0 to slaves_c-1 loop
+            check(strobes(i) = 2*BUS_ACCESSES/slaves_c, "slave " & integer'image(i) & " saw " &
+                  integer'image(strobes(i)) & " strobes, expected " & integer'image(2*BUS_ACCESSES/slaves_c));
+        end loop;
+
+        -------------------------------------------------------
+        -- Errors                                            ---
+        -------------------------------------------------------
+        -- Answered by the slave
+        v_strobes := strobes;
+        acc('1', addr_f(2, err_word_c), x"FFFFFFFF");
+        check((v_err = '1') and (v_ack = '0'), "err of slave 2 not passed to the master");
+        check(v_n = resp_c, "slave err in " & integer'image(v_n) & " cycles");
+        acc('0', addr_f(0, 0), x"00000000");
+        check(v_ack = '1', "no ack after a slave err");
+        wb_release(clk, wb);
+        check(strobes(2) = v_strobes(2) + 1, "slave 2 saw the err access " & integer'image(strobes(2) - v_strobes(2)) & " times");
+
+        -- Unmapped: err from the interconnect, no slave strobed, the next access works
+        for i in 0 to slaves_c-1 loop
+            wb_release(clk, wb);
+            v_strobes := strobes;
+            acc('1', std_ulogic_vector(unmapped_c(i)), x"FFFFFFFF");
+            check((v_err = '1') and (v_ack = '0'), "no err at unmapped 0x" & to_hstring(unmapped_c(i)));
+            check(v_n = resp_c, "err at unmapped 0x" & to_hstring(unmapped_c(i)) & " in " & integer'image(v_n) & " cycles");
+            wait until rising_edge(clk);
+            check(strobes = v_strobes, "unmapped 0x" & to_hstring(unmapped_c(i)) & " strobed a slave");
+            acc('0', addr_f(i, 0), x"00000000");
+            check(v_ack = '1', "no ack after the unmapped 0x" & to_hstring(unmapped_c(i)));
+        end loop;
+        wb_release(clk, wb);
+
+        result(RESULTS, BENCH, "resp_max", v_max, "cycles");
+        result(RESULTS, BENCH, "errors",   v_errors, "count");
+
+        done <= true;
+        wait;
+    end process;
+
+end architecture;
@@ -0,0 +1,406 @@
+library ieee;
+use ieee.std_logic_1164.all;
+use ieee.numeric_std.all;
+
+library neorv32;
+use neorv32.sim_periph_package.all;
+
+-- Benchmark of the keypad Wishbone slave: key press to REG0 and to irq_o, two
+-- keys pressed in the same frame, a chord pressed key by key, compare command
+-- to REG4 (also with the bytes out of order), back to back bus transactions
+-- and pipelined bursts. The matrix size is a generic, make sizes runs it with
+-- other ROWS x COLS.
+
+entity tb_wb_peripheral_teclado is
+  generic(
+    BENCH                : string  := "wb_peripheral_teclado";
+    RESULTS              : string  := "bench.csv";
+    PIPELINED            : boolean := false;
+    ROWS                 : integer := 4;
+    COLS                 : integer := 4;
+    SCAN_PRESCALER       : integer := 3000;
+    KEYS_TESTED          : integer := 16;    -- Wraps around ROWS*COLS
+    BUS_ACCESSES         : integer := 1000
+  );
+end entity;
+
+architecture tb_wb_peripheral_teclado_sim of tb_wb_peripheral_teclado is
+
+    constant keys_c  : natural := ROWS*COLS;
+    constant frame_c : natural := COLS*SCAN_PRESCALER;
+    constant quiet_c : natural := 8*frame_c;   -- Release debounce (5 frames) and margin
+    constant base_c  : unsigned(31 downto 0) := x"90000000";
+    constant pass_c  : std_ulogic_vector(31 downto 0) := x"75123456";
+
+    -- Keymap after reset, the codes of the lock firmware
+    type keymap_t is array (0 to 3) of std_ulogic_vector(31 downto 0);
+    constant keymap_c : keymap_t := (x"01040700", x"41424344", x"03060945", x"02050846");
+
+    -- More than 16 keys need the keymap registers from REG32 on
+    function addr_size_f return natural is
+    begin
+        if (keys_c > 16) then
+            return 256;
+        end if;
+        return 128;
+    end function;
+
+    function reg_f(n : natural) return std_ulogic_vector is
+    begin
+        return std_ulogic_vector(base_c + 4*n);
+    end function;
+
+    function slot_f(key : natural) return natural is
+    begin
+        return ROWS*(((key / ROWS) + 1) mod COLS) + (key mod ROWS);
+    end function;
+
+    signal clk      : std_ulogic := '0';
+    signal reset    : std_ulogic := '1';
+    signal keys     : std_ulogic_vector(keys_c-1 downto 0) := (others => '0');
+    signal col      : std_logic_vector(COLS-1 downto 0);
+    signal row      : std_logic_vector(ROWS-1 downto 0);
+    signal wb       : wb_master_t := wb_idle_c;
+    signal wb_dat   : std_ulogic_vector(31 downto 0);
+    signal wb_ack   : std_ulogic;
+    signal irq      : std_ulogic;
+    signal t_irq    : time := 0 ns;
+    signal done     : boolean := false;
+
+begin
+
+    clk <= not clk after t_clk_c/2 when not done;
+
+    keypad_model_0: entity neorv32.keypad_model
+    generic map (
+        ROWS          => ROWS,
+        COLS          => COLS
+    )
+    port map (
+        clk_i  => clk,
+        keys_i => keys,
+        Col_i  => col,
+        Row_o  => row
+    );
+
+    wb_peripheral_teclado_0: entity neorv32.wb_peripheral_teclado
+    generic map (
+        WB_ADDR_BASE   => std_ulogic_vector(base_c),
+        WB_ADDR_SIZE   => addr_size_f,
+        ROWS           => ROWS,
+        COLS           => COLS,
+        SCAN_PRESCALER => SCAN_PRESCALER,
+        WB_PIPELINED   => PIPELINED
+    )
+    port map (
+        clk_i      => clk,
+        reset_i    => reset,
+        wb_tag_i   => (others => '0'),
+        wb_adr_i   => wb.adr,
+        wb_dat_i   => wb.dat,
+        wb_dat_o   => wb_dat,
+        wb_we_i    => wb.we,
+        wb_sel_i   => wb.sel,
+        wb_stb_i   => wb.stb,
+        wb_cyc_i   => wb.cyc,
+        wb_lock_i  => '0',
+        wb_ack_o   => wb_ack,
+        wb_err_o   => open,
+        wb_stall_o => open,
+        irq_o      => irq,
+        en_i       => '1',
+        Row_i      => std_ulogic_vector(row),
+        Col_o      => col,
+        Lock_active_o => open,
+        Lock_led_o    => open,
+        Lock_open_o   => open,
+        Lock_text_o   => open
+    );
+
+    -- Last edge with the interrupt request high
+    tb_wb_peripheral_teclado_irq: process(clk)
+    begin
+        if rising_edge(clk) then
+            if (irq = '1') then
+                t_irq <= now;
+            end if;
+        end if;
+    end process;
+
+    tb_wb_peripheral_teclado_stim: process
+        variable v_t0       : time;
+        variable v_lat      : natural;
+        variable v_n        : natural;
+        variable v_data     : std_ulogic_vector(31 downto 0);
+        variable v_min, v_max, v_sum : natural;
+        variable v_min_i, v_max_i, v_sum_i : natural;
+        variable v_cmp_max  : natural;
+        variable v_errors   : natural := 0;
+        variable v_slot     : natural;
+        variable v_sel      : std_ulogic_vector(3 downto 0);
+
+        procedure rd(n : natural) is
+        begin
+            wb_access(clk, wb, wb_ack, wb_dat, '0', reg_f(n), x"00000000", "1111", PIPELINED, v_data, v_n);
+        end procedure;
+
+        procedure wr(n : natural; data : std_ulogic_vector(31 downto 0)) is
+        begin
+            wb_access(clk, wb, wb_ack, wb_dat, '1', reg_f(n), data, "1111", PIPELINED, v_data, v_n);
+        end procedure;
+    begin
+        v_min   := natural'high; v_max   := 0; v_sum   := 0;
+        v_min_i := natural'high; v_max_i := 0; v_sum_i := 0;
+
+        wait for 10*t_clk_c;
+        wait until rising_edge(clk);
+        reset <= '0';
+        wait for 2*frame_c*t_clk_c;
+        wait until rising_edge(clk);
+
+        -------------------------------------------------------
+        -- Reset values, before any write of the firmware    ---
+        -------------------------------------------------------
+        rd(8);
+        if (v_data /= x"00000005") then
+            v_errors := v_errors + 1;
+            report "REG8 settle time is 0x" & to_hstring(v_data) & " after reset" severity error;
+        end if;
+        for i in 0 to 3 loop
+            rd(14+i);
+            if (v_data /= keymap_c(i)) then
+                v_errors := v_errors + 1;
+                report "REG" & integer'image(14+i) & " keymap is 0x" & to_hstring(v_data) & " after reset" severity error;
+            end if;
+        end loop;
+
+        wr(5, x"00000001"); -- Key pressed interrupt
+
+        -------------------------------------------------------
+        -- Key press to REG0 and irq_o                       ---
+        -------------------------------------------------------
+        -- Keys 32-63 are on REG26
+        for k in 0 to KEYS_TESTED-1 loop
+            v_slot := slot_f(k mod keys_c);
+            for i in 1 to (k*7919) mod frame_c loop
+                wait until rising_edge(clk);
+            end loop;
+
+            keys(k mod keys_c) <= '1';
+            v_t0 := now;
+            loop
+                if (v_slot < 32) then
+                    rd(0);
+                else
+                    rd(26);
+                end if;
+                exit when (v_data(v_slot mod 32) = '1') or (cycles_f(v_t0, now) > 16*frame_c);
+            end loop;
+            v_lat := cycles_f(v_t0, now);
+            if (v_data(v_slot mod 32) /= '1') or (t_irq < v_t0) then
+                v_errors := v_errors + 1;
+                report "key " & integer'image(k) & " not seen on the bus" severity error;
+            else
+                v_min   := minimum(v_min, v_lat);   v_max   := maximum(v_max, v_lat);   v_sum   := v_sum + v_lat;
+                v_lat   := cycles_f(v_t0, t_irq);
+                v_min_i := minimum(v_min_i, v_lat); v_max_i := maximum(v_max_i, v_lat); v_sum_i := v_sum_i + v_lat;
+            end if;
+            -- Index of the event, as wide as the biggest matrix
+            rd(6);
+            if (v_data(31) /= '1') or (to_integer(unsigned(v_data(29 downto 24))) /= v_slot) then
+                v_errors := v_errors + 1;
+                report "event of key " & integer'image(k) & " is 0x" & to_hstring(v_data) severity error;
+            end if;
+            wr(5, x"00000101"); -- Clear the pending bit
+
+            keys <= (others => '0');
+            wb_release(clk, wb);
+            wait for quiet_c*t_clk_c;
+            wait until rising_edge(clk);
+        end loop;
+
+        -------------------------------------------------------
+        -- Two keys in the same frame, both in the fifo      ---
+        -------------------------------------------------------
+        wr(7, x"00010001"); -- Flush, clear the overflow
+        keys(0) <= '1';
+        keys(keys_c-1) <= '1';
+        wait for 8*frame_c*t_clk_c;
+        wait until rising_edge(clk);
+        rd(7);
+        if (v_data(7 downto 0) /= x"02") or (v_data(16) /= '0') then
+            v_errors := v_errors + 1;
+            report "two keys pressed at once left REG7 = 0x" & to_hstring(v_data) severity error;
+        end if;
+        -- Highest index first
+        rd(6);
+        if (v_data(31) /= '1') or (to_integer(unsigned(v_data(29 downto 24))) /= maximum(slot_f(0), slot_f(keys_c-1))) then
+            v_errors := v_errors + 1;
+            report "first key of the pair is 0x" & to_hstring(v_data) severity error;
+        end if;
+        rd(6);
+        if (v_data(31) /= '1') or (to_integer(unsigned(v_data(29 downto 24))) /= minimum(slot_f(0), slot_f(keys_c-1))) then
+            v_errors := v_errors + 1;
+            report "second key of the pair is 0x" & to_hstring(v_data) severity error;
+        end if;
+        keys <= (others => '0');
+        wb_release(clk, wb);
+        wait for quiet_c*t_clk_c;
+        wait until rising_edge(clk);
+
+        -------------------------------------------------------
+        -- Chord with its keys 20 frames apart               ---
+        -------------------------------------------------------
+        -- The first key waits for the second one, only the chord is stored.
+        -- Two rows of the first column, inside the 16 keys of a chord mask
+        v_data := (others => '0');
+        v_data(slot_f(0)) := '1';
+        v_data(slot_f(1)) := '1';
+        wr(18, x"8047" & v_data(15 downto 0));
+        keys(0) <= '1';
+        wait for 20*frame_c*t_clk_c;
+        keys(1) <= '1';
+        wait for 8*frame_c*t_clk_c;
+        keys <= (others => '0');
+        wait for quiet_c*t_clk_c;
+        wait until rising_edge(clk);
+        rd(7);
+        if (v_data(7 downto 0) /= x"01") then
+            v_errors := v_errors + 1;
+            report "chord pressed key by key left " & integer'image(to_integer(unsigned(v_data(7 downto 0)))) &
+                   " fifo entries" severity error;
+        end if;
+        rd(6);
+        if (v_data(31 downto 30) /= "11") or (v_data(23 downto 16) /= x"47") then
+            v_errors := v_errors + 1;
+            report "chord pressed key by key read as 0x" & to_hstring(v_data) severity error;
+        end if;
+        wr(18, x"00000000");
+        wb_release(clk, wb);
+
+        -------------------------------------------------------
+        -- Compare command to REG4                           ---
+        -------------------------------------------------------
+        -- A/B/C/D as byte stores on REG29, as the firmware does
+        wr(3, pass_c);
+        v_cmp_max := 0;
+        for i in 0 to 3 loop
+            v_sel := (others => '0');
+            v_sel(i) := '1';
+            v_t0 := now;
+            wb_access(clk, wb, wb_ack, wb_dat, '1', std_ulogic_vector(unsigned(reg_f(29)) + i),
+                      pass_c(8*i+7 downto 8*i) & pass_c(8*i+7 downto 8*i) &
+                      pass_c(8*i+7 downto 8*i) & pass_c(8*i+7 downto 8*i),
+                      v_sel, PIPELINED, v_data, v_n);
+            loop
+                rd(4);
+                exit when (v_data(8) = '1') or (cycles_f(v_t0, now) > wb_tmo_c);
+            end loop;
+            v_lat := cycles_f(v_t0, now);
+            v_cmp_max := maximum(v_cmp_max, v_lat);
+            if (v_data(8) /= '1') or (v_data(9) /= '1') or (v_data(i) /= '1') then
+                v_errors := v_errors + 1;
+                report "compare of byte " & integer'image(i) & " failed" severity error;
+            end if;
+        end loop;
+        wb_release(clk, wb);
+
+        -- Out of order, C before A: the command bits stay in REG2, the compare
+        -- of A also sees C and both result bits have to be set
+        reset <= '1';
+        wait for 4*t_clk_c;
+        wait until rising_edge(clk);
+        reset <= '0';
+        wait until rising_edge(clk);
+        wr(3, pass_c);
+        for i in 2 downto 0 loop
+            next when (i = 1);
+            v_sel := (others => '0');
+            v_sel(i) := '1';
+            wb_access(clk, wb, wb_ack, wb_dat, '1', std_ulogic_vector(unsigned(reg_f(29)) + i),
+                      pass_c(8*i+7 downto 8*i) & pass_c(8*i+7 downto 8*i) &
+                      pass_c(8*i+7 downto 8*i) & pass_c(8*i+7 downto 8*i),
+                      v_sel, PIPELINED, v_data, v_n);
+            wb_release(clk, wb);
+            wait until rising_edge(clk);
+        end loop;
+        rd(4);
+        if (v_data(3 downto 0) /= "0101") or (v_data(9) /= '1') then
+            v_errors := v_errors + 1;
+            report "compare of C then A left REG4 = 0x" & to_hstring(v_data) severity error;
+        end if;
+        wb_release(clk, wb);
+
+        -------------------------------------------------------
+        -- Back to back transactions                         ---
+        -------------------------------------------------------
+        v_t0 := now;
+        for i in 1 to BUS_ACCESSES loop
+            rd(0);
+        end loop;
+        v_lat := cycles_f(v_t0, now);
+        result(RESULTS, BENCH, "read_cycles",  real(v_lat) / real(BUS_ACCESSES), "cycles");
+        result(RESULTS, BENCH, "read_tps",     real(BUS_ACCESSES) * real(clk_hz_c) / real(v_lat), "1/s");
+        wb_release(clk, wb);
+
+        v_t0 := now;
+        for i in 1 to BUS_ACCESSES loop
+            wr(1, std_ulogic_vector(to_unsigned(i, 32)));
+        end loop;
+        v_lat := cycles_f(v_t0, now);
+        result(RESULTS, BENCH, "write_cycles", real(v_lat) / real(BUS_ACCESSES), "cycles");
+        result(RESULTS, BENCH, "write_tps",    real(BUS_ACCESSES) * real(clk_hz_c) / real(v_lat), "1/s");
+        wb_release(clk, wb);
+
+        rd(1);
+        if (v_data /= std_ulogic_vector(to_unsigned(BUS_ACCESSES, 32))) then
+            v_errors := v_errors + 1;
+            report "REG1 does not hold the last write" severity error;
+        end if;
+        wb_release(clk, wb);
+
+        -- Pipelined bursts, a new request every cycle: BUS_ACCESSES+1 cycles in all
+        if PIPELINED then
+            wb_burst(clk, wb, wb_ack, wb_dat, '0', reg_f(0), x"00000000", BUS_ACCESSES, v_data, v_lat);
+            result(RESULTS, BENCH, "burst_read_cycles",  real(v_lat) / real(BUS_ACCESSES), "cycles");
+            result(RESULTS, BENCH, "burst_read_tps",     real(BUS_ACCESSES) * real(clk_hz_c) / real(v_lat), "1/s");
+            if (v_lat /= BUS_ACCESSES+1) then
+                v_errors := v_errors + 1;
+                report "read burst of " & integer'image(BUS_ACCESSES) & " in " & integer'image(v_lat) & " cycles" severity error;
+            end if;
+            wb_release(clk, wb);
+
+            wb_burst(clk, wb, wb_ack, wb_dat, '1', reg_f(1), x"00001000", BUS_ACCESSES, v_data, v_lat);
+            result(RESULTS, BENCH, "burst_write_cycles", real(v_lat) / real(BUS_ACCESSES), "cycles");
+            result(RESULTS, BENCH, "burst_write_tps",    real(BUS_ACCESSES) * real(clk_hz_c) / real(v_lat), "1/s");
+            if (v_lat /= BUS_ACCESSES+1) then
+                v_errors := v_errors + 1;
+                report "write burst of " & integer'image(BUS_ACCESSES) & " in " & integer'image(v_lat) & " cycles" severity error;
+            end if;
+            wb_release(clk, wb);
+
+            rd(1);
+            if (unsigned(v_data) /= 16#1000# + BUS_ACCESSES - 1) then
+                v_errors := v_errors + 1;
+                report "REG1 is 0x" & to_hstring(v_data) & " after the write burst" severity error;
+            end if;
+            wb_release(clk, wb);
+        end if;
+
+        if (v_sum = 0) then
+            v_min := 0; v_min_i := 0;
+        end if;
+        result(RESULTS, BENCH, "key_to_reg0_min", v_min, "cycles");
+        result(RESULTS, BENCH, "key_to_reg0_avg", v_sum / KEYS_TESTED, "cycles");
+        result(RESULTS, BENCH, "key_to_reg0_max", v_max, "cycles");
+        result(RESULTS, BENCH, "key_to_irq_min",  v_min_i, "cycles");
+        result(RESULTS, BENCH, "key_to_irq_avg",  v_sum_i / KEYS_TESTED, "cycles");
+        result(RESULTS, BENCH, "key_to_irq_max",  v_max_i, "cycles");
+        result(RESULTS, BENCH, "compare_to_reg4", v_cmp_max, "cycles");
+        result(RESULTS, BENCH, "errors",          v_errors, "count");
+
+        done <= true;
+        wait;
+    end process;
+
+end architecture;
@@ -0,0 +1,540 @@
+library ieee;
+use ieee.std_logic_1164.all;
+use ieee.numeric_std.all;
+
+library std;
+use std.textio.all;
+
+library neorv32;
+use neorv32.sim_periph_package.all;
+
+-- Co-simulation of the whole board: the Proyecto firmware image runs on the
+-- iCEBreaker top, the keypad model plays a scenario file on PMOD1B and the
+-- UART TX line, the LEDs and the 7 segment display are decoded into a log.
+--
+-- Scenario file, one line per key press, '#' starts a comment:
+--   <delay_ms> <keys> <hold_ms> [<output> <metric> [<max_ms> [<expect>]]]
+-- delay_ms counts from the release of the previous line, or from the reaction
+-- it waited for. keys are 0-9 A-F, several characters are a chord (EF) and '-'
+-- only waits. With an output (led_left, led_right, led_up, led_down,
+-- led_center, uart, display) the bench waits for its next event and writes the
+-- time since the press as <metric>, a '-' line takes the last key pressed;
+-- above max_ms (0 = no limit) it is an error. expect is the text the event
+-- has to show: the start of the UART line ('_' for a blank) or the two
+-- characters of the display.
+--
+-- Keypad interrupt: from the irq_o pulse of the keypad to the first store of
+-- Teclado_irq_handler() to REG5 on the Wishbone bus, wake-up, trap entry and
+-- RTE/XIRQ dispatch included. min/avg/max go to the results, no store within
+-- IRQ_MAX_CYCLES is an error.
+--
+-- Self-checking: 1 ms after the reset button is released the keypad columns,
+-- the LEDs and the display have to be driven (power-on reset of the
+-- peripherals). Every missing event, late event, wrong text or bad line of
+-- the scenario counts in the "errors" metric, make sim fails if it is not 0.
+
+entity tb_soc_proyecto is
+  generic(
+    BENCH                : string  := "soc_proyecto";
+    RESULTS              : string  := "bench.csv";
+    SCENARIO             : string  := "proyecto.scn";
+    LOG_FILE             : string  := "soc.log";
+    UART_BAUD            : integer := 115200;  -- BAUD_RATE of the firmware
+    BOUNCE_CYCLES        : integer := 0;
+    TIMEOUT_MS           : integer := 10000;   -- Longest wait for an output event
+    IRQ_MAX_CYCLES       : integer := 12000    -- Keypad XIRQ to handler budget, 1 ms
+  );
+end entity;
+
+architecture tb_soc_proyecto_sim of tb_soc_proyecto is
+
+    -- Keys of the firmware KeyValue[] table, in One Hot slot order
+    constant keymap_c : string(1 to 16) := "0741DCBAE963F852";
+
+    -- Physical key (ROWS*column+row) of a keypad character, 16 if unknown.
+    -- The rows of column N are stored on slot N+1 (mod 4).
+    function key_f(c : character) return natural is
+    begin
+        for s in 0 to 15 loop
+            if (keymap_c(s+1) = c) then
+                return 4*(((s / 4) + 3) mod 4) + (s mod 4);
+            end if;
+        end loop;
+        return 16;
+    end function;
+
+    -- Character shown by a digit, segment a on bit 0 ... g on bit 6
+    function seg_char_f(seg : std_logic_vector(6 downto 0)) return character is
+    begin
+        case to_integer(unsigned(seg)) is
+            when 16#3F# => return '0';
+            when 16#06# => return '1';
+            when 16#5B# => return '2';
+            when 16#4F# => return '3';
+            when 16#66# => return '4';
+            when 16#6D# => return '5';
+            when 16#7D# => return '6';
+            when 16#07# => return '7';
+            when 16#7F# => return '8';
+            when 16#6F# => return '9';
+            when 16#77# => return 'A';
+            when 16#7C# => return 'b';
+            when 16#39# => return 'C';
+            when 16#58# => return 'c';
+            when 16#5E# => return 'd';
+            when 16#79# => return 'E';
+            when 16#71# => return 'F';
+            when 16#3D# => return 'G';
+            when 16#76# => return 'H';
+            when 16#74# => return 'h';
+            when 16#30# => return 'I';
+            when 16#10# => return 'i';
+            when 16#1E# => return 'J';
+            when 16#38# => return 'L';
+            when 16#54# => return 'n';
+            when 16#5C# => return 'o';
+            when 16#73# => return 'P';
+            when 16#67# => return 'q';
+            when 16#50# => return 'r';
+            when 16#78# => return 't';
+            when 16#3E# => return 'U';
+            when 16#1C# => return 'u';
+            when 16#6E# => return 'y';
+            when 16#40# => return '-';
+            when 16#08# => return '_';
+            when 16#48# => return '=';
+            when 16#49# => return '#';  -- Overflow of the BCD number
+            when 16#00# => return ' ';
+            when others => return '?';
+        end case;
+    end function;
+
+    file log_f : text open write_mode is LOG_FILE;
+
+    -- One line of the log with the simulation time in ms
+    procedure log(msg : string) is
+        variable v_l : line;
+    begin
+        write(v_l, to_string(real(now / 1 us) / 1000.0, 3) & " ms  " & msg);
+        writeline(log_f, v_l);
+    end procedure;
+
+    signal clk      : std_logic := '0';
+    signal rstn     : std_logic := '0';
+    signal keys     : std_ulogic_vector(15 downto 0) := (others => '0');
+    signal col      : std_logic_vector(3 downto 0);
+    signal row      : std_logic_vector(3 downto 0);
+    signal tx       : std_logic;
+    signal led      : std_logic_vector(4 downto 0);  -- center, down, up, right, left
+    signal seg      : std_logic_vector(6 downto 0);  -- g ... a
+    signal ds       : std_logic;
+    signal done     : boolean := false;
+
+    -- Time of the last event of every output
+    signal t_led    : time_vector(0 to 4) := (others => 0 ns);  -- Rising edge of each LED
+    signal t_uart   : time := 0 ns;                             -- End of a UART line
+    signal t_disp   : time := 0 ns;                             -- New text on the display
+
+    -- Text of the last event
+    signal s_uart_text : string(1 to 80) := (others => ' ');
+    signal s_uart_len  : natural := 0;
+    signal s_disp_text : string(1 to 2) := "  ";
+
+    -- Keypad XIRQ to handler, in clock cycles
+    signal irq_n    : natural := 0;
+    signal irq_min  : natural := natural'high;
+    signal irq_max  : natural := 0;
+    signal irq_sum  : natural := 0;
+    signal irq_late : natural := 0;
+
+begin
+
+    clk <= not clk after t_clk_c/2 when not done;
+
+    keypad_model_0: entity neorv32.keypad_model
+    generic map (
+        ROWS          => 4,
+        COLS          => 4,
+        BOUNCE_CYCLES => BOUNCE_CYCLES
+    )
+    port map (
+        clk_i  => clk,
+        keys_i => keys,
+        Col_i  => col,
+        Row_o  => row
+    );
+
+    neorv32_iCEBreaker_BoardTop_0: entity neorv32.neorv32_iCEBreaker_BoardTop_MinimalBoot
+    generic map (
+        INT_BOOTLOADER_EN => false
+    )
+    port map (
+        iCEBreakerv10_CLK                => clk,
+        iCEBreakerv10_RX                 => '1',
+        iCEBreakerv10_TX                 => tx,
+        iCEBreakerv10_BTN_N              => rstn,
+        iCEBreakerv10_PMOD2_9_Button_1   => '0',
+        iCEBreakerv10_PMOD2_4_Button_2   => '0',
+        iCEBreakerv10_PMOD2_10_Button_3  => '0',
+        iCEBreakerv10_LED_R_N            => open,
+        iCEBreakerv10_LED_G_N            => open,
+        iCEBreakerv10_PMOD2_1_LED_left   => led(0),
+        iCEBreakerv10_PMOD2_2_LED_right  => led(1),
+        iCEBreakerv10_PMOD2_8_LED_up     => led(2),
+        iCEBreakerv10_PMOD2_3_LED_down   => led(3),
+        iCEBreakerv10_PMOD2_7_LED_center => led(4),
+        iCEBreakerv10_PMOD1B_1           => col(0),
+        iCEBreakerv10_PMOD1B_2           => col(1),
+        iCEBreakerv10_PMOD1B_3           => col(2),
+        iCEBreakerv10_PMOD1B_4           => col(3),
+        iCEBreakerv10_PMOD1B_7           => row(0),
+        iCEBreakerv10_PMOD1B_8           => row(1),
+        iCEBreakerv10_PMOD1B_9           => row(2),
+        iCEBreakerv10_PMOD1B_10          => row(3),
+        iCEBreakerv10_PMOD1A_1           => seg(3),  -- d
+        iCEBreakerv10_PMOD1A_2           => seg(4),  -- e
+        iCEBreakerv10_PMOD1A_3           => seg(5),  -- f
+        iCEBreakerv10_PMOD1A_4           => seg(0),  -- a
+        iCEBreakerv10_PMOD1A_7           => seg(1),  -- b
+        iCEBreakerv10_PMOD1A_8           => seg(2),  -- c
+        iCEBreakerv10_PMOD1A_9           => seg(6),  -- g
+        iCEBreakerv10_PMOD1A_10          => ds
+    );
+
+    -------------------------------------------------------
+    -- Keypad interrupt latency                          ---
+    -------------------------------------------------------
+    -- irq_o of the keypad is a one cycle pulse latched by the XIRQ controller.
+    -- The handler entry shows up on the bus as its first store to REG5 of the
+    -- keypad (clear of the pending flags), taken at the edge that samples stb.
+    tb_soc_proyecto_irq: process(clk)
+        alias irq_keypad is << signal .tb_soc_proyecto.neorv32_iCEBreaker_BoardTop_0.irq_keypad_s : std_ulogic >>;
+        alias wb_adr     is << signal .tb_soc_proyecto.neorv32_iCEBreaker_BoardTop_0.wb_adr_m2s : std_ulogic_vector(31 downto 0) >>;
+        alias wb_we      is << signal .tb_soc_proyecto.neorv32_iCEBreaker_BoardTop_0.wb_we_m2s : std_ulogic >>;
+        alias wb_stb     is << signal .tb_soc_proyecto.neorv32_iCEBreaker_BoardTop_0.wb_stb_m2s : std_ulogic >>;
+        alias wb_cyc     is << signal .tb_soc_proyecto.neorv32_iCEBreaker_BoardTop_0.wb_cyc_m2s : std_ulogic >>;
+        constant reg5_c  : std_ulogic_vector(31 downto 0) := x"90000014";
+        variable v_wait  : boolean := false;
+        variable v_t0    : time;
+        variable v_lat   : natural;
+    begin
+        if rising_edge(clk) then
+            if v_wait then
+                v_lat := cycles_f(v_t0, now);
+                if (wb_cyc = '1') and (wb_stb = '1') and (wb_we = '1') and (wb_adr = reg5_c) then
+                    v_wait  := false;
+                    irq_n   <= irq_n + 1;
+                    irq_min <= minimum(irq_min, v_lat);
+                    irq_max <= maximum(irq_max, v_lat);
+                    irq_sum <= irq_sum + v_lat;
+                elsif (v_lat > IRQ_MAX_CYCLES) then
+                    v_wait   := false;
+                    irq_late <= irq_late + 1;
+                    log("IRQ keypad not served in " & integer'image(IRQ_MAX_CYCLES) & " cycles");
+                end if;
+            end if;
+            -- A pulse while the previous one is not served yet is taken by the same handler call
+            if (irq_keypad = '1') and not v_wait then
+                v_wait := true;
+                v_t0   := now;
+            end if;
+        end if;
+    end process;
+
+    -------------------------------------------------------
+    -- UART TX, 8N1                                      ---
+    -------------------------------------------------------
+    tb_soc_proyecto_uart: process
+        constant bit_c  : time := 1 sec / UART_BAUD;
+        variable v_byte : std_logic_vector(7 downto 0);
+        variable v_text : line;
+        variable v_str  : string(1 to 80);
+        variable v_len  : natural;
+    begin
+        wait until falling_edge(tx);
+        wait for bit_c + bit_c/2;
+        for i in 0 to 7 loop
+            v_byte(i) := tx;
+            wait for bit_c;
+        end loop;
+        if (tx /= '1') then
+            log("UART framing error");
+        end if;
+
+        case character'val(to_integer(unsigned(v_byte))) is
+            when LF =>
+                if (v_text /= null) and (v_text'length > 0) then
+                    log("UART " & v_text.all);
+                    v_len := minimum(v_text'length, s_uart_text'length);
+                    v_str := (others => ' ');
+                    v_str(1 to v_len) := v_text(v_text'left to v_text'left + v_len - 1);
+                    s_uart_text <= v_str;
+                    s_uart_len  <= v_len;
+                    t_uart <= now;
+                end if;
+                deallocate(v_text);
+            when CR =>
+                null;
+            when others =>
+                write(v_text, character'val(to_integer(unsigned(v_byte))));
+        end case;
+    end process;
+
+    -------------------------------------------------------
+    -- LEDs and display                                  ---
+    -------------------------------------------------------
+    tb_soc_proyecto_leds: process(clk)
+        variable v_led : std_logic_vector(4 downto 0) := (others => '0');
+    begin
+        if rising_edge(clk) then
+            if (led /= v_led) then
+                for i in 0 to 4 loop
+                    if (led(i) = '1') and (v_led(i) = '0') then
+                        t_led(i) <= now;
+                    end if;
+                end loop;
+                log("LED " & to_string(led));
+                v_led := led;
+            end if;
+        end if;
+    end process;
+
+    -- A digit is decoded when ds_o moves to the other one, the text is
+    -- logged once both digits were shown
+    tb_soc_proyecto_display: process(clk)
+        variable v_ds    : std_logic := '0';
+        variable v_seg   : std_logic_vector(6 downto 0) := (others => '0');
+        variable v_text  : string(1 to 2) := "  ";
+        variable v_shown : string(1 to 2) := "  ";
+        variable v_new   : std_logic_vector(1 downto 0) := "00";
+    begin
+        if rising_edge(clk) then
+            if (ds /= v_ds) then
+                if (v_ds = '1') then
+                    v_text(2) := seg_char_f(v_seg);
+                    v_new(1)  := '1';
+                else
+                    v_text(1) := seg_char_f(v_seg);
+                    v_new(0)  := '1';
+                end if;
+                if (v_new = "11") then
+                    v_new := "00";
+                    if (v_text /= v_shown) then
+                        v_shown := v_text;
+                        s_disp_text <= v_text;
+                        t_disp  <= now;
+                        log("DISPLAY """ & v_text & """");
+                    end if;
+                end if;
+                v_ds := ds;
+            end if;
+            v_seg := seg;
+        end if;
+    end process;
+
+    -------------------------------------------------------
+    -- Scenario                                          ---
+    -------------------------------------------------------
+    tb_soc_proyecto_stim: process
+        file     scn      : text open read_mode is SCENARIO;
+        variable v_l      : line;
+        variable v_tok    : string(1 to 32);
+        variable v_n      : natural;
+        variable v_delay  : natural;
+        variable v_hold   : natural;
+        variable v_max    : natural;
+        variable v_keys   : string(1 to 32);
+        variable v_nkeys  : natural;
+        variable v_out    : string(1 to 32);
+        variable v_nout   : natural;
+        variable v_metric : string(1 to 32);
+        variable v_nmet   : natural;
+        variable v_exp    : string(1 to 32);
+        variable v_nexp   : natural;
+        variable v_press  : std_ulogic_vector(15 downto 0);
+        variable v_t0     : time;                -- Last key pressed
+        variable v_ts     : time;                -- Start of the wait for the output
+        variable v_tev    : time;
+        variable v_ms     : real;
+        variable v_errors : natural := 0;
+        variable v_line   : natural := 0;
+
+        -- Next blank separated word of the line, empty at the end or at a comment
+        procedure token(l : inout line; tok : out string; len : out natural) is
+            variable v_c : character;
+            variable v_k : natural := 0;
+        begin
+            tok := (tok'range => ' ');
+            while (l'length > 0) and ((l(l'left) = ' ') or (l(l'left) = HT)) loop
+                read(l, v_c);
+            end loop;
+            while (l'length > 0) and (l(l'left) /= ' ') and (l(l'left) /= HT) and (l(l'left) /= '#') loop
+                read(l, v_c);
+                if (v_k < tok'length) then
+                    tok(tok'left + v_k) := v_c;
+                    v_k := v_k + 1;
+                end if;
+            end loop;
+            len := v_k;
+        end procedure;
+
+        -- Last event of an output, -1 ns if the name is unknown
+        impure function event_f(name : string) return time is
+        begin
+            if    (name = "led_left")   then return t_led(0);
+            elsif (name = "led_right")  then return t_led(1);
+            elsif (name = "led_up")     then return t_led(2);
+            elsif (name = "led_down")   then return t_led(3);
+            elsif (name = "led_center") then return t_led(4);
+            elsif (name = "uart")       then return t_uart;
+            elsif (name = "display")    then return t_disp;
+            end if;
+            return -1 ns;
+        end function;
+
+        -- Text of the last event of an output against the expected one
+        impure function text_ok_f(name, expect : string) return boolean is
+            variable v_e : string(1 to expect'length) := expect;
+        begin
+            if (name = "uart") then
+                for i in v_e'range loop
+                    if (v_e(i) = '_') then
+                        v_e(i) := ' ';
+                    end if;
+                end loop;
+                return (v_e'length <= s_uart_len) and (s_uart_text(1 to v_e'length) = v_e);
+            elsif (name = "display") then
+                return (s_disp_text = v_e);
+            end if;
+            return false;
+        end function;
+
+        impure function text_f(name : string) return string is
+        begin
+            if (name = "uart") then
+                return s_uart_text(1 to s_uart_len);
+            end if;
+            return s_disp_text;
+        end function;
+
+        procedure check(cond : boolean; msg : string) is
+        begin
+            if not cond then
+                v_errors := v_errors + 1;
+                log("ERROR " & msg);
+                report msg severity error;
+            end if;
+        end procedure;
+    begin
+        wait for 10*t_clk_c;
+        wait until rising_edge(clk);
+        rstn <= '1';
+        v_t0 := now;
+        log("RESET released, scenario " & SCENARIO);
+
+        -- Peripherals out of reset: one column driven low, LEDs and display defined
+        wait for 1 ms;
+        v_n := 0;
+        for i in col'range loop
+            if (col(i) = '0') then
+                v_n := v_n + 1;
+            end if;
+        end loop;
+        check(not is_x(col) and (v_n = 1), "keypad columns " & to_string(col) & " after reset");
+        check(not is_x(led), "LEDs " & to_string(led) & " after reset");
+        check(not is_x(seg) and not is_x(ds), "display " & to_string(seg) & " " & to_string(ds) & " after reset");
+
+        while not endfile(scn) loop
+            readline(scn, v_l);
+            v_line := v_line + 1;
+
+            token(v_l, v_tok, v_n);
+            next when (v_n = 0);
+            v_delay := natural'value(v_tok(1 to v_n));
+            token(v_l, v_keys, v_nkeys);
+            token(v_l, v_tok, v_n);
+            v_hold := 0;
+            if (v_n > 0) then
+                v_hold := natural'value(v_tok(1 to v_n));
+            end if;
+            token(v_l, v_out, v_nout);
+            token(v_l, v_metric, v_nmet);
+            token(v_l, v_tok, v_n);
+            v_max := 0;
+            if (v_n > 0) then
+                v_max := natural'value(v_tok(1 to v_n));
+            end if;
+            token(v_l, v_exp, v_nexp);
+
+            v_press := (others => '0');
+            if (v_nkeys > 0) and (v_keys(1 to v_nkeys) /= "-") then
+                for i in 1 to v_nkeys loop
+                    if (key_f(v_keys(i)) < 16) then
+                        v_press(key_f(v_keys(i))) := '1';
+                    else
+                        check(false, SCENARIO & ":" & integer'image(v_line) & ": unknown key " & v_keys(i));
+                    end if;
+                end loop;
+            end if;
+            if (v_nout > 0) and ((v_nmet = 0) or (event_f(v_out(1 to v_nout)) < 0 ns)) then
+                check(false, SCENARIO & ":" & integer'image(v_line) & ": bad output or metric");
+                v_nout := 0;
+            end if;
+            if (v_nexp > 0) and (v_nout > 0) and (v_out(1 to v_nout) /= "uart") and (v_out(1 to v_nout) /= "display") then
+                check(false, SCENARIO & ":" & integer'image(v_line) & ": only uart and display have a text");
+                v_nexp := 0;
+            end if;
+
+            wait for v_delay * 1 ms;
+            wait until rising_edge(clk);
+            keys <= v_press;
+            v_ts := now;
+            if (v_press /= (v_press'range => '0')) then
+                v_t0 := now;
+                log("KEY " & v_keys(1 to v_nkeys));
+            end if;
+            wait for v_hold * 1 ms;
+            keys <= (others => '0');
+
+            -- The reaction may come during the hold or after the release
+            if (v_nout > 0) then
+                loop
+                    v_tev := event_f(v_out(1 to v_nout));
+                    exit when (v_tev > v_ts) or (now - v_ts >= TIMEOUT_MS * 1 ms);
+                    wait on t_led, t_uart, t_disp for TIMEOUT_MS * 1 ms - (now - v_ts);
+                end loop;
+
+                if (v_tev > v_ts) then
+                    v_ms := real((v_tev - v_t0) / 1 us) / 1000.0;
+                    result(RESULTS, BENCH, v_metric(1 to v_nmet), v_ms, "ms");
+                    check((v_max = 0) or (v_ms <= real(v_max)),
+                          v_metric(1 to v_nmet) & " above " & integer'image(v_max) & " ms");
+                    if (v_nexp > 0) then
+                        check(text_ok_f(v_out(1 to v_nout), v_exp(1 to v_nexp)),
+                              SCENARIO & ":" & integer'image(v_line) & ": " & v_out(1 to v_nout) & " shows """ &
+                              text_f(v_out(1 to v_nout)) & """, expected """ & v_exp(1 to v_nexp) & """");
+                    end if;
+                else
+                    check(false, SCENARIO & ":" & integer'image(v_line) & ": no " & v_out(1 to v_nout) &
+                          " event in " & integer'image(TIMEOUT_MS) & " ms");
+                end if;
+            end if;
+        end loop;
+
+        check(irq_n > 0, "no keypad interrupt served");
+        check(irq_late = 0, integer'image(irq_late) & " keypad interrupts above " & integer'image(IRQ_MAX_CYCLES) & " cycles");
+        if (irq_n > 0) then
+            result(RESULTS, BENCH, "irq_to_handler_min", irq_min, "cycles");
+            result(RESULTS, BENCH, "irq_to_handler_avg", irq_sum / irq_n, "cycles");
+            result(RESULTS, BENCH, "irq_to_handler_max", irq_max, "cycles");
+            result(RESULTS, BENCH, "irq_to_handler_max_us", real(irq_max) * 1.0e6 / real(clk_hz_c), "us");
+        end if;
+
+        result(RESULTS, BENCH, "errors", v_errors, "count");
+        log("END, " & integer'image(v_errors) & " errors");
+
+        done <= true;
+        wait;
+    end process;
+
+end architecture;